@@ -1,55 +1,56 @@
 #include "ai.hpp"
 
 #include <algorithm>
-#include <cstdlib>
 
-float AnimatronicAI::getAggroRate(const GameState &game) const
+int AnimatronicAI::getAggroRate(const GameState &game) const
 {
-    return 0.02f * game.hoursSurvived;
+    return aggroRatePerTick(game.hoursSurvived);
 }
 
-float AnimatronicAI::getRetreatThreshold() const { return 5.0f - (aggro * 3.0f); }
+int AnimatronicAI::getRetreatThreshold() const { return retreatThreshold(aggro); }
 
-float AnimatronicAI::getCooldownDuration() const { return 1.0f + (1.0f - aggro) * 2.0f; }
+int AnimatronicAI::getCooldownDuration() const { return cooldownTicks(aggro); }
 
-void AnimatronicAI::update(GameState &game, float deltaSeconds)
+uint32_t AnimatronicAI::getAdvanceChance() const { return advanceChance(aggro); }
+
+void AnimatronicAI::update(GameState &game, Rng &rng)
 {
-    aggro += getAggroRate(game) * deltaSeconds;
-    aggro = std::min(aggro, 1.0f);
+    aggro = std::min(aggro + getAggroRate(game), AGGRO_ONE);
 
-    if (cooldown > 0.0f)
-        cooldown = std::max(0.0f, cooldown - deltaSeconds);
+    if (cooldown > 0)
+        cooldown--;
 
-    decisionAcc += deltaSeconds;
-    if (decisionAcc < 1.0f)
+    if (++decisionAcc < DECISION_TICKS)
         return;
-    decisionAcc -= 1.0f;
+    decisionAcc = 0;
+
+    decide(game, rng);
+}
 
+void AnimatronicAI::decide(GameState &game, Rng &rng)
+{
     if (atDoor(game) && isBlocked(game))
     {
-        blockedTimer += 1.0f;
+        blockedTimer += 1;
 
-        if (blockedTimer >= getRetreatThreshold())
+        if (blockedTimer * AGGRO_ONE >= getRetreatThreshold())
         {
             retreat(game);
-            blockedTimer = 0.0f;
-            cooldown = 2.0f;
+            blockedTimer = 0;
+            cooldown = activeTuning().retreatCooldownTicks;
             return;
         }
         return;
     }
     else
     {
-        blockedTimer = 0.0f;
+        blockedTimer = 0;
     }
 
-    if (cooldown > 0.0f)
+    if (cooldown > 0)
         return;
 
-    float baseChance = 0.25f + 0.5f * aggro;
-    float r = std::rand() / (float)RAND_MAX;
-
-    if (r < baseChance)
+    if (rng.next() < getAdvanceChance())
     {
         advance(game);
         cooldown = getCooldownDuration();
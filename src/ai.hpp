@@ -1,13 +1,58 @@
 #pragma once
 
 #include "game_state.hpp"
+#include "rng.hpp"
+#include "tuning.hpp"
 
+#include <algorithm>
+#include <cstdint>
+
+// Aggro is fixed-point: AGGRO_ONE means fully aggressive. The default 0.02 per second per hour
+// survived works out to 20 units per tick per hour.
+constexpr int AGGRO_ONE = 60000;
+constexpr int DECISION_TICKS = TICKS_PER_SECOND;
+
+// Tuning curves from the active Tuning, shared by every animatronic implementation and the
+// batched engine. They read the precomputed TuningCurves, so each is a lookup or one multiply.
+
+// Aggro units gained per tick.
+inline int aggroRatePerTick(int hoursSurvived)
+{
+    return activeCurves().aggroPerTick[std::min(hoursSurvived, CURVE_HOURS - 1)];
+}
+
+// Retreat once blockedTimer * AGGRO_ONE reaches this: 5 - 3 * aggro decisions by default.
+inline int retreatThreshold(int aggro)
+{
+    const TuningCurves &c = activeCurves();
+    return c.retreatBase - c.retreatSlope * aggro;
+}
+
+// 1 + (1 - aggro) * 2 seconds by default, in ticks.
+inline int cooldownTicks(int aggro)
+{
+    const TuningCurves &c = activeCurves();
+    const int64_t extra = int64_t{AGGRO_ONE - aggro} * c.cooldownRange;
+    return c.cooldownFull + static_cast<int>(extra / AGGRO_ONE);
+}
+
+// 0.25 + 0.5 * aggro by default, as a fraction of 2^32 so a single 32-bit roll decides it
+// exactly.
+inline uint32_t advanceChance(int aggro)
+{
+    const TuningCurves &c = activeCurves();
+    return static_cast<uint32_t>(c.advanceCalm + c.advanceRange * aggro / AGGRO_ONE);
+}
+
+// Virtual-dispatch animatronics: the original design, where each type overrides hooks. The game
+// now runs the compile-time Animatronic<Spec> in animatronic.hpp, which follows the same rules;
+// these stay as the reference implementation console_fnaf_bench measures it against.
 struct AnimatronicAI
 {
-    float aggro = 0.0f;
-    float cooldown = 0.0f;
-    float decisionAcc = 0.0f;
-    float blockedTimer = 0.0f;
+    int aggro = 0;        // 0..AGGRO_ONE
+    int cooldown = 0;     // ticks until the next advance roll
+    int decisionAcc = 0;  // ticks since the last decision
+    int blockedTimer = 0; // decisions spent blocked at the door
 
     virtual ~AnimatronicAI() = default;
 
@@ -16,11 +61,13 @@ struct AnimatronicAI
     virtual void retreat(GameState &game) = 0;
     virtual bool atDoor(const GameState &game) const = 0;
 
-    virtual float getAggroRate(const GameState &game) const;
-    virtual float getRetreatThreshold() const;
-    virtual float getCooldownDuration() const;
+    virtual int getAggroRate(const GameState &game) const;
+    virtual int getRetreatThreshold() const;
+    virtual int getCooldownDuration() const;
+    virtual uint32_t getAdvanceChance() const;
 
-    void update(GameState &game, float deltaSeconds);
+    void update(GameState &game, Rng &rng);
+    void decide(GameState &game, Rng &rng);
 };
 
 struct FreddoAI : AnimatronicAI
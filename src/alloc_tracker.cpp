@@ -0,0 +1,207 @@
+#include "alloc_tracker.hpp"
+
+#ifdef S2S_TRACK_ALLOCS
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>
+#define S2S_ALLOC_STACKS 1
+#endif
+
+// Frames kept per call stack, after dropping the tracker's own two.
+constexpr int STACK_DEPTH = 8;
+constexpr int TRACKER_FRAMES = 2;
+constexpr int MAX_SITES = 64;
+
+struct AllocSite
+{
+    void *frames[STACK_DEPTH];
+    int depth;
+    uint64_t count;
+    uint64_t bytes;
+};
+
+static std::atomic<bool> tracking{false};
+static std::atomic<uint64_t> allocations{0};
+// Sites are looked up under a lock: tracking is for finding allocations, not for speed.
+static std::mutex sitesLock;
+static AllocSite sites[MAX_SITES];
+static int siteCount = 0;
+static uint64_t unattributed = 0; // stacks that didn't fit in the table
+// Set while the tracker itself runs, in case the platform's backtrace allocates.
+static thread_local bool inTracker = false;
+
+#ifdef S2S_ALLOC_STACKS
+__attribute__((noinline)) static void recordSite(size_t bytes)
+{
+    void *frames[STACK_DEPTH + TRACKER_FRAMES];
+    const int captured = backtrace(frames, STACK_DEPTH + TRACKER_FRAMES);
+    const int depth = std::max(captured - TRACKER_FRAMES, 0);
+    void **stack = frames + (captured - depth);
+
+    std::lock_guard<std::mutex> lock(sitesLock);
+    for (int i = 0; i < siteCount; ++i)
+    {
+        AllocSite &site = sites[i];
+        if (site.depth == depth && std::equal(stack, stack + depth, site.frames))
+        {
+            site.count++;
+            site.bytes += bytes;
+            return;
+        }
+    }
+    if (siteCount == MAX_SITES)
+    {
+        unattributed++;
+        return;
+    }
+    AllocSite &site = sites[siteCount++];
+    std::copy(stack, stack + depth, site.frames);
+    site.depth = depth;
+    site.count = 1;
+    site.bytes = bytes;
+}
+#endif
+
+static void noteAllocation(size_t bytes)
+{
+    if (!tracking.load(std::memory_order_relaxed) || inTracker)
+        return;
+    inTracker = true;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+#ifdef S2S_ALLOC_STACKS
+    recordSite(bytes);
+#else
+    (void)bytes;
+#endif
+    inTracker = false;
+}
+
+void *operator new(size_t bytes)
+{
+    noteAllocation(bytes);
+    if (void *block = std::malloc(bytes ? bytes : 1))
+        return block;
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t bytes, std::align_val_t align)
+{
+    noteAllocation(bytes);
+    const size_t alignment = std::max(static_cast<size_t>(align), sizeof(void *));
+#ifdef _WIN32
+    if (void *block = _aligned_malloc(bytes ? bytes : 1, alignment))
+        return block;
+#else
+    void *block = nullptr;
+    if (posix_memalign(&block, alignment, bytes ? bytes : 1) == 0)
+        return block;
+#endif
+    throw std::bad_alloc();
+}
+
+void operator delete(void *block) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void *block, size_t) noexcept
+{
+    std::free(block);
+}
+
+void operator delete(void *block, std::align_val_t) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+void operator delete(void *block, size_t, std::align_val_t align) noexcept
+{
+    operator delete(block, align);
+}
+
+bool allocTrackingBuilt()
+{
+    return true;
+}
+
+void startAllocTracking()
+{
+#ifdef S2S_ALLOC_STACKS
+    // The first backtrace loads the unwinder; get that out of the way before counting.
+    void *frame;
+    backtrace(&frame, 1);
+#endif
+    {
+        std::lock_guard<std::mutex> lock(sitesLock);
+        siteCount = 0;
+        unattributed = 0;
+    }
+    allocations.store(0, std::memory_order_relaxed);
+    tracking.store(true, std::memory_order_release);
+}
+
+void stopAllocTracking()
+{
+    tracking.store(false, std::memory_order_release);
+}
+
+uint64_t trackedAllocations()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+void printAllocSites(std::FILE *out)
+{
+    std::lock_guard<std::mutex> lock(sitesLock);
+    AllocSite *bySites[MAX_SITES];
+    for (int i = 0; i < siteCount; ++i)
+        bySites[i] = &sites[i];
+    std::sort(bySites, bySites + siteCount,
+              [](const AllocSite *a, const AllocSite *b) { return a->count > b->count; });
+
+    for (int i = 0; i < siteCount; ++i)
+    {
+        const AllocSite &site = *bySites[i];
+        std::fprintf(out, "%llu allocations, %llu bytes, from:\n",
+                     static_cast<unsigned long long>(site.count),
+                     static_cast<unsigned long long>(site.bytes));
+#ifdef S2S_ALLOC_STACKS
+        // Written straight to the descriptor: backtrace_symbols_fd doesn't allocate.
+        std::fflush(out);
+        backtrace_symbols_fd(site.frames, site.depth, fileno(out));
+#endif
+    }
+    if (unattributed > 0)
+        std::fprintf(out, "%llu allocations from other call stacks\n",
+                     static_cast<unsigned long long>(unattributed));
+}
+
+#else
+
+bool allocTrackingBuilt()
+{
+    return false;
+}
+
+void startAllocTracking() {}
+
+void stopAllocTracking() {}
+
+uint64_t trackedAllocations()
+{
+    return 0;
+}
+
+void printAllocSites(std::FILE *) {}
+
+#endif
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+
+// Heap allocation tracking for --check-allocs. Configured with -DTRACK_ALLOCS=ON, the game
+// replaces the global operator new; while tracking is on, every allocation is counted and
+// grouped by the call stack that made it. Without it nothing is replaced, tracking never
+// counts anything and allocTrackingBuilt is false. Only C++ allocations are seen: malloc
+// called directly (stdio, ncurses, miniaudio) is not.
+bool allocTrackingBuilt();
+
+void startAllocTracking();
+void stopAllocTracking();
+// Allocations since startAllocTracking, from any thread.
+uint64_t trackedAllocations();
+
+// One entry per call stack, most allocations first, symbolized where the platform can.
+void printAllocSites(std::FILE *out);
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "ai.hpp"
+#include "game_state.hpp"
+#include "rng.hpp"
+#include "room_graph.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+enum class DoorSide
+{
+    Left,
+    Right,
+};
+
+// Everything that makes one animatronic different from another, as a compile-time constant.
+// Where it walks comes from its route in the active RoomGraph, how it behaves from the active
+// Tuning.
+struct AnimatronicSpec
+{
+    int GameState::*position; // the GameState field holding its room
+    int route;                // its AnimatronicRoute in the room graph
+    DoorSide door;            // the office door that keeps it out
+    int retreatRooms;         // how far back it goes after waiting out a closed door
+};
+
+inline constexpr AnimatronicSpec FREDDO_SPEC{
+    &GameState::freddoPos, FREDDO_ROUTE, DoorSide::Left, 2,
+};
+inline constexpr AnimatronicSpec CHICO_SPEC{
+    &GameState::chicoPos, CHICO_ROUTE, DoorSide::Right, 2,
+};
+
+// AnimatronicAI's rules specialized for one spec. Every call resolves at compile time, so
+// update() inlines into stepNight with the spec's numbers folded in: no vtable, no heap.
+// On the default map the routes walk rooms in number order, exactly like AnimatronicAI.
+template <const AnimatronicSpec &Spec>
+struct Animatronic
+{
+    static constexpr const AnimatronicSpec &spec = Spec;
+
+    int aggro = 0;        // 0..AGGRO_ONE
+    int cooldown = 0;     // ticks until the next advance roll
+    int decisionAcc = 0;  // ticks since the last decision
+    int blockedTimer = 0; // decisions spent blocked at the door
+
+    static const AnimatronicRoute &route() { return activeRoomGraph().routes[Spec.route]; }
+
+    static int position(const GameState &game) { return game.*Spec.position; }
+
+    static bool atDoor(const GameState &game) { return position(game) == route().doorRoom; }
+
+    static bool isBlocked(const GameState &game)
+    {
+        return Spec.door == DoorSide::Left ? game.leftDoor : game.rightDoor;
+    }
+
+    static int aggroRate(const GameState &game) { return aggroRatePerTick(game.hoursSurvived); }
+
+    // One step along a shortest path to the office: a table lookup, whatever the map size.
+    static void advance(GameState &game)
+    {
+        int &room = game.*Spec.position;
+        room = route().advance[room];
+    }
+
+    static void retreat(GameState &game)
+    {
+        int &room = game.*Spec.position;
+        const int32_t *away = route().retreat.data();
+        for (int i = 0; i < Spec.retreatRooms; ++i)
+            room = away[room];
+    }
+
+    void update(GameState &game, Rng &rng)
+    {
+        aggro = std::min(aggro + aggroRate(game), AGGRO_ONE);
+
+        if (cooldown > 0)
+            cooldown--;
+
+        if (++decisionAcc < DECISION_TICKS)
+            return;
+        decisionAcc = 0;
+
+        decide(game, rng);
+    }
+
+    void decide(GameState &game, Rng &rng)
+    {
+        if (atDoor(game) && isBlocked(game))
+        {
+            blockedTimer += 1;
+            if (blockedTimer * AGGRO_ONE >= retreatThreshold(aggro))
+            {
+                retreat(game);
+                blockedTimer = 0;
+                cooldown = activeTuning().retreatCooldownTicks;
+            }
+            return;
+        }
+        blockedTimer = 0;
+
+        if (cooldown > 0)
+            return;
+
+        if (rng.next() < advanceChance(aggro))
+        {
+            advance(game);
+            cooldown = cooldownTicks(aggro);
+        }
+    }
+};
+
+using Freddo = Animatronic<FREDDO_SPEC>;
+using Chico = Animatronic<CHICO_SPEC>;
+
+// The cast of a night, in update order (the order matters: they share one RNG stream).
+// A spec and a type here are only the start of a new animatronic: it also needs a position in
+// GameState and snapshot.hpp, an Outcome and its nightOutcome check, a route in room_graph
+// (ROUTE_COUNT, ROUTE_NAMES), its drawing in render.cpp, its telemetry fields, its own lanes in
+// batch_sim, and a place in the code that hardcodes the cast (event_sim, survival_solver, ai,
+// door_policy).
+using Animatronics = std::tuple<Freddo, Chico>;
+
+// Calls f(animatronic) for each one, in update order.
+template <typename Tuple, typename F>
+void forEachAnimatronic(Tuple &animatronics, F &&f)
+{
+    std::apply([&](auto &...each) { (f(each), ...); }, animatronics);
+}
@@ -0,0 +1,420 @@
+#include "asset_pack.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+const char *codecName(AssetCodec codec)
+{
+    switch (codec)
+    {
+    case AssetCodec::Stored:
+        return "stored";
+    case AssetCodec::Lz:
+        return "lz";
+    case AssetCodec::Pcm16:
+        return "pcm16";
+    }
+    return "?";
+}
+
+static void putU32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+static uint32_t getU32(const uint8_t *in)
+{
+    return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+// --- LZ: a sequence is a token (literal count << 4 | match length - 4, 15 meaning "more
+// bytes follow"), the literals, then a 2-byte offset back to the match. The last sequence is
+// literals only.
+
+constexpr size_t LZ_MIN_MATCH = 4;
+constexpr size_t LZ_MAX_OFFSET = 65535;
+constexpr int LZ_HASH_BITS = 14;
+
+static void putLength(std::vector<uint8_t> &out, size_t length)
+{
+    for (; length >= 255; length -= 255)
+        out.push_back(255);
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+static void putSequence(std::vector<uint8_t> &out, const uint8_t *literals, size_t literalCount,
+                        size_t offset, size_t matchLength)
+{
+    const size_t extraMatch = matchLength > 0 ? matchLength - LZ_MIN_MATCH : 0;
+    out.push_back(static_cast<uint8_t>(std::min<size_t>(literalCount, 15) << 4 |
+                                       std::min<size_t>(extraMatch, 15)));
+    if (literalCount >= 15)
+        putLength(out, literalCount - 15);
+    out.insert(out.end(), literals, literals + literalCount);
+    if (matchLength == 0)
+        return;
+    out.push_back(static_cast<uint8_t>(offset));
+    out.push_back(static_cast<uint8_t>(offset >> 8));
+    if (extraMatch >= 15)
+        putLength(out, extraMatch - 15);
+}
+
+static uint32_t lzHash(const uint8_t *at)
+{
+    uint32_t word;
+    std::memcpy(&word, at, 4);
+    return (word * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static void packLz(const std::vector<uint8_t> &raw, std::vector<uint8_t> &out)
+{
+    std::vector<uint32_t> lastSeen(size_t(1) << LZ_HASH_BITS, UINT32_MAX);
+    const uint8_t *data = raw.data();
+    size_t literalStart = 0;
+    size_t i = 0;
+    while (i + LZ_MIN_MATCH <= raw.size())
+    {
+        const uint32_t hash = lzHash(data + i);
+        const uint32_t candidate = lastSeen[hash];
+        lastSeen[hash] = static_cast<uint32_t>(i);
+        if (candidate == UINT32_MAX || i - candidate > LZ_MAX_OFFSET ||
+            std::memcmp(data + candidate, data + i, LZ_MIN_MATCH) != 0)
+        {
+            i++;
+            continue;
+        }
+
+        size_t length = LZ_MIN_MATCH;
+        while (i + length < raw.size() && data[candidate + length] == data[i + length])
+            length++;
+        putSequence(out, data + literalStart, i - literalStart, i - candidate, length);
+        i += length;
+        literalStart = i;
+    }
+    putSequence(out, data + literalStart, raw.size() - literalStart, 0, 0);
+}
+
+static bool readLength(const uint8_t *&in, const uint8_t *end, size_t &length)
+{
+    for (;;)
+    {
+        if (in == end)
+            return false;
+        const uint8_t byte = *in++;
+        length += byte;
+        if (byte != 255)
+            return true;
+    }
+}
+
+static bool unpackLz(const uint8_t *in, const uint8_t *end, size_t rawBytes,
+                     std::vector<uint8_t> &out)
+{
+    while (in < end)
+    {
+        const uint8_t token = *in++;
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !readLength(in, end, literalCount))
+            return false;
+        if (literalCount > static_cast<size_t>(end - in) ||
+            literalCount > rawBytes - out.size())
+            return false;
+        out.insert(out.end(), in, in + literalCount);
+        in += literalCount;
+        if (in == end)
+            break;
+
+        if (end - in < 2)
+            return false;
+        const size_t offset = in[0] | in[1] << 8;
+        in += 2;
+        size_t length = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15 && !readLength(in, end, length))
+            return false;
+        if (offset == 0 || offset > out.size() || length > rawBytes - out.size())
+            return false;
+        // Byte by byte: a match may overlap the bytes it is producing.
+        const size_t from = out.size() - offset;
+        for (size_t j = 0; j < length; ++j)
+            out.push_back(out[from + j]);
+    }
+    return out.size() == rawBytes;
+}
+
+// --- Pcm16: the WAV header and anything after the samples are kept as they are. Samples are
+// coded in blocks, each with its own Rice parameter k: the residual from a straight-line
+// prediction is zigzagged, its high bits written in unary and its low k bits as they are.
+// Sound effects are smooth enough that residuals are a fraction of the samples' size, which a
+// byte-level LZ can't exploit.
+
+constexpr size_t PCM_BLOCK = 256;
+constexpr uint32_t PCM_MAX_K = 20;
+constexpr uint32_t PCM_ESCAPE = 24; // this many 1 bits, then the residual in 32 bits
+
+struct BitWriter
+{
+    std::vector<uint8_t> &out;
+    uint64_t bits = 0;
+    int count = 0;
+
+    void put(uint32_t value, int width)
+    {
+        bits |= static_cast<uint64_t>(value) << count;
+        count += width;
+        for (; count >= 8; count -= 8, bits >>= 8)
+            out.push_back(static_cast<uint8_t>(bits));
+    }
+
+    void flush()
+    {
+        if (count > 0)
+            out.push_back(static_cast<uint8_t>(bits));
+    }
+};
+
+struct BitReader
+{
+    const uint8_t *in;
+    const uint8_t *end;
+    uint64_t bits = 0;
+    int count = 0;
+
+    bool get(int width, uint32_t &value)
+    {
+        for (; count < width; count += 8)
+        {
+            if (in == end)
+                return false;
+            bits |= static_cast<uint64_t>(*in++) << count;
+        }
+        value = static_cast<uint32_t>(bits & ((uint64_t(1) << width) - 1));
+        bits >>= width;
+        count -= width;
+        return true;
+    }
+};
+
+struct PcmLayout
+{
+    size_t samplesAt = 0;
+    size_t samples = 0;
+    uint32_t channels = 0;
+};
+
+// Finds the sample data of a 16-bit PCM WAV file.
+static bool findPcm(const std::vector<uint8_t> &raw, PcmLayout &layout)
+{
+    if (raw.size() < 12 || std::memcmp(raw.data(), "RIFF", 4) != 0 ||
+        std::memcmp(raw.data() + 8, "WAVE", 4) != 0)
+        return false;
+
+    for (size_t at = 12; at + 8 <= raw.size();)
+    {
+        const uint8_t *chunk = raw.data() + at;
+        const size_t bytes = std::min<size_t>(getU32(chunk + 4), raw.size() - at - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && bytes >= 16)
+        {
+            const int format = chunk[8] | chunk[9] << 8;
+            const int bitsPerSample = chunk[22] | chunk[23] << 8;
+            if (format != 1 || bitsPerSample != 16)
+                return false;
+            layout.channels = chunk[10] | chunk[11] << 8;
+        }
+        else if (std::memcmp(chunk, "data", 4) == 0)
+        {
+            layout.samplesAt = at + 8;
+            layout.samples = bytes / 2;
+            return layout.channels > 0 && layout.channels <= 8;
+        }
+        at += 8 + bytes + (bytes & 1);
+    }
+    return false;
+}
+
+static int32_t predictSample(const int16_t *samples, size_t i, uint32_t channels)
+{
+    const int32_t previous = i >= channels ? samples[i - channels] : 0;
+    const int32_t before = i >= 2 * channels ? samples[i - 2 * channels] : 0;
+    return 2 * previous - before;
+}
+
+static uint32_t riceBits(uint32_t residual, uint32_t k)
+{
+    const uint32_t high = residual >> k;
+    return high < PCM_ESCAPE ? high + 1 + k : PCM_ESCAPE + 32;
+}
+
+static bool packPcm(const std::vector<uint8_t> &raw, std::vector<uint8_t> &out)
+{
+    PcmLayout layout;
+    if (!findPcm(raw, layout))
+        return false;
+
+    std::vector<int16_t> samples(layout.samples);
+    std::vector<uint32_t> residuals(layout.samples);
+    for (size_t i = 0; i < layout.samples; ++i)
+    {
+        const uint8_t *at = raw.data() + layout.samplesAt + 2 * i;
+        samples[i] = static_cast<int16_t>(at[0] | at[1] << 8);
+    }
+    for (size_t i = 0; i < layout.samples; ++i)
+    {
+        const int32_t residual = samples[i] - predictSample(samples.data(), i, layout.channels);
+        residuals[i] = static_cast<uint32_t>(residual) << 1 ^ static_cast<uint32_t>(residual >> 31);
+    }
+
+    const size_t suffixAt = layout.samplesAt + 2 * layout.samples;
+    putU32(out, static_cast<uint32_t>(layout.samplesAt));
+    putU32(out, static_cast<uint32_t>(layout.samples));
+    out.push_back(static_cast<uint8_t>(layout.channels));
+    out.insert(out.end(), raw.begin(), raw.begin() + layout.samplesAt);
+    out.insert(out.end(), raw.begin() + suffixAt, raw.end());
+
+    BitWriter writer{out};
+    for (size_t block = 0; block < layout.samples; block += PCM_BLOCK)
+    {
+        const size_t blockEnd = std::min(layout.samples, block + PCM_BLOCK);
+        uint32_t bestK = 0;
+        uint64_t bestBits = UINT64_MAX;
+        for (uint32_t k = 0; k <= PCM_MAX_K; ++k)
+        {
+            uint64_t bits = 0;
+            for (size_t i = block; i < blockEnd; ++i)
+                bits += riceBits(residuals[i], k);
+            if (bits < bestBits)
+            {
+                bestBits = bits;
+                bestK = k;
+            }
+        }
+
+        writer.put(bestK, 5);
+        for (size_t i = block; i < blockEnd; ++i)
+        {
+            const uint32_t high = residuals[i] >> bestK;
+            if (high >= PCM_ESCAPE)
+            {
+                writer.put((1u << PCM_ESCAPE) - 1, PCM_ESCAPE);
+                writer.put(residuals[i], 32);
+                continue;
+            }
+            writer.put((1u << high) - 1, static_cast<int>(high) + 1);
+            writer.put(residuals[i] & ((1u << bestK) - 1), static_cast<int>(bestK));
+        }
+    }
+    writer.flush();
+    return true;
+}
+
+static bool unpackPcm(const uint8_t *in, const uint8_t *end, size_t rawBytes,
+                      std::vector<uint8_t> &out)
+{
+    if (end - in < 9)
+        return false;
+    const size_t samplesAt = getU32(in);
+    const size_t sampleCount = getU32(in + 4);
+    const uint32_t channels = in[8];
+    in += 9;
+    if (channels == 0 || samplesAt > rawBytes || sampleCount > (rawBytes - samplesAt) / 2)
+        return false;
+    const size_t suffixBytes = rawBytes - samplesAt - 2 * sampleCount;
+    if (static_cast<size_t>(end - in) < samplesAt + suffixBytes)
+        return false;
+
+    out.resize(rawBytes);
+    std::memcpy(out.data(), in, samplesAt);
+    std::memcpy(out.data() + samplesAt + 2 * sampleCount, in + samplesAt, suffixBytes);
+    in += samplesAt + suffixBytes;
+
+    std::vector<int16_t> samples(sampleCount);
+    BitReader reader{in, end};
+    for (size_t block = 0; block < sampleCount; block += PCM_BLOCK)
+    {
+        uint32_t k;
+        if (!reader.get(5, k) || k > PCM_MAX_K)
+            return false;
+        const size_t blockEnd = std::min(sampleCount, block + PCM_BLOCK);
+        for (size_t i = block; i < blockEnd; ++i)
+        {
+            uint32_t high = 0;
+            uint32_t bit = 1;
+            while (high < PCM_ESCAPE && reader.get(1, bit) && bit == 1)
+                high++;
+            uint32_t residual;
+            if (high == PCM_ESCAPE)
+            {
+                if (!reader.get(32, residual))
+                    return false;
+            }
+            else
+            {
+                uint32_t low;
+                if (bit != 0 || !reader.get(static_cast<int>(k), low))
+                    return false;
+                residual = high << k | low;
+            }
+
+            const int32_t delta = static_cast<int32_t>(residual >> 1 ^ (0u - (residual & 1)));
+            const int32_t sample = predictSample(samples.data(), i, channels) + delta;
+            if (sample < INT16_MIN || sample > INT16_MAX)
+                return false;
+            samples[i] = static_cast<int16_t>(sample);
+            out[samplesAt + 2 * i] = static_cast<uint8_t>(sample);
+            out[samplesAt + 2 * i + 1] = static_cast<uint8_t>(sample >> 8);
+        }
+    }
+    return true;
+}
+
+bool packAsset(AssetCodec codec, const std::vector<uint8_t> &raw, std::vector<uint8_t> &out)
+{
+    out.clear();
+    switch (codec)
+    {
+    case AssetCodec::Stored:
+        out = raw;
+        return true;
+    case AssetCodec::Lz:
+        packLz(raw, out);
+        return true;
+    case AssetCodec::Pcm16:
+        return packPcm(raw, out);
+    }
+    return false;
+}
+
+bool unpackBytes(AssetCodec codec, const uint8_t *packed, size_t packedBytes, size_t rawBytes,
+                 std::vector<uint8_t> &out)
+{
+    out.clear();
+    out.reserve(rawBytes);
+    switch (codec)
+    {
+    case AssetCodec::Stored:
+        if (packedBytes != rawBytes)
+            return false;
+        out.assign(packed, packed + packedBytes);
+        return true;
+    case AssetCodec::Lz:
+        return unpackLz(packed, packed + packedBytes, rawBytes, out);
+    case AssetCodec::Pcm16:
+        return unpackPcm(packed, packed + packedBytes, rawBytes, out);
+    }
+    return false;
+}
+
+const AssetEntry *findAsset(const AssetPack &pack, const char *name)
+{
+    const AssetEntry *end = pack.entries + pack.count;
+    const AssetEntry *entry = std::lower_bound(
+        pack.entries, end, name,
+        [](const AssetEntry &a, const char *key) { return std::strcmp(a.name, key) < 0; });
+    return entry != end && std::strcmp(entry->name, name) == 0 ? entry : nullptr;
+}
+
+bool unpackAsset(const AssetPack &pack, const AssetEntry &entry, std::vector<uint8_t> &out)
+{
+    return unpackBytes(entry.codec, pack.data + entry.offset, entry.packedBytes, entry.rawBytes,
+                       out);
+}
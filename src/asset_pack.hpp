@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How one asset is stored in the pack. The packer tries each codec that applies and keeps the
+// smallest result.
+enum class AssetCodec : uint8_t
+{
+    Stored,
+    Lz,    // byte-oriented LZ77: literal runs and back-references, for any file
+    Pcm16, // 16-bit PCM WAV: each sample predicted from the two before it, residuals Rice-coded
+};
+
+struct AssetEntry
+{
+    const char *name;
+    uint32_t offset; // into AssetPack::data
+    uint32_t packedBytes;
+    uint32_t rawBytes;
+    AssetCodec codec;
+};
+
+// The assets/ folder, compressed at build time by console_fnaf_pack and linked into the game,
+// so nothing is looked up on disk at run time. The index is sorted by name.
+struct AssetPack
+{
+    const AssetEntry *entries;
+    size_t count;
+    const uint8_t *data;
+};
+
+// Defined in the generated asset_pack_data.cpp.
+const AssetPack &embeddedAssets();
+
+const AssetEntry *findAsset(const AssetPack &pack, const char *name);
+// Decompresses `entry` into `out`; false if its data is damaged.
+bool unpackAsset(const AssetPack &pack, const AssetEntry &entry, std::vector<uint8_t> &out);
+
+// Compresses `raw` with `codec` into `out`; false if the codec doesn't apply to it.
+bool packAsset(AssetCodec codec, const std::vector<uint8_t> &raw, std::vector<uint8_t> &out);
+bool unpackBytes(AssetCodec codec, const uint8_t *packed, size_t packedBytes, size_t rawBytes,
+                 std::vector<uint8_t> &out);
+const char *codecName(AssetCodec codec);
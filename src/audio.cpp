@@ -1,64 +1,229 @@
 #include "audio.hpp"
 
+#include "asset_pack.hpp"
+
 #define MINIAUDIO_IMPLEMENTATION
 #include "../third_party/miniaudio.h"
 
-#include <filesystem>
-
-#ifdef _WIN32
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 static ma_engine engine{};
-static bool ready = false;
 
-static std::filesystem::path executableDirectory()
+// Loading runs on its own thread. Until it finishes, plays are counted under `pendingMutex`;
+// it starts them and then marks audio ready, after which playSound never touches the lock.
+enum class AudioState
+{
+    Loading,
+    Ready,
+    Off, // no device, or shut down
+};
+
+static std::atomic<AudioState> state{AudioState::Off};
+static std::thread loader;
+static std::mutex pendingMutex;
+
+// Each effect is decoded once into memory and played through a fixed pool of voices that share
+// the decoded data, so triggering one never touches the disk or the heap.
+constexpr int VOICES_PER_EFFECT = 4;
+
+struct Effect
+{
+    explicit Effect(const char *file) : file(file) {}
+
+    const char *file;
+    ma_sound voices[VOICES_PER_EFFECT];
+    int loaded = 0;
+    uint64_t started[VOICES_PER_EFFECT] = {}; // startCount when each voice last started
+    uint64_t startCount = 0;
+    int pending = 0;
+    bool registered = false;
+    std::vector<float> pcm;
+};
+
+static Effect effects[static_cast<int>(Sound::Count)] = {
+    Effect("SFXBible_12478.wav"),
+};
+
+static AudioStats stats;
+
+static double millisSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// Unpacks the effect's file from the asset pack, decodes it and hands the samples to the
+// engine under the file's name, so the voices below find them without a file system.
+static void loadEffect(Effect &effect)
 {
-#ifdef _WIN32
-    wchar_t buf[MAX_PATH];
-    const DWORD len = GetModuleFileNameW(nullptr, buf, MAX_PATH);
-    if (len > 0 && len < MAX_PATH)
-        return std::filesystem::path(buf).parent_path();
-#endif
-    return std::filesystem::current_path();
+    const auto unpackStart = std::chrono::steady_clock::now();
+    const AssetPack &pack = embeddedAssets();
+    const AssetEntry *asset = findAsset(pack, effect.file);
+    std::vector<uint8_t> file;
+    const bool unpacked = asset && unpackAsset(pack, *asset, file);
+    stats.unpackMs += millisSince(unpackStart);
+    if (!unpacked)
+        return;
+
+    ma_decoder_config config = ma_decoder_config_init(ma_format_f32, 0, 0);
+    ma_decoder decoder;
+    if (ma_decoder_init_memory(file.data(), file.size(), &config, &decoder) != MA_SUCCESS)
+        return;
+    ma_uint64 frames = 0;
+    if (ma_decoder_get_length_in_pcm_frames(&decoder, &frames) == MA_SUCCESS)
+    {
+        effect.pcm.resize(frames * decoder.outputChannels);
+        ma_decoder_read_pcm_frames(&decoder, effect.pcm.data(), frames, &frames);
+    }
+    const ma_uint32 channels = decoder.outputChannels;
+    const ma_uint32 sampleRate = decoder.outputSampleRate;
+    ma_decoder_uninit(&decoder);
+    if (frames == 0 ||
+        ma_resource_manager_register_decoded_data(ma_engine_get_resource_manager(&engine),
+                                                  effect.file, effect.pcm.data(), frames,
+                                                  ma_format_f32, channels,
+                                                  sampleRate) != MA_SUCCESS)
+        return;
+    effect.registered = true;
+
+    if (ma_sound_init_from_file(&engine, effect.file, MA_SOUND_FLAG_DECODE, nullptr, nullptr,
+                                &effect.voices[0]) != MA_SUCCESS)
+        return;
+    effect.loaded = 1;
+
+    while (effect.loaded < VOICES_PER_EFFECT &&
+           ma_sound_init_copy(&engine, &effect.voices[0], MA_SOUND_FLAG_DECODE, nullptr,
+                              &effect.voices[effect.loaded]) == MA_SUCCESS)
+        effect.loaded++;
 }
 
-static std::filesystem::path assetPath(const char *name)
+static void startVoice(Effect &effect)
 {
-    const auto filename = std::filesystem::path(name);
-    const auto candidates = {
-        executableDirectory() / "assets" / filename,
-        std::filesystem::current_path() / "assets" / filename,
-    };
+    if (effect.loaded == 0)
+        return;
 
-    for (const auto &path : candidates)
+    const auto start = std::chrono::steady_clock::now();
+
+    // Use an idle voice; when all are busy, restart the one started longest ago.
+    int chosen = -1;
+    for (int i = 0; i < effect.loaded && chosen < 0; ++i)
+    {
+        if (!ma_sound_is_playing(&effect.voices[i]))
+            chosen = i;
+    }
+    if (chosen < 0)
+    {
+        chosen = 0;
+        for (int i = 1; i < effect.loaded; ++i)
+        {
+            if (effect.started[i] < effect.started[chosen])
+                chosen = i;
+        }
+        stats.stolen++;
+    }
+    effect.started[chosen] = ++effect.startCount;
+    ma_sound *voice = &effect.voices[chosen];
+    ma_sound_seek_to_pcm_frame(voice, 0);
+    ma_sound_start(voice);
+
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+    stats.plays++;
+    stats.totalTriggerNanos += static_cast<uint64_t>(nanos);
+    if (static_cast<uint64_t>(nanos) > stats.maxTriggerNanos)
+        stats.maxTriggerNanos = static_cast<uint64_t>(nanos);
+}
+
+static void loadAudio()
+{
+    const auto start = std::chrono::steady_clock::now();
+    const bool opened = ma_engine_init(nullptr, &engine) == MA_SUCCESS;
+    if (opened)
     {
-        if (std::filesystem::exists(path))
-            return path;
+        for (Effect &effect : effects)
+            loadEffect(effect);
+
+        const ma_device *device = ma_engine_get_device(&engine);
+        if (device && device->playback.internalSampleRate > 0)
+            stats.outputLatencyMs = 1000.0 * device->playback.internalPeriodSizeInFrames *
+                                    device->playback.internalPeriods /
+                                    device->playback.internalSampleRate;
     }
 
-    return executableDirectory() / "assets" / filename;
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    stats.loadMs = millisSince(start);
+    stats.readyAt = std::chrono::steady_clock::now();
+    if (opened)
+    {
+        // A burst of queued plays is as loud as the voices allow, not a pile-up.
+        for (Effect &effect : effects)
+        {
+            for (int i = std::min(effect.pending, effect.loaded); i > 0; --i)
+                startVoice(effect);
+            effect.pending = 0;
+        }
+    }
+    state.store(opened ? AudioState::Ready : AudioState::Off, std::memory_order_release);
 }
 
 void initAudio()
 {
-    if (ma_engine_init(nullptr, &engine) == MA_SUCCESS)
-        ready = true;
+    if (loader.joinable() || state.load() != AudioState::Off)
+        return;
+    state.store(AudioState::Loading);
+    loader = std::thread(loadAudio);
 }
 
 void shutdownAudio()
 {
-    if (ready)
+    if (loader.joinable())
+        loader.join();
+    if (state.load() != AudioState::Ready)
+        return;
+    state.store(AudioState::Off);
+
+    for (Effect &effect : effects)
+    {
+        for (int i = 0; i < effect.loaded; ++i)
+            ma_sound_uninit(&effect.voices[i]);
+        effect.loaded = 0;
+        if (effect.registered)
+            ma_resource_manager_unregister_data(ma_engine_get_resource_manager(&engine),
+                                                effect.file);
+        effect.registered = false;
+    }
+    ma_engine_uninit(&engine);
+}
+
+void playSound(Sound sound)
+{
+    Effect &effect = effects[static_cast<int>(sound)];
+    if (state.load(std::memory_order_acquire) == AudioState::Loading)
     {
-        ma_engine_uninit(&engine);
-        ready = false;
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (state.load(std::memory_order_relaxed) == AudioState::Loading)
+        {
+            effect.pending++;
+            stats.queued++;
+            return;
+        }
     }
+    if (state.load(std::memory_order_acquire) == AudioState::Ready)
+        startVoice(effect);
 }
 
 void playDoorSound()
 {
-    if (!ready)
-        return;
-    ma_engine_play_sound(&engine, assetPath("SFXBible_12478.wav").string().c_str(), nullptr);
+    playSound(Sound::Door);
+}
+
+const AudioStats &audioStats()
+{
+    return stats;
 }
@@ -1,4 +1,38 @@
 #pragma once
+
+#include <chrono>
+#include <cstdint>
+
+enum class Sound
+{
+    Door,
+    Count,
+};
+
+// Key-to-audio cost: the time spent inside playSound, plus the device's output buffer, which
+// every sound waits behind before it is heard.
+struct AudioStats
+{
+    uint64_t plays = 0;
+    uint64_t stolen = 0; // plays that cut off a voice because the pool was busy
+    uint64_t totalTriggerNanos = 0;
+    uint64_t maxTriggerNanos = 0;
+    double outputLatencyMs = 0.0;
+    // Startup, all of it on the loading thread.
+    uint64_t queued = 0; // plays asked for before audio was ready
+    double unpackMs = 0.0;
+    double loadMs = 0.0; // opening the device, unpacking and decoding
+    std::chrono::steady_clock::time_point readyAt{};
+};
+
+// Opens the device and unpacks every sound effect from the embedded asset pack on a background
+// thread, and returns at once so the first frame doesn't wait for the audio driver.
 void initAudio();
+// Waits for loading to finish, then closes the device.
 void shutdownAudio();
+// Constant time and allocation-free once audio is ready; safe to call from the game loop.
+// Before then the sound is queued and starts as soon as loading finishes.
+void playSound(Sound sound);
 void playDoorSound();
+// Read it after shutdownAudio.
+const AudioStats &audioStats();
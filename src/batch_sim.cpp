@@ -0,0 +1,339 @@
+#include "batch_sim.hpp"
+
+#include "ai.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+
+#if defined(__clang__)
+#define LANES_INDEPENDENT _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define LANES_INDEPENDENT _Pragma("GCC ivdep")
+#else
+#define LANES_INDEPENDENT
+#endif
+
+namespace
+{
+
+constexpr int32_t RUNNING = static_cast<int32_t>(Outcome::Running);
+constexpr int32_t BATTERY_DIED = static_cast<int32_t>(Outcome::BatteryDied);
+constexpr int32_t FREDDO_GOT_IN = static_cast<int32_t>(Outcome::FreddoGotIn);
+constexpr int32_t CHICO_GOT_IN = static_cast<int32_t>(Outcome::ChicoGotIn);
+constexpr int32_t SURVIVED = static_cast<int32_t>(Outcome::Survived);
+
+// Values that are the same for every lane on a given tick.
+struct TickParams
+{
+    int hourWrap;
+    int32_t notDecided; // Survived once six hours have passed, Running before
+    int retreatThreshold;
+    uint32_t advanceChance;
+    int cooldownTicks;
+    int retreatCooldownTicks;
+    int baseDrain;
+    int doorDrain;
+    float toggleChance;
+};
+
+// Lane masks are all-ones or all-zeros, and selects are plain bit operations: GCC will not
+// if-convert the equivalent ternaries across this many fields, and the loop must stay
+// branch-free to vectorize.
+inline int32_t mask(bool condition) { return -static_cast<int32_t>(condition); }
+
+template <typename T> inline T select(int32_t lanes, T a, T b)
+{
+    const T m = static_cast<T>(lanes);
+    return (a & m) | (b & ~m);
+}
+
+// Branchless Animatronic::decide for one lane. Every lane computes the roll, but only lanes
+// that actually roll keep the advanced RNG state, so each stream matches the scalar one.
+template <int DOOR_ROOM, int MAX_POS>
+inline void decideLane(int32_t &pos, int32_t door, int32_t &cooldown, int32_t &blocked,
+                       uint32_t &s0, uint32_t &s1, uint32_t &s2, uint32_t &s3,
+                       const TickParams &p)
+{
+    const int32_t atDoorBlocked = mask(pos == DOOR_ROOM) & mask(door != 0);
+    const int32_t blockedNow = (blocked + 1) & atDoorBlocked;
+    const int32_t retreat = atDoorBlocked & mask(blockedNow * AGGRO_ONE >= p.retreatThreshold);
+
+    pos = select(retreat, std::max(1, pos - 2), pos);
+    blocked = blockedNow & ~retreat;
+    cooldown = select(retreat, p.retreatCooldownTicks, cooldown);
+
+    const int32_t roll = ~atDoorBlocked & mask(cooldown == 0);
+    uint32_t n0 = s0, n1 = s1, n2 = s2, n3 = s3;
+    const uint32_t r = Rng::step(n0, n1, n2, n3);
+    s0 = select(roll, n0, s0);
+    s1 = select(roll, n1, s1);
+    s2 = select(roll, n2, s2);
+    s3 = select(roll, n3, s3);
+
+    const int32_t advance = roll & mask(r < p.advanceChance);
+    pos = select(advance, std::min(pos + 1, MAX_POS), pos);
+    cooldown = select(advance, p.cooldownTicks, cooldown);
+}
+
+// POLICY is the policy acting on this tick (None between whole seconds).
+template <DoorPolicyKind POLICY, bool DECISION_TICK>
+void stepLanes(NightBatch &b, const TickParams &p)
+{
+    const size_t count = b.laneNight.size();
+    int32_t *battery = b.battery.data();
+    int32_t *accumulator = b.batteryAccumulator.data();
+    int32_t *freddoPos = b.freddoPos.data();
+    int32_t *chicoPos = b.chicoPos.data();
+    int32_t *leftDoor = b.leftDoor.data();
+    int32_t *rightDoor = b.rightDoor.data();
+    int32_t *freddoCooldown = b.freddoCooldown.data();
+    int32_t *freddoBlocked = b.freddoBlocked.data();
+    int32_t *chicoCooldown = b.chicoCooldown.data();
+    int32_t *chicoBlocked = b.chicoBlocked.data();
+    uint32_t *r0 = b.rng[0].data();
+    uint32_t *r1 = b.rng[1].data();
+    uint32_t *r2 = b.rng[2].data();
+    uint32_t *r3 = b.rng[3].data();
+    uint32_t *q0 = b.policyRng[0].data();
+    uint32_t *q1 = b.policyRng[1].data();
+    uint32_t *q2 = b.policyRng[2].data();
+    uint32_t *q3 = b.policyRng[3].data();
+    int32_t *outcome = b.laneOutcome.data();
+    int32_t *endTick = b.laneEndTick.data();
+    const int tick = b.tick;
+
+    // The arrays never overlap, but GCC gives up on run-time alias checks for this many.
+    LANES_INDEPENDENT
+    for (size_t i = 0; i < count; ++i)
+    {
+        int32_t fPos = freddoPos[i];
+        int32_t cPos = chicoPos[i];
+        int32_t left = leftDoor[i];
+        int32_t right = rightDoor[i];
+
+        if (POLICY == DoorPolicyKind::Scripted)
+        {
+            left = fPos >= 6;
+            right = cPos >= 7;
+        }
+        else if (POLICY == DoorPolicyKind::Random)
+        {
+            uint32_t a = q0[i], c = q1[i], d = q2[i], e = q3[i];
+            const int32_t flipLeft = Rng::toFloat(Rng::step(a, c, d, e)) < p.toggleChance;
+            const int32_t flipRight = Rng::toFloat(Rng::step(a, c, d, e)) < p.toggleChance;
+            q0[i] = a;
+            q1[i] = c;
+            q2[i] = d;
+            q3[i] = e;
+            left ^= flipLeft;
+            right ^= flipRight;
+        }
+
+        // advanceClock + drainBattery: at most one unit can drain per tick.
+        int32_t charge = battery[i] - p.hourWrap;
+        int32_t acc = accumulator[i] + p.baseDrain + p.doorDrain * (left + right);
+        const int32_t drained = mask(acc >= BATTERY_UNIT) & mask(charge > 0);
+        charge += drained;
+        acc -= BATTERY_UNIT & drained;
+
+        int32_t fCooldown = std::max(0, freddoCooldown[i] - 1);
+        int32_t cCooldown = std::max(0, chicoCooldown[i] - 1);
+
+        if (DECISION_TICK)
+        {
+            uint32_t s0 = r0[i], s1 = r1[i], s2 = r2[i], s3 = r3[i];
+            int32_t fBlocked = freddoBlocked[i];
+            int32_t cBlocked = chicoBlocked[i];
+            decideLane<6, 7>(fPos, left, fCooldown, fBlocked, s0, s1, s2, s3, p);
+            decideLane<7, 8>(cPos, right, cCooldown, cBlocked, s0, s1, s2, s3, p);
+            freddoBlocked[i] = fBlocked;
+            chicoBlocked[i] = cBlocked;
+            r0[i] = s0;
+            r1[i] = s1;
+            r2[i] = s2;
+            r3[i] = s3;
+        }
+
+        // nightOutcome, recorded only the first time a lane is decided.
+        int32_t result = p.notDecided;
+        result = select(mask(cPos == 8) & mask(right == 0), CHICO_GOT_IN, result);
+        result = select(mask(fPos == 7) & mask(left == 0), FREDDO_GOT_IN, result);
+        result = select(mask(charge <= 0), BATTERY_DIED, result);
+        const int32_t decidedNow = mask(outcome[i] == RUNNING) & mask(result != RUNNING);
+        outcome[i] = select(decidedNow, result, outcome[i]);
+        endTick[i] = select(decidedNow, tick, endTick[i]);
+
+        battery[i] = charge;
+        accumulator[i] = acc;
+        freddoPos[i] = fPos;
+        chicoPos[i] = cPos;
+        leftDoor[i] = left;
+        rightDoor[i] = right;
+        freddoCooldown[i] = fCooldown;
+        chicoCooldown[i] = cCooldown;
+    }
+}
+
+template <bool DECISION_TICK>
+void stepLanes(NightBatch &b, const TickParams &p, DoorPolicyKind policy)
+{
+    switch (policy)
+    {
+    case DoorPolicyKind::None:
+        stepLanes<DoorPolicyKind::None, DECISION_TICK>(b, p);
+        break;
+    case DoorPolicyKind::Scripted:
+        stepLanes<DoorPolicyKind::Scripted, DECISION_TICK>(b, p);
+        break;
+    case DoorPolicyKind::Random:
+        stepLanes<DoorPolicyKind::Random, DECISION_TICK>(b, p);
+        break;
+    }
+}
+
+template <typename T> void keepLanes(std::vector<T> &field, const std::vector<uint32_t> &kept)
+{
+    for (size_t to = 0; to < kept.size(); ++to)
+        field[to] = field[kept[to]];
+    field.resize(kept.size());
+}
+
+// Moves decided lanes' results out and packs the still-running lanes to the front, so the
+// kernel keeps doing useful work once most nights are over. Returns the running lane count.
+size_t compactLanes(NightBatch &b, bool flushAll)
+{
+    std::vector<uint32_t> kept;
+    kept.reserve(b.laneNight.size());
+    for (size_t lane = 0; lane < b.laneNight.size(); ++lane)
+    {
+        if (b.laneOutcome[lane] == RUNNING && !flushAll)
+        {
+            kept.push_back(static_cast<uint32_t>(lane));
+            continue;
+        }
+        b.outcome[b.laneNight[lane]] = b.laneOutcome[lane];
+        b.endTick[b.laneNight[lane]] = b.laneEndTick[lane];
+    }
+
+    if (kept.size() == b.laneNight.size())
+        return kept.size();
+
+    for (auto *field : {&b.battery, &b.batteryAccumulator, &b.freddoPos, &b.chicoPos, &b.leftDoor,
+                        &b.rightDoor, &b.freddoCooldown, &b.freddoBlocked, &b.chicoCooldown,
+                        &b.chicoBlocked, &b.laneOutcome, &b.laneEndTick})
+        keepLanes(*field, kept);
+    for (int w = 0; w < 4; ++w)
+    {
+        keepLanes(b.rng[w], kept);
+        keepLanes(b.policyRng[w], kept);
+    }
+    keepLanes(b.laneNight, kept);
+    return kept.size();
+}
+
+size_t runningLanes(const NightBatch &b)
+{
+    return static_cast<size_t>(std::count(b.laneOutcome.begin(), b.laneOutcome.end(), RUNNING));
+}
+
+} // namespace
+
+void startNightBatch(NightBatch &batch, size_t count, uint64_t seed, uint64_t firstIndex)
+{
+    const Night fresh;
+    const GameState &game = fresh.game;
+    const Freddo &freddo = std::get<Freddo>(fresh.animatronics);
+    const Chico &chico = std::get<Chico>(fresh.animatronics);
+
+    batch.battery.assign(count, game.battery);
+    batch.batteryAccumulator.assign(count, fresh.batteryAccumulator);
+    batch.freddoPos.assign(count, game.freddoPos);
+    batch.chicoPos.assign(count, game.chicoPos);
+    batch.leftDoor.assign(count, game.leftDoor);
+    batch.rightDoor.assign(count, game.rightDoor);
+    batch.freddoCooldown.assign(count, freddo.cooldown);
+    batch.freddoBlocked.assign(count, freddo.blockedTimer);
+    batch.chicoCooldown.assign(count, chico.cooldown);
+    batch.chicoBlocked.assign(count, chico.blockedTimer);
+    batch.laneOutcome.assign(count, RUNNING);
+    batch.laneEndTick.assign(count, 0);
+    batch.laneNight.resize(count);
+    batch.outcome.assign(count, RUNNING);
+    batch.endTick.assign(count, 0);
+    for (int w = 0; w < 4; ++w)
+    {
+        batch.rng[w].resize(count);
+        batch.policyRng[w].resize(count);
+    }
+
+    // Same streams as the scalar simulator's startNight / policy RNG for each night index.
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch.laneNight[i] = static_cast<uint32_t>(i);
+        Rng rng;
+        rng.seed(seed, firstIndex + i);
+        Rng policyRng;
+        policyRng.seed(~seed, firstIndex + i);
+        for (int w = 0; w < 4; ++w)
+        {
+            batch.rng[w][i] = rng.s[w];
+            batch.policyRng[w][i] = policyRng.s[w];
+        }
+    }
+
+    batch.tick = fresh.tick;
+    batch.hoursSurvived = game.hoursSurvived;
+    batch.hourTicks = game.hourTicks;
+    batch.aggro = freddo.aggro;
+    batch.decisionAcc = freddo.decisionAcc;
+}
+
+void runNightBatch(NightBatch &batch, const DoorPolicy &policy, int maxTicks)
+{
+    TickParams p{};
+    p.toggleChance = policy.toggleChance;
+    const Tuning &tuning = activeTuning();
+    p.retreatCooldownTicks = tuning.retreatCooldownTicks;
+    p.baseDrain = tuning.baseDrainPerTick;
+    p.doorDrain = tuning.doorDrainPerTick;
+
+    while (batch.tick < maxTicks)
+    {
+        const bool policyTick = batch.tick % TICKS_PER_SECOND == 0;
+        if (policyTick)
+        {
+            const size_t running = runningLanes(batch);
+            if (running == 0)
+                break;
+            if (running * 2 <= batch.laneNight.size())
+                compactLanes(batch, false);
+        }
+
+        // The shared half of advanceClock and Animatronic::update.
+        p.hourWrap = 0;
+        if (++batch.hourTicks >= TICKS_PER_HOUR)
+        {
+            batch.hourTicks = 0;
+            batch.hoursSurvived++;
+            p.hourWrap = 1;
+        }
+        batch.aggro = std::min(batch.aggro + aggroRatePerTick(batch.hoursSurvived), AGGRO_ONE);
+        const bool decisionTick = ++batch.decisionAcc >= DECISION_TICKS;
+        if (decisionTick)
+            batch.decisionAcc = 0;
+
+        p.notDecided = batch.hoursSurvived >= 6 ? SURVIVED : RUNNING;
+        p.retreatThreshold = retreatThreshold(batch.aggro);
+        p.advanceChance = advanceChance(batch.aggro);
+        p.cooldownTicks = cooldownTicks(batch.aggro);
+
+        const DoorPolicyKind acting = policyTick ? policy.kind : DoorPolicyKind::None;
+        if (decisionTick)
+            stepLanes<true>(batch, p, acting);
+        else
+            stepLanes<false>(batch, p, acting);
+
+        batch.tick++;
+    }
+    compactLanes(batch, true);
+}
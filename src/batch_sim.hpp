@@ -0,0 +1,55 @@
+#pragma once
+
+#include "door_policy.hpp"
+#include "game_state.hpp"
+#include "simulation.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Many nights in structure-of-arrays form, advanced together one tick per pass so the compiler
+// can vectorize across nights. Each lane reproduces runNightFixed for the same seed and night
+// index: same xoshiro128** stream, same rules, same outcome on the same tick. The rooms and
+// routes of the built-in map are compiled in (see hasDefaultRoutes).
+struct NightBatch
+{
+    // Per-lane state, one contiguous array per field (bools stored as 0/1 ints). Lanes whose
+    // night is decided get compacted away, so lane i is night laneNight[i].
+    std::vector<int32_t> battery;
+    std::vector<int32_t> batteryAccumulator;
+    std::vector<int32_t> freddoPos;
+    std::vector<int32_t> chicoPos;
+    std::vector<int32_t> leftDoor;
+    std::vector<int32_t> rightDoor;
+    std::vector<int32_t> freddoCooldown;
+    std::vector<int32_t> freddoBlocked;
+    std::vector<int32_t> chicoCooldown;
+    std::vector<int32_t> chicoBlocked;
+    std::vector<uint32_t> rng[4];
+    std::vector<uint32_t> policyRng[4];
+    std::vector<int32_t> laneOutcome;
+    std::vector<int32_t> laneEndTick;
+    std::vector<uint32_t> laneNight;
+
+    // Results per night (index relative to firstIndex): the outcome and the tick it was decided
+    // on, or Running if maxTicks passed first.
+    std::vector<int32_t> outcome;
+    std::vector<int32_t> endTick;
+
+    // All nights start together, so the clock, aggro and decision timing are the same in every
+    // lane and are kept once instead of per night.
+    int tick = 0;
+    int hoursSurvived = 0;
+    int hourTicks = 0;
+    int aggro = 0;
+    int decisionAcc = 0;
+
+    size_t size() const { return outcome.size(); }
+};
+
+// Lanes are nights firstIndex .. firstIndex + count - 1 of `seed`, as in startNight.
+void startNightBatch(NightBatch &batch, size_t count, uint64_t seed, uint64_t firstIndex);
+
+// Runs until every lane is decided or maxTicks pass.
+void runNightBatch(NightBatch &batch, const DoorPolicy &policy, int maxTicks = MAX_NIGHT_TICKS);
@@ -0,0 +1,534 @@
+// Benchmark suite: microbenchmarks for the AI, game-over check and UI rendering, plus whole
+// nights run headlessly. Prints a table, writes JSON with --json and, with --compare, flags
+// anything slower than a saved baseline.
+
+#include "ai.hpp"
+#include "animatronic.hpp"
+#include "door_policy.hpp"
+#include "event_sim.hpp"
+#include "game_state.hpp"
+#include "option_parse.hpp"
+#include "render.hpp"
+#include "room_graph.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+#include "spectator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ncurses/curses.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+struct BenchOptions
+{
+    const char *jsonPath = nullptr;
+    const char *baselinePath = nullptr;
+    const char *filter = nullptr;
+    double threshold = 10.0; // percent slower than baseline that counts as a regression
+};
+
+struct BenchResult
+{
+    std::string name;
+    double nsPerOp = 0.0;
+    uint64_t iterations = 0;
+};
+
+// Keeps the compiler from discarding a result or hoisting work out of the timing loop.
+template <typename T>
+static void keep(T &value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &value;
+#endif
+}
+
+// Only benchmarks whose names contain this run; null runs them all.
+static const char *benchFilter = nullptr;
+
+// Runs `body` in batches big enough to take ~20 ms, five times, and adds the median batch to
+// `results`. Skipped without running when --filter leaves it out.
+template <typename Body>
+static void runBench(std::vector<BenchResult> &results, const std::string &name, Body body)
+{
+    if (benchFilter && name.find(benchFilter) == std::string::npos)
+        return;
+
+    using clock = std::chrono::steady_clock;
+    auto timeBatch = [&](uint64_t iterations) {
+        const auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+            body(i);
+        return std::chrono::duration<double, std::nano>(clock::now() - start).count();
+    };
+
+    uint64_t iterations = 1;
+    while (timeBatch(iterations) < 20e6 && iterations < (uint64_t{1} << 40))
+        iterations *= 2;
+
+    double samples[5];
+    for (double &sample : samples)
+        sample = timeBatch(iterations) / iterations;
+    std::sort(std::begin(samples), std::end(samples));
+    results.push_back({name, samples[2], iterations});
+}
+
+// A night in the middle of the action: both animatronics awake, some battery gone.
+static GameState midNightState()
+{
+    GameState game = newGame();
+    game.hoursSurvived = 3;
+    game.hourTicks = TICKS_PER_HOUR / 2;
+    game.battery = 57;
+    game.freddoPos = 4;
+    game.chicoPos = 5;
+    return game;
+}
+
+// Both update paths from the same state and RNG stream must end up in the same place.
+static bool templateMatchesVirtual()
+{
+    GameState virtualGame = midNightState();
+    GameState templateGame = virtualGame;
+    Rng virtualRng, templateRng;
+    virtualRng.seed(3);
+    templateRng.seed(3);
+    FreddoAI freddo;
+    ChicoAI chico;
+    Animatronics animatronics;
+
+    for (int tick = 0; tick < 10 * TICKS_PER_HOUR; ++tick)
+    {
+        virtualGame.leftDoor = templateGame.leftDoor = (tick / 500) % 2 == 0;
+        virtualGame.rightDoor = templateGame.rightDoor = (tick / 700) % 2 == 0;
+        freddo.update(virtualGame, virtualRng);
+        chico.update(virtualGame, virtualRng);
+        forEachAnimatronic(animatronics, [&](auto &ai) { ai.update(templateGame, templateRng); });
+    }
+    const Freddo &f = std::get<Freddo>(animatronics);
+    const Chico &c = std::get<Chico>(animatronics);
+    return virtualGame.freddoPos == templateGame.freddoPos &&
+           virtualGame.chicoPos == templateGame.chicoPos && freddo.aggro == f.aggro &&
+           freddo.cooldown == f.cooldown && freddo.blockedTimer == f.blockedTimer &&
+           chico.aggro == c.aggro && chico.cooldown == c.cooldown &&
+           chico.blockedTimer == c.blockedTimer && virtualRng.s[0] == templateRng.s[0];
+}
+
+// One op is one tick for the whole cast, the way stepNight runs them.
+static void benchAI(std::vector<BenchResult> &results)
+{
+    if (!templateMatchesVirtual())
+        std::fprintf(stderr, "warning: template and virtual animatronics disagree\n");
+
+    GameState game = midNightState();
+    Rng rng;
+    rng.seed(1);
+    // Keep the animatronics roaming rather than parked at the office.
+    auto resetRooms = [&](uint64_t i) {
+        if ((i & 0xFFF) == 0)
+        {
+            game.freddoPos = 4;
+            game.chicoPos = 5;
+        }
+    };
+
+    FreddoAI freddo;
+    ChicoAI chico;
+    // Through base pointers, the way the old stepNight saw them, so the calls stay virtual.
+    AnimatronicAI *ais[2] = {&freddo, &chico};
+    keep(ais);
+    runBench(results, "ai_update_virtual", [&](uint64_t i) {
+        for (AnimatronicAI *ai : ais)
+            ai->update(game, rng);
+        resetRooms(i);
+        keep(game);
+    });
+
+    Animatronics animatronics;
+    runBench(results, "ai_update_template", [&](uint64_t i) {
+        forEachAnimatronic(animatronics, [&](auto &ai) { ai.update(game, rng); });
+        resetRooms(i);
+        keep(game);
+    });
+}
+
+// A side x side grid of rooms, both offices in the far corner, in the map file format.
+static std::string gridMap(int side)
+{
+    const int rooms = side * side;
+    std::string text;
+    for (int room = 1; room <= rooms; ++room)
+    {
+        text += "room " + std::to_string(room) + " - -\n";
+        if (room % side != 0)
+            text += "edge " + std::to_string(room) + " " + std::to_string(room + 1) + "\n";
+        if (room + side <= rooms)
+            text += "edge " + std::to_string(room) + " " + std::to_string(room + side) + "\n";
+    }
+    text +=
+        "animatronic freddo 1 " + std::to_string(rooms - 1) + " " + std::to_string(rooms) + "\n";
+    text += "animatronic chico 1 " + std::to_string(rooms - side) + " " + std::to_string(rooms) +
+            "\n";
+    return text;
+}
+
+// Per-tick AI cost should not grow with the map: moves are table lookups.
+static void benchMapSizes(std::vector<BenchResult> &results)
+{
+    for (int side : {4, 32, 256})
+    {
+        RoomGraph graph;
+        std::string error;
+        if (!parseRoomGraph(gridMap(side), graph, error))
+        {
+            std::fprintf(stderr, "grid map: %s\n", error.c_str());
+            continue;
+        }
+        setActiveRoomGraph(graph);
+
+        const int rooms = side * side;
+        GameState game = midNightState();
+        game.freddoPos = game.chicoPos = 1;
+        Rng rng;
+        rng.seed(1);
+        Animatronics animatronics;
+        const std::string name = "ai_update_map_" + std::to_string(rooms) + "_rooms";
+        runBench(results, name, [&](uint64_t i) {
+            forEachAnimatronic(animatronics, [&](auto &ai) { ai.update(game, rng); });
+            // Scatter them again now and then so moves keep landing on different rooms.
+            if ((i & 0xFFF) == 0)
+            {
+                game.freddoPos = static_cast<int>(i * 7919 % rooms) + 1;
+                game.chicoPos = static_cast<int>(i * 104729 % rooms) + 1;
+            }
+            keep(game);
+        });
+    }
+    setActiveRoomGraph(defaultRoomGraph());
+}
+
+static void benchGameOver(std::vector<BenchResult> &results)
+{
+    GameState game = midNightState();
+    runBench(results, "check_game_over", [&](uint64_t) {
+        bool over = checkGameOver(game);
+        keep(over);
+        keep(game);
+    });
+}
+
+// ncurses needs a terminal for has_colors and friends, so give it one on a pipe and render
+// into that pipe too, with a thread draining it like a real terminal would.
+struct PipeTerminal
+{
+    int readFd = -1;
+    std::FILE *output = nullptr;
+    SCREEN *screen = nullptr;
+    std::thread drain;
+};
+
+static bool openPipeTerminal(PipeTerminal &term)
+{
+    int fds[2];
+#ifdef _WIN32
+    if (_pipe(fds, 1 << 16, _O_BINARY) != 0)
+        return false;
+#else
+    if (pipe(fds) != 0)
+        return false;
+#endif
+    term.readFd = fds[0];
+    term.output = fdopen(fds[1], "w");
+    if (!term.output)
+        return false;
+
+    term.drain = std::thread([fd = fds[0]] {
+        char buf[4096];
+        while (read(fd, buf, sizeof buf) > 0)
+        {
+        }
+    });
+
+    term.screen = newterm("xterm-256color", term.output, stdin);
+    if (!term.screen)
+        term.screen = newterm("xterm", term.output, stdin);
+    if (!term.screen)
+        return false;
+    set_term(term.screen);
+    initTerminalColors();
+    setRenderOutput(term.output);
+    return true;
+}
+
+static void closePipeTerminal(PipeTerminal &term)
+{
+    setRenderOutput(stdout);
+    if (term.screen)
+    {
+        endwin();
+        delscreen(term.screen);
+    }
+    if (term.output)
+        std::fclose(term.output);
+    if (term.drain.joinable())
+        term.drain.join();
+    if (term.readFd >= 0)
+        close(term.readFd);
+}
+
+static void benchRender(std::vector<BenchResult> &results)
+{
+    PipeTerminal term;
+    if (!openPipeTerminal(term))
+    {
+        std::fprintf(stderr, "no terminal for the render benchmarks, skipping them\n");
+        closePipeTerminal(term);
+        return;
+    }
+
+    GameState game = midNightState();
+
+    // Nothing changed since the last frame: the diff finds no cells to send.
+    drawUI(game);
+    runBench(results, "draw_ui_unchanged", [&](uint64_t) { drawUI(game); });
+
+    // A door toggles every frame: a handful of cells change.
+    runBench(results, "draw_ui_door_toggle", [&](uint64_t i) {
+        game.leftDoor = (i & 1) != 0;
+        drawUI(game);
+    });
+
+    // Terminal contents unknown every frame: the whole screen is sent.
+    runBench(results, "draw_ui_full_repaint", [&](uint64_t) {
+        invalidateScreen();
+        drawUI(game);
+    });
+
+    closePipeTerminal(term);
+}
+
+// Broadcasting a frame to spectators: a delta of the door cells, or a keyframe of the whole
+// screen. No viewer is attached; the cost is the same with any number of them.
+static void benchSpectators(std::vector<BenchResult> &results)
+{
+    SpectatorWriter writer;
+    std::string error;
+    const std::string name =
+        "/s2s-bench-" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+    if (!openSpectatorWriter(writer, name.c_str(), error))
+    {
+        std::fprintf(stderr, "no shared memory for the spectator benchmarks (%s), skipping them\n",
+                     error.c_str());
+        return;
+    }
+
+    GameState game = midNightState();
+    static Framebuffer frames[2];
+    static CameraView camera;
+    drawNightFrame(frames[0], camera, game);
+    game.leftDoor = !game.leftDoor;
+    drawNightFrame(frames[1], camera, game);
+    publishFrame(writer, frames[0]);
+    runBench(results, "spectator_publish_delta",
+             [&](uint64_t i) { publishFrame(writer, frames[i & 1]); });
+
+    SpectatorReader reader;
+    static Framebuffer view;
+    if (openSpectatorReader(reader, name.c_str(), error))
+    {
+        runBench(results, "spectator_read_delta", [&](uint64_t i) {
+            publishFrame(writer, frames[i & 1]);
+            readFrames(reader, view);
+        });
+        closeSpectatorReader(reader);
+    }
+    closeSpectatorWriter(writer);
+}
+
+static void benchNights(std::vector<BenchResult> &results)
+{
+    DoorPolicy policy;
+    runBench(results, "night_fixed_scripted", [&](uint64_t i) {
+        Night night = startNight(1, i);
+        Rng policyRng;
+        policyRng.seed(~uint64_t{1}, i);
+        Outcome outcome = runNightFixed(night, policy, policyRng);
+        keep(outcome);
+    });
+    runBench(results, "night_event_scripted", [&](uint64_t i) {
+        Night night = startNight(1, i);
+        Rng policyRng;
+        policyRng.seed(~uint64_t{1}, i);
+        Outcome outcome = runNightEvents(night, policy, policyRng);
+        keep(outcome);
+    });
+}
+
+// Saving and restoring a whole mid-night state, and forking it into a branch that plays on.
+static void benchSnapshots(std::vector<BenchResult> &results)
+{
+    const int midNightTick = 3 * TICKS_PER_HOUR + TICKS_PER_HOUR / 2; // midNightState's clock
+    Night night = startNight(1);
+    night.game = midNightState();
+    runBench(results, "snapshot_take", [&](uint64_t i) {
+        night.tick = static_cast<int>(i);
+        NightSnapshot snapshot = takeSnapshot(night);
+        keep(snapshot);
+    });
+
+    night.tick = midNightTick;
+    const NightSnapshot snapshot = takeSnapshot(night);
+    Night restored;
+    runBench(results, "snapshot_restore", [&](uint64_t) {
+        restoreSnapshot(snapshot, restored);
+        keep(restored);
+    });
+
+    DoorPolicy policy;
+    runBench(results, "snapshot_fork_branch", [&](uint64_t i) {
+        Night branch;
+        restoreSnapshot(snapshot, branch);
+        reseedBranch(branch, 1, i);
+        Rng policyRng;
+        policyRng.seed(~uint64_t{1}, i);
+        Outcome outcome = runNightEvents(branch, policy, policyRng);
+        keep(outcome);
+    });
+}
+
+static bool writeJson(const char *path, const std::vector<BenchResult> &results)
+{
+    std::FILE *file = std::fopen(path, "w");
+    if (!file)
+        return false;
+    std::fprintf(file, "{\"benchmarks\":[\n");
+    for (size_t i = 0; i < results.size(); ++i)
+        std::fprintf(file, "  {\"name\":\"%s\",\"ns_per_op\":%.3f,\"iterations\":%llu}%s\n",
+                     results[i].name.c_str(), results[i].nsPerOp,
+                     static_cast<unsigned long long>(results[i].iterations),
+                     i + 1 < results.size() ? "," : "");
+    std::fprintf(file, "]}\n");
+    return std::fclose(file) == 0;
+}
+
+// Reads back what writeJson produced (one benchmark per line).
+static bool readJson(const char *path, std::vector<BenchResult> &results)
+{
+    std::FILE *file = std::fopen(path, "r");
+    if (!file)
+        return false;
+    char line[512];
+    while (std::fgets(line, sizeof line, file))
+    {
+        char name[128];
+        double ns;
+        unsigned long long iterations;
+        const char *start = std::strstr(line, "{\"name\":\"");
+        if (start && std::sscanf(start,
+                                 "{\"name\":\"%127[^\"]\",\"ns_per_op\":%lf,"
+                                 "\"iterations\":%llu",
+                                 name, &ns, &iterations) == 3)
+            results.push_back({name, ns, iterations});
+    }
+    std::fclose(file);
+    return true;
+}
+
+static bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--json") == 0 && hasValue)
+            options.jsonPath = argv[++i];
+        else if (std::strcmp(arg, "--compare") == 0 && hasValue)
+            options.baselinePath = argv[++i];
+        else if (std::strcmp(arg, "--threshold") == 0 && hasValue)
+        {
+            if (!parseReal(argv[++i], 0.0, 1000.0, options.threshold))
+                return false;
+        }
+        else if (std::strcmp(arg, "--filter") == 0 && hasValue)
+            options.filter = argv[++i];
+        else
+            return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--json FILE] [--compare BASELINE.json] [--threshold PERCENT]\n"
+                     "          [--filter SUBSTRING]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::vector<BenchResult> baseline;
+    if (options.baselinePath && !readJson(options.baselinePath, baseline))
+    {
+        std::fprintf(stderr, "%s: cannot read baseline\n", options.baselinePath);
+        return 2;
+    }
+
+    std::vector<BenchResult> results;
+    benchFilter = options.filter;
+    benchAI(results);
+    benchMapSizes(results);
+    benchGameOver(results);
+    benchRender(results);
+    benchSpectators(results);
+    benchNights(results);
+    benchSnapshots(results);
+
+    int regressions = 0;
+    for (const BenchResult &result : results)
+    {
+        std::printf("%-24s %14.1f ns/op", result.name.c_str(), result.nsPerOp);
+
+        const auto old = std::find_if(baseline.begin(), baseline.end(),
+                                      [&](const BenchResult &b) { return b.name == result.name; });
+        if (old != baseline.end() && old->nsPerOp > 0)
+        {
+            const double change = 100.0 * (result.nsPerOp / old->nsPerOp - 1.0);
+            const bool regressed = change > options.threshold;
+            regressions += regressed;
+            std::printf("  %+7.1f%% vs baseline%s", change, regressed ? "  REGRESSION" : "");
+        }
+        std::printf("\n");
+    }
+
+    std::printf("NightSnapshot: %zu bytes\n", sizeof(NightSnapshot));
+
+    if (options.jsonPath && !writeJson(options.jsonPath, results))
+    {
+        std::fprintf(stderr, "Could not write %s\n", options.jsonPath);
+        return 2;
+    }
+    if (regressions > 0)
+        std::printf("%d benchmark(s) more than %.0f%% slower than the baseline\n", regressions,
+                    options.threshold);
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,304 @@
+#include "bot.hpp"
+
+#include "event_sim.hpp"
+#include "work_stealing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+// Exploration weight in UCB1; rewards are in [0, 1].
+constexpr double UCB_EXPLORATION = 0.7;
+// Among lines that survive, the one that keeps more battery scores a little higher, so the bot
+// doesn't sit behind closed doors when it makes no difference.
+constexpr double BATTERY_BONUS = 0.01;
+// Iterations through a node before the search looks past the rollout policy's choice there.
+constexpr uint32_t WIDEN_VISITS = 32;
+
+template <typename AI>
+static void trackAI(AI &ai, const GameState &game, const GameState &after)
+{
+    ai.aggro = std::min(ai.aggro + ai.aggroRate(game), AGGRO_ONE);
+    if (ai.cooldown > 0)
+        ai.cooldown--;
+    if (++ai.decisionAcc < DECISION_TICKS)
+        return;
+    ai.decisionAcc = 0;
+
+    // Whether it moved is the roll's result; everything else in a decision is deterministic.
+    const bool moved = AI::position(after) != AI::position(game);
+    if (AI::atDoor(game) && AI::isBlocked(game))
+    {
+        ai.blockedTimer++;
+        if (moved)
+        {
+            ai.blockedTimer = 0;
+            ai.cooldown = activeTuning().retreatCooldownTicks;
+        }
+        return;
+    }
+    ai.blockedTimer = 0;
+    if (moved)
+        ai.cooldown = cooldownTicks(ai.aggro);
+}
+
+void startBot(MctsBot &bot, const GameState &game)
+{
+    if (bot.options.threads == 0)
+        bot.options.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    Night &belief = bot.belief;
+    belief = Night{};
+    belief.tick = game.hoursSurvived * TICKS_PER_HOUR + game.hourTicks;
+
+    // Replay the clock alone: aggro and the decision phase depend on nothing else.
+    GameState clock = newGame();
+    for (int tick = 0; tick < belief.tick; ++tick)
+    {
+        advanceClock(clock);
+        forEachAnimatronic(belief.animatronics, [&](auto &ai) {
+            ai.aggro = std::min(ai.aggro + ai.aggroRate(clock), AGGRO_ONE);
+            ai.decisionAcc = (ai.decisionAcc + 1) % DECISION_TICKS;
+        });
+    }
+    belief.game = game;
+}
+
+void botObserve(MctsBot &bot, const GameState &before, const GameState &after)
+{
+    // stepNight's order: clock, battery, then each animatronic.
+    Night &belief = bot.belief;
+    GameState game = before;
+    advanceClock(game);
+    drainBattery(game, belief.batteryAccumulator, batteryDrainPerTick(game));
+    forEachAnimatronic(belief.animatronics, [&](auto &ai) { trackAI(ai, game, after); });
+    belief.game = after;
+    belief.tick++;
+}
+
+// Door settings are bit masks: bit 0 the left door closed, bit 1 the right.
+template <typename AI>
+static int doorBit(const AI &)
+{
+    return AI::spec.door == DoorSide::Left ? 1 : 2;
+}
+
+static void setDoors(GameState &game, int doors)
+{
+    game.leftDoor = (doors & 1) != 0;
+    game.rightDoor = (doors & 2) != 0;
+}
+
+// Doors worth deciding about this second. An animatronic two or more rooms out can't be at its
+// door when it next decides, so shutting that door would only cost battery.
+static int doorsThatMatter(const Night &night)
+{
+    int doors = 0;
+    forEachAnimatronic(night.animatronics, [&](const auto &ai) {
+        if (ai.route().distance[ai.position(night.game)] <= 1)
+            doors |= doorBit(ai);
+    });
+    return doors;
+}
+
+// The rollout policy: scripted play that knows what the bot has worked out. A door is shut for
+// a second only if its animatronic will be able to advance at that second's decision (its
+// cooldown runs out), or is already waiting there and may give up.
+static int rolloutDoors(const Night &night)
+{
+    int doors = 0;
+    forEachAnimatronic(night.animatronics, [&](const auto &ai) {
+        const int distance = ai.route().distance[ai.position(night.game)];
+        if (distance == 0 ||
+            (distance == 1 && (ai.blockedTimer > 0 || ai.cooldown <= TICKS_PER_SECOND)))
+            doors |= doorBit(ai);
+    });
+    return doors;
+}
+
+static Outcome playOut(Night &night, Rng &policyRng)
+{
+    const DoorPolicy noDoors{DoorPolicyKind::None};
+    Outcome outcome = nightOutcome(night.game);
+    while (outcome == Outcome::Running && night.tick < MAX_NIGHT_TICKS)
+    {
+        setDoors(night.game, rolloutDoors(night));
+        outcome = runNightEvents(night, noDoors, policyRng,
+                                 std::min(night.tick + TICKS_PER_SECOND, MAX_NIGHT_TICKS));
+    }
+    return outcome;
+}
+
+// Which door setting to follow from `node`, out of those that only shut doors in `allowed`.
+// Until a node has been through WIDEN_VISITS iterations it follows the rollout policy; after
+// that it tries the other settings once each, then picks by UCB1. Returns -(setting + 1) for a
+// setting that has no child yet.
+static int pickDoors(const std::vector<BotTreeNode> &tree, const BotTreeNode &node, int allowed,
+                     int fallback)
+{
+    uint32_t visits = 0;
+    for (int setting = 0; setting < 4; ++setting)
+    {
+        if ((setting & ~allowed) == 0 && node.children[setting] >= 0)
+            visits += tree[node.children[setting]].visits;
+    }
+    if (visits < WIDEN_VISITS)
+        return node.children[fallback] >= 0 ? fallback : -(fallback + 1);
+
+    for (int setting = 0; setting < 4; ++setting)
+    {
+        if ((setting & ~allowed) == 0 && node.children[setting] < 0)
+            return -(setting + 1);
+    }
+
+    const double logVisits = std::log(static_cast<double>(visits));
+    int best = fallback;
+    double bestScore = -1.0;
+    for (int setting = 0; setting < 4; ++setting)
+    {
+        if ((setting & ~allowed) != 0)
+            continue;
+        const BotTreeNode &option = tree[node.children[setting]];
+        const double score = option.reward / option.visits +
+                             UCB_EXPLORATION * std::sqrt(logVisits / option.visits);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = setting;
+        }
+    }
+    return best;
+}
+
+// Open-loop search: nodes are lines of door settings rather than states, since the same line
+// leads to different nights under different rolls. Each iteration rolls a fresh RNG for the
+// night, walks the tree one second per node, adds one node and plays the rest of the night out.
+static uint64_t growTree(std::vector<BotTreeNode> &tree, const Night &root, Rng &seeds,
+                         std::chrono::steady_clock::time_point deadline)
+{
+    const DoorPolicy noDoors{DoorPolicyKind::None};
+    tree.assign(1, BotTreeNode{{-1, -1, -1, -1}, 0, 0.0});
+
+    int32_t path[MAX_NIGHT_TICKS / TICKS_PER_SECOND + 2];
+    uint64_t rollouts = 0;
+    while (rollouts == 0 || std::chrono::steady_clock::now() < deadline)
+    {
+        Night night = root;
+        night.rng.seed(seeds.next() | static_cast<uint64_t>(seeds.next()) << 32);
+        Rng policyRng;
+
+        int depth = 0;
+        path[depth++] = 0;
+        Outcome outcome = Outcome::Running;
+        bool expanded = false;
+        while (outcome == Outcome::Running && !expanded && night.tick < MAX_NIGHT_TICKS)
+        {
+            const int32_t parent = path[depth - 1];
+            int doors = pickDoors(tree, tree[parent], doorsThatMatter(night), rolloutDoors(night));
+            if (doors < 0)
+            {
+                doors = -doors - 1;
+                tree[parent].children[doors] = static_cast<int32_t>(tree.size());
+                tree.push_back(BotTreeNode{{-1, -1, -1, -1}, 0, 0.0});
+                expanded = true;
+            }
+
+            path[depth++] = tree[parent].children[doors];
+            setDoors(night.game, doors);
+            outcome = runNightEvents(night, noDoors, policyRng,
+                                     std::min(night.tick + TICKS_PER_SECOND, MAX_NIGHT_TICKS));
+        }
+        if (outcome == Outcome::Running)
+            outcome = playOut(night, policyRng);
+
+        const double reward =
+            outcome == Outcome::Survived ? 1.0 - BATTERY_BONUS * (100 - night.game.battery) / 100
+                                         : 0.0;
+        for (int i = 0; i < depth; ++i)
+        {
+            tree[path[i]].visits++;
+            tree[path[i]].reward += reward;
+        }
+        rollouts++;
+    }
+    return rollouts;
+}
+
+static int searchDoors(MctsBot &bot)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline =
+        start + std::chrono::nanoseconds(static_cast<int64_t>(bot.options.budgetMs * 1e6));
+
+    WorkStealingPool<unsigned> pool(bot.options.threads);
+    bot.trees.resize(pool.workers());
+    std::vector<uint64_t> rollouts(pool.workers());
+    for (unsigned tree = 0; tree < pool.workers(); ++tree)
+        pool.push(tree, tree);
+    pool.run([&](unsigned tree, unsigned) {
+        setActiveTuning(*bot.tuning);
+        Rng seeds;
+        seeds.seed(bot.options.seed, bot.stats.decisions * pool.workers() + tree);
+        rollouts[tree] = growTree(bot.trees[tree], bot.belief, seeds, deadline);
+    });
+
+    // The rollout policy's setting stands unless another one survives clearly more often:
+    // by two standard errors, pooled over all trees.
+    uint64_t visits[4] = {};
+    double reward[4] = {};
+    for (const auto &tree : bot.trees)
+    {
+        for (int setting = 0; setting < 4; ++setting)
+        {
+            const int32_t child = tree[0].children[setting];
+            if (child >= 0)
+            {
+                visits[setting] += tree[child].visits;
+                reward[setting] += tree[child].reward;
+            }
+        }
+    }
+    const int fallback = rolloutDoors(bot.belief);
+    int doors = fallback;
+    double bestMargin = 0.0;
+    for (int setting = 0; setting < 4; ++setting)
+    {
+        if (setting == fallback || visits[setting] == 0 || visits[fallback] == 0)
+            continue;
+        const double mean = reward[setting] / visits[setting];
+        const double base = reward[fallback] / visits[fallback];
+        const double spread = std::sqrt(mean * (1.0 - mean) / visits[setting] +
+                                        base * (1.0 - base) / visits[fallback]);
+        const double margin = mean - base - 2.0 * spread;
+        if (margin > bestMargin)
+        {
+            bestMargin = margin;
+            doors = setting;
+        }
+    }
+
+    bot.stats.decisions++;
+    for (uint64_t n : rollouts)
+        bot.stats.rollouts += n;
+    bot.stats.thinking += std::chrono::steady_clock::now() - start;
+    return doors;
+}
+
+int botKeys(MctsBot &bot, const GameState &game, int keys[2])
+{
+    bot.belief.game = game;
+    const int choices = doorsThatMatter(bot.belief);
+    int doors = 0;
+    if (choices == 0)
+        bot.stats.forced++;
+    else
+        doors = searchDoors(bot);
+
+    int count = 0;
+    if (game.leftDoor != ((doors & 1) != 0))
+        keys[count++] = 'a';
+    if (game.rightDoor != ((doors & 2) != 0))
+        keys[count++] = 'd';
+    bot.stats.keys += count;
+    return count;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "simulation.hpp"
+#include "tuning.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// Automated player for soak and balance tests. It sees only what the player sees, the
+// GameState, and plays through the same keys handleInput takes. Once a second, if an
+// animatronic is close enough for a door to matter, it searches the door settings with Monte
+// Carlo tree search: each worker thread grows its own tree, every iteration guessing the one
+// thing the screen can't show (the RNG), playing a line of door choices a second at a time and
+// finishing the night with a cooldown-aware scripted policy. That policy's own choice stands
+// unless the pooled trees show another setting clearly survives more often.
+struct BotOptions
+{
+    unsigned threads = 0;   // 0: one per core
+    double budgetMs = 20.0; // thinking time per decision
+    uint64_t seed = 1;
+};
+
+struct BotStats
+{
+    uint64_t decisions = 0; // seconds it searched
+    uint64_t forced = 0;    // seconds with nobody near a door: both stay open, no search
+    uint64_t rollouts = 0;
+    uint64_t keys = 0;
+    std::chrono::nanoseconds thinking{0};
+};
+
+struct BotTreeNode
+{
+    int32_t children[4]; // by door setting: bit 0 left closed, bit 1 right closed; -1 if untried
+    uint32_t visits;
+    double reward;
+};
+
+struct MctsBot
+{
+    BotOptions options;
+    const Tuning *tuning = &defaultTuning(); // for the worker threads
+    // The night as far as the bot can tell: everything but the RNG, worked out from the clock
+    // and from watching the animatronics move.
+    Night belief;
+    std::vector<std::vector<BotTreeNode>> trees; // one per worker, reused between decisions
+    BotStats stats;
+};
+
+// Starts following a night from what is on screen. Aggro and the decision phase follow from
+// the clock; cooldowns, blocked timers and the battery's fraction are taken as zero, which is
+// exact at the start of a night and close enough for a resumed one.
+void startBot(MctsBot &bot, const GameState &game);
+// Call after every stepNight with the state just before and after it: the bot replays the
+// tick's clock, battery and AI timers and reads each animatronic's roll off its move.
+void botObserve(MctsBot &bot, const GameState &before, const GameState &after);
+// Call at the start of every second, before its stepNight. Thinks for the budget and writes
+// the keys to send through handleInput ('a', 'd') to `keys`; returns how many.
+int botKeys(MctsBot &bot, const GameState &game, int keys[2]);
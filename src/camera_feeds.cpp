@@ -0,0 +1,393 @@
+#include "camera_feeds.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+static constexpr char CAMERA_MAGIC[4] = {'S', '2', 'S', 'C'};
+static constexpr uint8_t CAMERA_VERSION = 1;
+static const char *const SPRITE_NAMES[2] = {"freddo", "chico"};
+
+// Keyframe: (run length 1..255, character) pairs covering every cell in order.
+static void encodeKeyframe(const char *cells, std::vector<uint8_t> &out)
+{
+    for (int i = 0; i < CAMERA_CELLS;)
+    {
+        int run = 1;
+        while (i + run < CAMERA_CELLS && run < 255 && cells[i + run] == cells[i])
+            run++;
+        out.push_back(static_cast<uint8_t>(run));
+        out.push_back(static_cast<uint8_t>(cells[i]));
+        i += run;
+    }
+}
+
+// Delta: (unchanged cells 0..255, changed cells 0..255, the changed characters) groups.
+static void encodeDelta(const char *before, const char *after, std::vector<uint8_t> &out)
+{
+    for (int i = 0; i < CAMERA_CELLS;)
+    {
+        int skip = 0;
+        while (i + skip < CAMERA_CELLS && skip < 255 && before[i + skip] == after[i + skip])
+            skip++;
+        i += skip;
+        int count = 0;
+        while (i + count < CAMERA_CELLS && count < 255 && before[i + count] != after[i + count])
+            count++;
+        out.push_back(static_cast<uint8_t>(skip));
+        out.push_back(static_cast<uint8_t>(count));
+        out.insert(out.end(), after + i, after + i + count);
+        i += count;
+    }
+}
+
+// Both decoders stop at the first run that would leave the frame; `cells` may be null to only
+// check the data. True if the runs cover the frame exactly.
+static bool decodeKeyframe(const uint8_t *in, uint32_t size, char *cells)
+{
+    int cell = 0;
+    for (uint32_t i = 0; i + 1 < size; i += 2)
+    {
+        const int run = in[i];
+        if (run == 0 || cell + run > CAMERA_CELLS)
+            return false;
+        if (cells)
+            std::memset(cells + cell, in[i + 1], run);
+        cell += run;
+    }
+    return size % 2 == 0 && cell == CAMERA_CELLS;
+}
+
+static bool applyDelta(const uint8_t *in, uint32_t size, char *cells)
+{
+    int cell = 0;
+    for (uint32_t i = 0; i + 1 < size;)
+    {
+        const int skip = in[i];
+        const int count = in[i + 1];
+        i += 2;
+        cell += skip;
+        if (cell + count > CAMERA_CELLS || i + count > size)
+            return false;
+        if (cells)
+            std::memcpy(cells + cell, in + i, count);
+        cell += count;
+        i += count;
+    }
+    return cell == CAMERA_CELLS;
+}
+
+bool loadCameraFeeds(std::vector<uint8_t> data, CameraFeeds &feeds, std::string &error)
+{
+    feeds.feedCount = 0;
+    feeds.data = std::move(data);
+    const uint8_t *in = feeds.data.data();
+    const size_t size = feeds.data.size();
+    size_t at = 8;
+    auto fail = [&](const char *why) {
+        error = why;
+        feeds.feedCount = 0;
+        return false;
+    };
+    auto has = [&](size_t bytes) { return at + bytes <= size; };
+
+    if (size < 8 || std::memcmp(in, CAMERA_MAGIC, 4) != 0)
+        return fail("not a camera feed file");
+    if (in[4] != CAMERA_VERSION || in[5] != CAMERA_ROWS || in[6] != CAMERA_COLS ||
+        in[7] > MAX_CAMERA_FEEDS)
+        return fail("camera feeds from a different version");
+
+    for (CameraSprite &sprite : feeds.sprites)
+    {
+        if (!has(2))
+            return fail("truncated sprite");
+        sprite.rows = in[at];
+        sprite.cols = in[at + 1];
+        at += 2;
+        if (sprite.rows > SPRITE_ROWS || sprite.cols > SPRITE_COLS ||
+            !has(static_cast<size_t>(sprite.rows) * sprite.cols))
+            return fail("bad sprite");
+        for (int row = 0; row < sprite.rows; ++row, at += sprite.cols)
+            std::memcpy(sprite.cells[row], in + at, sprite.cols);
+    }
+
+    const int feedCount = in[7];
+    for (int f = 0; f < feedCount; ++f)
+    {
+        CameraFeed &feed = feeds.feeds[f];
+        if (!has(4))
+            return fail("truncated feed");
+        feed.room = in[at];
+        feed.spotRow = in[at + 1];
+        feed.spotCol = in[at + 2];
+        const int nameLength = in[at + 3];
+        at += 4;
+        if (nameLength >= CAMERA_NAME_SIZE || !has(nameLength + 1u))
+            return fail("bad feed name");
+        std::memcpy(feed.name, in + at, nameLength);
+        feed.name[nameLength] = '\0';
+        at += nameLength;
+        feed.frameCount = in[at++];
+        if (feed.frameCount < 1 || feed.frameCount > MAX_CAMERA_FRAMES)
+            return fail("bad frame count");
+
+        for (int frame = 0; frame < feed.frameCount; ++frame)
+        {
+            if (!has(2))
+                return fail("truncated frame");
+            const uint32_t bytes = in[at] | in[at + 1] << 8;
+            at += 2;
+            if (!has(bytes))
+                return fail("truncated frame");
+            const bool valid = frame == 0 ? decodeKeyframe(in + at, bytes, nullptr)
+                                          : applyDelta(in + at, bytes, nullptr);
+            if (!valid)
+                return fail("damaged frame");
+            feed.frameOffset[frame] = static_cast<uint32_t>(at);
+            feed.frameBytes[frame] = bytes;
+            at += bytes;
+        }
+    }
+    if (at != size)
+        return fail("trailing bytes");
+    feeds.feedCount = feedCount;
+    return true;
+}
+
+int findCameraFeed(const CameraFeeds &feeds, int room)
+{
+    for (int f = 0; f < feeds.feedCount; ++f)
+    {
+        if (feeds.feeds[f].room == room)
+            return f;
+    }
+    return -1;
+}
+
+const char *cameraFrame(const CameraFeeds &feeds, CameraFrameCache &cache, int feed, int frame)
+{
+    const uint64_t now = ++cache.uses;
+    CameraFrameCache::Slot *victim = &cache.slots[0];
+    CameraFrameCache::Slot *base = nullptr;
+    for (CameraFrameCache::Slot &slot : cache.slots)
+    {
+        if (slot.feed == feed && slot.frame == frame)
+        {
+            slot.lastUsed = now;
+            cache.hits++;
+            return slot.cells;
+        }
+        if (slot.feed == feed && slot.frame < frame && (!base || slot.frame > base->frame))
+            base = &slot;
+        if (slot.lastUsed < victim->lastUsed)
+            victim = &slot;
+    }
+
+    // Start from the closest earlier frame on hand, or the keyframe, and play the deltas
+    // forward. The victim may be the base itself, which is then updated in place.
+    const CameraFeed &source = feeds.feeds[feed];
+    const uint8_t *data = feeds.data.data();
+    int at = 0;
+    if (base)
+    {
+        at = base->frame;
+        if (base != victim)
+            std::memcpy(victim->cells, base->cells, CAMERA_CELLS);
+    }
+    else
+    {
+        decodeKeyframe(data + source.frameOffset[0], source.frameBytes[0], victim->cells);
+        cache.decodedFrames++;
+    }
+    while (at < frame)
+    {
+        at++;
+        applyDelta(data + source.frameOffset[at], source.frameBytes[at], victim->cells);
+        cache.decodedFrames++;
+    }
+    victim->feed = feed;
+    victim->frame = frame;
+    victim->lastUsed = now;
+    return victim->cells;
+}
+
+namespace
+{
+
+struct SourceFeed
+{
+    int room;
+    int spotRow;
+    int spotCol;
+    std::string name;
+    std::vector<std::vector<std::string>> frames;
+};
+
+} // namespace
+
+bool compileCameraFeeds(const std::string &text, std::vector<uint8_t> &out, std::string &error)
+{
+    std::vector<SourceFeed> feeds;
+    std::vector<std::string> sprites[2];
+    std::vector<std::string> *art = nullptr; // where `art` lines go
+    bool spriteSeen[2] = {};
+
+    std::istringstream lines(text);
+    std::string line;
+    for (int number = 1; std::getline(lines, line); ++number)
+    {
+        auto fail = [&](const std::string &why) {
+            error = "line " + std::to_string(number) + ": " + why;
+            return false;
+        };
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.compare(0, 4, "art ") == 0 || line == "art")
+        {
+            if (!art)
+                return fail("art outside a frame or sprite");
+            art->push_back(line.size() > 4 ? line.substr(4) : "");
+            continue;
+        }
+
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword) || keyword[0] == '#')
+            continue;
+
+        if (keyword == "feed")
+        {
+            SourceFeed feed;
+            if (!(words >> feed.room >> feed.spotRow >> feed.spotCol) || feed.room < 1 ||
+                feed.room > 255 || feed.spotRow < 0 || feed.spotRow >= CAMERA_ROWS ||
+                feed.spotCol < 0 || feed.spotCol >= CAMERA_COLS)
+                return fail("expected: feed <room> <spot row> <spot col> <name>");
+            std::getline(words >> std::ws, feed.name);
+            if (feed.name.empty() || feed.name.size() >= CAMERA_NAME_SIZE)
+                return fail("feed names are 1.." + std::to_string(CAMERA_NAME_SIZE - 1) +
+                            " characters");
+            for (const SourceFeed &other : feeds)
+                if (other.room == feed.room)
+                    return fail("two feeds for one room");
+            if (feeds.size() == MAX_CAMERA_FEEDS)
+                return fail("too many feeds");
+            feeds.push_back(feed);
+            art = nullptr;
+        }
+        else if (keyword == "frame")
+        {
+            if (feeds.empty())
+                return fail("frame before any feed");
+            if (feeds.back().frames.size() == MAX_CAMERA_FRAMES)
+                return fail("too many frames");
+            feeds.back().frames.emplace_back();
+            art = &feeds.back().frames.back();
+        }
+        else if (keyword == "sprite")
+        {
+            std::string name;
+            words >> name;
+            const auto found = std::find(std::begin(SPRITE_NAMES), std::end(SPRITE_NAMES), name);
+            if (found == std::end(SPRITE_NAMES))
+                return fail("unknown sprite (expected freddo or chico)");
+            const int index = static_cast<int>(found - std::begin(SPRITE_NAMES));
+            spriteSeen[index] = true;
+            art = &sprites[index];
+        }
+        else
+            return fail("unknown keyword");
+    }
+
+    for (int i = 0; i < 2; ++i)
+    {
+        if (!spriteSeen[i])
+        {
+            error = std::string("no sprite for ") + SPRITE_NAMES[i];
+            return false;
+        }
+        if (sprites[i].size() > SPRITE_ROWS ||
+            std::any_of(sprites[i].begin(), sprites[i].end(),
+                        [](const std::string &row) { return row.size() > SPRITE_COLS; }))
+        {
+            error = std::string(SPRITE_NAMES[i]) + "'s sprite is over " +
+                    std::to_string(SPRITE_ROWS) + "x" + std::to_string(SPRITE_COLS);
+            return false;
+        }
+    }
+    for (const SourceFeed &feed : feeds)
+    {
+        if (feed.frames.empty())
+        {
+            error = feed.name + " has no frames";
+            return false;
+        }
+        for (const auto &frame : feed.frames)
+        {
+            if (frame.size() > CAMERA_ROWS ||
+                std::any_of(frame.begin(), frame.end(),
+                            [](const std::string &row) { return row.size() > CAMERA_COLS; }))
+            {
+                error = "a frame of " + feed.name + " is over " + std::to_string(CAMERA_ROWS) +
+                        "x" + std::to_string(CAMERA_COLS);
+                return false;
+            }
+        }
+    }
+
+    out.assign(std::begin(CAMERA_MAGIC), std::end(CAMERA_MAGIC));
+    out.push_back(CAMERA_VERSION);
+    out.push_back(CAMERA_ROWS);
+    out.push_back(CAMERA_COLS);
+    out.push_back(static_cast<uint8_t>(feeds.size()));
+
+    for (const auto &sprite : sprites)
+    {
+        size_t cols = 0;
+        for (const std::string &row : sprite)
+            cols = std::max(cols, row.size());
+        out.push_back(static_cast<uint8_t>(sprite.size()));
+        out.push_back(static_cast<uint8_t>(cols));
+        for (std::string row : sprite)
+        {
+            row.resize(cols, ' ');
+            out.insert(out.end(), row.begin(), row.end());
+        }
+    }
+
+    char before[CAMERA_CELLS];
+    char after[CAMERA_CELLS];
+    std::vector<uint8_t> payload;
+    for (const SourceFeed &feed : feeds)
+    {
+        out.push_back(static_cast<uint8_t>(feed.room));
+        out.push_back(static_cast<uint8_t>(feed.spotRow));
+        out.push_back(static_cast<uint8_t>(feed.spotCol));
+        out.push_back(static_cast<uint8_t>(feed.name.size()));
+        out.insert(out.end(), feed.name.begin(), feed.name.end());
+        out.push_back(static_cast<uint8_t>(feed.frames.size()));
+
+        for (size_t f = 0; f < feed.frames.size(); ++f)
+        {
+            std::memset(after, ' ', CAMERA_CELLS);
+            for (size_t row = 0; row < feed.frames[f].size(); ++row)
+                std::memcpy(after + row * CAMERA_COLS, feed.frames[f][row].data(),
+                            feed.frames[f][row].size());
+
+            payload.clear();
+            if (f == 0)
+                encodeKeyframe(after, payload);
+            else
+                encodeDelta(before, after, payload);
+            if (payload.size() > 0xffff)
+            {
+                error = "a frame of " + feed.name + " doesn't compress";
+                return false;
+            }
+            out.push_back(static_cast<uint8_t>(payload.size()));
+            out.push_back(static_cast<uint8_t>(payload.size() >> 8));
+            out.insert(out.end(), payload.begin(), payload.end());
+            std::memcpy(before, after, CAMERA_CELLS);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Security camera feeds: a few frames of ASCII art per room, played in a loop, plus the
+// animatronic sprites drawn over them. console_fnaf_cameras compiles the text source in
+// cameras/ into one binary asset, "cameras.s2sc", which is embedded with the other assets.
+//
+// In the asset each feed's first frame is run-length coded and every later frame is stored as
+// the cells that changed since the frame before it. Frames are only decoded when shown, into a
+// small LRU cache, so memory stays bounded however many rooms and frames the feeds have.
+constexpr int CAMERA_ROWS = 9;
+constexpr int CAMERA_COLS = 40;
+constexpr int CAMERA_CELLS = CAMERA_ROWS * CAMERA_COLS;
+constexpr int MAX_CAMERA_FEEDS = 32;
+constexpr int MAX_CAMERA_FRAMES = 16;
+constexpr int CAMERA_NAME_SIZE = 24;
+constexpr int SPRITE_ROWS = 5;
+constexpr int SPRITE_COLS = 8;
+
+// Feeds animate at 10 frames per second.
+constexpr int CAMERA_FRAME_TICKS = 6;
+
+struct CameraFeed
+{
+    int room;
+    char name[CAMERA_NAME_SIZE];
+    int frameCount;
+    int spotRow; // where the first animatronic in the room stands, relative to the feed
+    int spotCol;
+    uint32_t frameOffset[MAX_CAMERA_FRAMES]; // into CameraFeeds::data
+    uint32_t frameBytes[MAX_CAMERA_FRAMES];
+};
+
+// A sprite's spaces are transparent.
+struct CameraSprite
+{
+    int rows;
+    int cols;
+    char cells[SPRITE_ROWS][SPRITE_COLS];
+};
+
+struct CameraFeeds
+{
+    std::vector<uint8_t> data; // the asset, which the frame offsets point into
+    CameraFeed feeds[MAX_CAMERA_FEEDS];
+    int feedCount = 0;
+    CameraSprite sprites[2]; // by route: FREDDO_ROUTE, CHICO_ROUTE
+};
+
+// Reads a compiled asset, checking every offset and run so a damaged one can't decode out of
+// bounds. On failure returns false and says why.
+bool loadCameraFeeds(std::vector<uint8_t> data, CameraFeeds &feeds, std::string &error);
+// The feed for `room`, or -1 if it has none.
+int findCameraFeed(const CameraFeeds &feeds, int room);
+
+// Decoded frames, least recently used first out. Decoding a frame starts from the nearest
+// earlier frame of the same feed still in the cache, or from the feed's first frame.
+struct CameraFrameCache
+{
+    static constexpr int SLOTS = 8;
+
+    struct Slot
+    {
+        int feed = -1;
+        int frame = -1;
+        uint64_t lastUsed = 0;
+        char cells[CAMERA_CELLS];
+    };
+
+    Slot slots[SLOTS];
+    uint64_t uses = 0;
+    uint64_t hits = 0;
+    uint64_t decodedFrames = 0; // keyframes and deltas applied, including intermediate ones
+};
+
+// The cells of `frame` in `feed`, CAMERA_ROWS rows of CAMERA_COLS; valid until the next call.
+const char *cameraFrame(const CameraFeeds &feeds, CameraFrameCache &cache, int feed, int frame);
+
+// Compiles the text source (see cameras/default.cam) into the asset format.
+bool compileCameraFeeds(const std::string &text, std::vector<uint8_t> &out, std::string &error);
@@ -0,0 +1,59 @@
+// Camera feed compiler: turns the text feeds in cameras/ into the cameras.s2sc asset, run-length
+// coded with per-frame deltas. The build runs it whenever the source changes.
+
+#include "camera_feeds.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::fprintf(stderr, "Usage: %s SOURCE.cam OUT.s2sc\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in)
+    {
+        std::fprintf(stderr, "%s: can't read the file\n", argv[1]);
+        return 1;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+
+    std::vector<uint8_t> compiled;
+    std::string error;
+    if (!compileCameraFeeds(text.str(), compiled, error))
+    {
+        std::fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+
+    // Check the result the way the game will read it.
+    CameraFeeds feeds;
+    if (!loadCameraFeeds(compiled, feeds, error))
+    {
+        std::fprintf(stderr, "%s: compiled feeds don't load: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+
+    std::FILE *out = std::fopen(argv[2], "wb");
+    if (!out || std::fwrite(compiled.data(), 1, compiled.size(), out) != compiled.size() ||
+        std::fclose(out) != 0)
+    {
+        std::fprintf(stderr, "%s: can't write the file\n", argv[2]);
+        return 1;
+    }
+
+    int frames = 0;
+    for (int f = 0; f < feeds.feedCount; ++f)
+        frames += feeds.feeds[f].frameCount;
+    std::printf("%d camera feeds, %d frames: %d cells -> %zu bytes\n", feeds.feedCount, frames,
+                frames * CAMERA_CELLS, compiled.size());
+    return 0;
+}
@@ -0,0 +1,57 @@
+#include "door_policy.hpp"
+
+#include "room_graph.hpp"
+
+#include <cstring>
+#include <initializer_list>
+
+const char *doorPolicyName(DoorPolicyKind kind)
+{
+    switch (kind)
+    {
+    case DoorPolicyKind::None:
+        return "none";
+    case DoorPolicyKind::Scripted:
+        return "scripted";
+    case DoorPolicyKind::Random:
+        return "random";
+    }
+    return "?";
+}
+
+bool parseDoorPolicy(const char *name, DoorPolicyKind &kind)
+{
+    for (DoorPolicyKind candidate :
+         {DoorPolicyKind::None, DoorPolicyKind::Scripted, DoorPolicyKind::Random})
+    {
+        if (std::strcmp(name, doorPolicyName(candidate)) == 0)
+        {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void applyDoorPolicy(const DoorPolicy &policy, GameState &game, Rng &policyRng)
+{
+    switch (policy.kind)
+    {
+    case DoorPolicyKind::None:
+        break;
+    case DoorPolicyKind::Scripted:
+    {
+        // Closed while the animatronic is at its door or already through it.
+        const RoomGraph &graph = activeRoomGraph();
+        game.leftDoor = graph.routes[FREDDO_ROUTE].distance[game.freddoPos] <= 1;
+        game.rightDoor = graph.routes[CHICO_ROUTE].distance[game.chicoPos] <= 1;
+        break;
+    }
+    case DoorPolicyKind::Random:
+        if (policyRng.nextFloat() < policy.toggleChance)
+            game.leftDoor = !game.leftDoor;
+        if (policyRng.nextFloat() < policy.toggleChance)
+            game.rightDoor = !game.rightDoor;
+        break;
+    }
+}
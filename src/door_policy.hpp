@@ -0,0 +1,24 @@
+#pragma once
+
+#include "game_state.hpp"
+#include "rng.hpp"
+
+// Scripted stand-ins for the player, used by the headless tools.
+enum class DoorPolicyKind
+{
+    None,     // never touches the doors
+    Scripted, // closes a door while its animatronic is at it
+    Random,   // flips each door with a fixed chance
+};
+
+struct DoorPolicy
+{
+    DoorPolicyKind kind = DoorPolicyKind::Scripted;
+    float toggleChance = 0.2f;
+};
+
+const char *doorPolicyName(DoorPolicyKind kind);
+bool parseDoorPolicy(const char *name, DoorPolicyKind &kind);
+
+// Policies look at the map once per second, on ticks that are a multiple of TICKS_PER_SECOND.
+void applyDoorPolicy(const DoorPolicy &policy, GameState &game, Rng &policyRng);
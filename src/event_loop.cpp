@@ -0,0 +1,92 @@
+#include "event_loop.hpp"
+
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+// Resets a timerfd/eventfd; true if it had fired.
+static bool drainCounter(int fd)
+{
+    uint64_t count;
+    return read(fd, &count, sizeof count) == sizeof count;
+}
+#endif
+
+void initEventLoop(EventLoop &loop)
+{
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC on Linux, so its time points can arm the timer directly.
+    loop.timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    loop.wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+#endif
+    loop.stats = LoopStats{};
+}
+
+void closeEventLoop(EventLoop &loop)
+{
+#ifdef __linux__
+    if (loop.timerFd >= 0)
+        close(loop.timerFd);
+    if (loop.wakeFd >= 0)
+        close(loop.wakeFd);
+#endif
+    loop.timerFd = -1;
+    loop.wakeFd = -1;
+}
+
+void wakeEventLoop(EventLoop &loop)
+{
+#ifdef __linux__
+    if (loop.wakeFd >= 0)
+    {
+        const uint64_t one = 1;
+        // Can only fail if the counter is saturated, and then the loop is already due to wake.
+        [[maybe_unused]] const ssize_t written = write(loop.wakeFd, &one, sizeof one);
+    }
+#else
+    (void)loop;
+#endif
+}
+
+void waitForEvent(EventLoop &loop, std::chrono::steady_clock::time_point deadline)
+{
+    using clock = std::chrono::steady_clock;
+    const auto start = clock::now();
+    if (deadline <= start)
+        return;
+
+#ifdef __linux__
+    if (loop.timerFd >= 0 && loop.wakeFd >= 0)
+    {
+        const auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            deadline.time_since_epoch());
+        itimerspec spec{};
+        spec.it_value.tv_sec = static_cast<time_t>(sinceEpoch.count() / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(sinceEpoch.count() % 1000000000);
+        timerfd_settime(loop.timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+        pollfd fds[2] = {{loop.timerFd, POLLIN, 0}, {loop.wakeFd, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0)
+            return;
+
+        drainCounter(loop.timerFd);
+        if (drainCounter(loop.wakeFd))
+            loop.stats.keyWakeups++;
+        loop.stats.wakeups++;
+        loop.stats.asleep += clock::now() - start;
+        return;
+    }
+#endif
+
+    // Without timerfd, sleep in frame-sized steps so keys are still picked up promptly.
+    const auto frameEnd = start + std::chrono::milliseconds(16);
+    std::this_thread::sleep_until(deadline < frameEnd ? deadline : frameEnd);
+    loop.stats.wakeups++;
+    loop.stats.asleep += clock::now() - start;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// How often the game loop woke and how much of the wall clock it spent awake.
+struct LoopStats
+{
+    uint64_t wakeups = 0;
+    uint64_t keyWakeups = 0; // woken by wakeEventLoop rather than the deadline
+    std::chrono::nanoseconds asleep{0};
+};
+
+// Lets the game loop sleep until the next thing that can change the screen: a key press or
+// the next scheduled game event. On Linux it blocks in poll() on an eventfd (keys) and a
+// timerfd (deadline); elsewhere it falls back to short sleeps.
+struct EventLoop
+{
+    int timerFd = -1;
+    int wakeFd = -1;
+    LoopStats stats;
+};
+
+void initEventLoop(EventLoop &loop);
+void closeEventLoop(EventLoop &loop);
+
+// Safe to call from any thread.
+void wakeEventLoop(EventLoop &loop);
+
+// Returns once `deadline` has passed or wakeEventLoop was called.
+void waitForEvent(EventLoop &loop, std::chrono::steady_clock::time_point deadline);
@@ -0,0 +1,107 @@
+#include "event_sim.hpp"
+
+#include "telemetry.hpp"
+
+#include <algorithm>
+
+// Smallest multiple of `period` that is >= tick.
+static int nextMultiple(int tick, int period) { return (tick + period - 1) / period * period; }
+
+static int nextHourTick(const Night &night)
+{
+    return night.tick + (TICKS_PER_HOUR - 1 - night.game.hourTicks);
+}
+
+static int nextBatteryTick(const Night &night)
+{
+    const int drain = batteryDrainPerTick(night.game);
+    const int missing = BATTERY_UNIT - night.batteryAccumulator;
+    return night.tick - 1 + (missing + drain - 1) / drain;
+}
+
+// First decision tick at which the AI would roll, move or touch blockedTimer. Decisions in
+// between only find the cooldown still running and change nothing.
+template <typename AI>
+static int nextDecisionTick(const Night &night, const AI &ai)
+{
+    const int first = night.tick + (DECISION_TICKS - 1 - ai.decisionAcc);
+    if (ai.blockedTimer != 0 || (ai.atDoor(night.game) && ai.isBlocked(night.game)))
+        return first;
+
+    // After the decrement on tick t the cooldown reads max(0, cooldown - (t - tick + 1)).
+    const int cooldownOver = night.tick + ai.cooldown - 1;
+    if (cooldownOver <= first)
+        return first;
+    return first + nextMultiple(cooldownOver - first, DECISION_TICKS);
+}
+
+int nextNightEvent(const Night &night, int maxTicks)
+{
+    int next = std::min(maxTicks, nextHourTick(night));
+    next = std::min(next, nextBatteryTick(night));
+    forEachAnimatronic(night.animatronics,
+                       [&](const auto &ai) { next = std::min(next, nextDecisionTick(night, ai)); });
+    return std::max(next, night.tick);
+}
+
+template <typename AI>
+static void skipAI(AI &ai, const GameState &game, int ticks)
+{
+    ai.aggro = std::min(AGGRO_ONE, ai.aggro + ai.aggroRate(game) * ticks);
+    ai.cooldown = std::max(0, ai.cooldown - ticks);
+    ai.decisionAcc = (ai.decisionAcc + ticks) % DECISION_TICKS;
+}
+
+void skipIdleTicks(Night &night, int ticks)
+{
+    if (ticks <= 0)
+        return;
+
+    night.game.hourTicks += ticks;
+    night.batteryAccumulator += batteryDrainPerTick(night.game) * ticks;
+    forEachAnimatronic(night.animatronics, [&](auto &ai) { skipAI(ai, night.game, ticks); });
+    night.tick += ticks;
+}
+
+Outcome runNightEvents(Night &night, const DoorPolicy &policy, Rng &policyRng, int maxTicks,
+                       TelemetryWriter *telemetry)
+{
+    Outcome outcome = nightOutcome(night.game);
+
+    // Positions the scripted policy last reacted to; it only needs to look again after a move.
+    int seenFreddo = -1;
+    int seenChico = -1;
+
+    while (outcome == Outcome::Running && night.tick < maxTicks)
+    {
+        int next = nextNightEvent(night, maxTicks);
+
+        int policyTick = maxTicks;
+        if (policy.kind == DoorPolicyKind::Random ||
+            (policy.kind == DoorPolicyKind::Scripted &&
+             (night.game.freddoPos != seenFreddo || night.game.chicoPos != seenChico)))
+            policyTick = nextMultiple(night.tick, TICKS_PER_SECOND);
+        next = std::min(next, policyTick);
+
+        skipIdleTicks(night, next - night.tick);
+        if (night.tick >= maxTicks)
+            break;
+
+        // From here on this is exactly one iteration of runNightFixed.
+        NightObservation before{};
+        if (telemetry)
+            before = observeNight(night);
+        if (night.tick % TICKS_PER_SECOND == 0)
+        {
+            applyDoorPolicy(policy, night.game, policyRng);
+            seenFreddo = night.game.freddoPos;
+            seenChico = night.game.chicoPos;
+        }
+
+        stepNight(night);
+        outcome = nightOutcome(night.game);
+        if (telemetry)
+            logNightChanges(*telemetry, before, night);
+    }
+    return outcome;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "door_policy.hpp"
+#include "simulation.hpp"
+
+struct TelemetryWriter;
+
+// Discrete-event version of runNightFixed. AIs only act once per second, the battery drops at
+// predictable ticks and hours are fixed-length, so instead of stepping all ~7,200 ticks it
+// schedules the next policy look, hour change, battery tick and AI decision, skips the idle
+// ticks in between in closed form and runs stepNight only on ticks where something happens.
+// The resulting Night is identical to runNightFixed's, RNG state included. With `telemetry`,
+// every step's changes are logged to it (the caller logs the night's start).
+Outcome runNightEvents(Night &night, const DoorPolicy &policy, Rng &policyRng,
+                       int maxTicks = MAX_NIGHT_TICKS, TelemetryWriter *telemetry = nullptr);
+
+// Next tick at which the night can change on its own (hour, battery or AI decision), or
+// maxTicks if none comes sooner. Ticks before it can be skipped with skipIdleTicks.
+int nextNightEvent(const Night &night, int maxTicks = MAX_NIGHT_TICKS);
+
+// Applies `ticks` ticks that are known to be idle, in O(1).
+void skipIdleTicks(Night &night, int ticks);
@@ -0,0 +1,137 @@
+#include "framebuffer.hpp"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+Framebuffer::Framebuffer()
+{
+    out.reserve(MAX_FRAME_BYTES);
+}
+
+void Framebuffer::clear()
+{
+    for (auto &row : cells)
+        for (Cell &cell : row)
+            cell = Cell{};
+}
+
+void Framebuffer::put(int row, int col, char ch, Color color, bool bold)
+{
+    if (row < 0 || row >= ROWS || col < 0 || col >= COLS)
+        return;
+    cells[row][col] = Cell{ch, color, bold};
+}
+
+void Framebuffer::print(int row, int col, const char *text, Color color, bool bold)
+{
+    for (; *text; ++text)
+        put(row, col++, *text, color, bold);
+}
+
+void enableTerminalEscapes()
+{
+#ifdef _WIN32
+    const HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    if (GetConsoleMode(console, &mode))
+        SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+// Black background to match the ncurses color pairs the UI used before.
+static const char *colorCode(Color color)
+{
+    switch (color)
+    {
+    case Color::Default:
+        break;
+    case Color::Red:
+        return ";31;40";
+    case Color::Green:
+        return ";32;40";
+    case Color::Yellow:
+        return ";33;40";
+    case Color::Cyan:
+        return ";36;40";
+    }
+    return "";
+}
+
+FrameStats encodeFrame(Framebuffer &fb)
+{
+    FrameStats stats;
+    std::string &out = fb.out;
+    out.clear();
+
+    if (fb.invalid)
+    {
+        out += "\x1b[0m\x1b[2J";
+        for (auto &row : fb.shown)
+            for (Cell &cell : row)
+                cell = Cell{};
+    }
+
+    // Cursor and attributes as the terminal has them; -1 means unknown.
+    int cursorRow = -1, cursorCol = -1;
+    Color color = Color::Default;
+    bool bold = false;
+    bool attrKnown = fb.invalid;
+    char buf[32];
+
+    for (int row = 0; row < Framebuffer::ROWS; ++row)
+    {
+        for (int col = 0; col < Framebuffer::COLS; ++col)
+        {
+            Cell cell = fb.cells[row][col];
+            if (!fb.useColor)
+                cell.color = Color::Default;
+            if (cell == fb.shown[row][col] && !(fb.invalid && cell.ch != ' '))
+                continue;
+
+            if (row != cursorRow || col != cursorCol)
+            {
+                std::snprintf(buf, sizeof buf, "\x1b[%d;%dH", row + 1, col + 1);
+                out += buf;
+            }
+            if (!attrKnown || cell.color != color || cell.bold != bold)
+            {
+                out += "\x1b[0";
+                if (cell.bold)
+                    out += ";1";
+                out += colorCode(cell.color);
+                out += 'm';
+                color = cell.color;
+                bold = cell.bold;
+                attrKnown = true;
+            }
+
+            out += cell.ch;
+            fb.shown[row][col] = cell;
+            cursorRow = row;
+            cursorCol = col + 1;
+            stats.cells++;
+        }
+    }
+    fb.invalid = false;
+
+    if (out.empty())
+        return stats;
+    if (color != Color::Default || bold)
+        out += "\x1b[0m";
+    stats.bytes = out.size();
+    return stats;
+}
+
+FrameStats presentFrame(Framebuffer &fb)
+{
+    const FrameStats stats = encodeFrame(fb);
+    if (stats.bytes == 0)
+        return stats;
+    std::fwrite(fb.out.data(), 1, fb.out.size(), fb.output);
+    std::fflush(fb.output);
+    return stats;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+enum class Color : unsigned char
+{
+    Default,
+    Red,
+    Green,
+    Yellow,
+    Cyan,
+};
+
+struct Cell
+{
+    char ch = ' ';
+    Color color = Color::Default;
+    bool bold = false;
+
+    bool operator==(const Cell &other) const
+    {
+        return ch == other.ch && color == other.color && bold == other.bold;
+    }
+    bool operator!=(const Cell &other) const { return !(*this == other); }
+};
+
+// What one presentFrame sent to the terminal.
+struct FrameStats
+{
+    int cells = 0;
+    size_t bytes = 0;
+};
+
+// In-memory copy of the screen. Draw the whole frame into `cells` each time; presentFrame
+// compares it with what the terminal already shows and writes only the cells that changed.
+struct Framebuffer
+{
+    static constexpr int ROWS = 24;
+    static constexpr int COLS = 80;
+    // Most a frame can take to encode: every cell with a cursor move ("\x1b[24;80H"), a full
+    // attribute change ("\x1b[0;1;33;40m") and its character, plus the clear and the reset.
+    static constexpr size_t MAX_FRAME_BYTES = ROWS * COLS * (8 + 12 + 1) + 16;
+
+    Cell cells[ROWS][COLS];
+    Cell shown[ROWS][COLS];
+    bool useColor = true;
+    // The terminal's contents are unknown (first frame, resize): clear it and send every cell.
+    bool invalid = true;
+    std::FILE *output = stdout;
+    std::string out; // sized for MAX_FRAME_BYTES up front, so drawing never allocates
+
+    Framebuffer();
+    void clear();
+    void put(int row, int col, char ch, Color color = Color::Default, bool bold = false);
+    void print(int row, int col, const char *text, Color color = Color::Default,
+               bool bold = false);
+};
+
+// Lets ANSI escape sequences through on consoles that need opting in (Windows).
+void enableTerminalEscapes();
+
+// Puts the ANSI sequences for the changed cells in fb.out and marks them as shown.
+FrameStats encodeFrame(Framebuffer &fb);
+
+// encodeFrame, then sends fb.out to fb.output in a single write.
+FrameStats presentFrame(Framebuffer &fb);
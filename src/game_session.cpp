@@ -0,0 +1,164 @@
+#include "game_session.hpp"
+
+#include "event_sim.hpp"
+#include "render.hpp"
+
+#include <algorithm>
+
+using Clock = GameSession::clock;
+
+constexpr auto GAME_OVER_HOLD = std::chrono::seconds(3);
+
+// Telnet commands are IAC (255) followed by a verb; WILL/WONT/DO/DONT carry one option byte
+// and SB starts a subnegotiation that runs to IAC SE.
+constexpr uint8_t TELNET_IAC = 255;
+constexpr uint8_t TELNET_SB = 250;
+constexpr uint8_t TELNET_SE = 240;
+enum TelnetState : uint8_t
+{
+    TELNET_DATA,
+    TELNET_VERB,
+    TELNET_OPTION,
+    TELNET_SUB,
+    TELNET_SUB_IAC,
+};
+
+// Wall-clock time by which simulation tick `tick` has fully elapsed, as in the game loop.
+static Clock::time_point tickEnd(const GameSession &session, int tick)
+{
+    return session.start +
+           std::chrono::nanoseconds(static_cast<int64_t>((tick + 1) * session.nanosPerTick));
+}
+
+static int completedTicks(const GameSession &session, Clock::time_point now)
+{
+    const double elapsed = std::chrono::duration<double, std::nano>(now - session.start).count();
+    return std::min(static_cast<int>(elapsed / session.nanosPerTick), MAX_NIGHT_TICKS);
+}
+
+void startSession(GameSession &session, uint64_t seed, uint64_t stream, double speed,
+                  Clock::time_point now)
+{
+    session.night = startNight(seed, stream);
+    session.start = now;
+    session.nanosPerTick = 1e9 / (TICKS_PER_SECOND * speed);
+    session.screen.invalid = true;
+    session.redraw = true;
+    session.over = false;
+    session.finished = false;
+    session.telnetState = TELNET_DATA;
+}
+
+static void sessionKey(GameSession &session, char key)
+{
+    GameState &game = session.night.game;
+    if (session.over)
+    {
+        session.finished = true;
+        return;
+    }
+    // The game's own keys; the server has no speakers, so a door closes silently.
+    applyKey(game, key);
+    session.finished = !game.running;
+    session.redraw = true;
+}
+
+void sessionInput(GameSession &session, const char *bytes, size_t size, Clock::time_point now)
+{
+    // Keys land on the tick in progress, so catch up to it first.
+    updateSession(session, now);
+    for (size_t i = 0; i < size && !session.finished; ++i)
+    {
+        const uint8_t byte = static_cast<uint8_t>(bytes[i]);
+        switch (session.telnetState)
+        {
+        case TELNET_DATA:
+            if (byte == TELNET_IAC)
+                session.telnetState = TELNET_VERB;
+            else
+                sessionKey(session, static_cast<char>(byte));
+            break;
+        case TELNET_VERB:
+            if (byte == TELNET_SB)
+                session.telnetState = TELNET_SUB;
+            else if (byte > TELNET_SB && byte < TELNET_IAC)
+                session.telnetState = TELNET_OPTION;
+            else
+                session.telnetState = TELNET_DATA;
+            break;
+        case TELNET_OPTION:
+            session.telnetState = TELNET_DATA;
+            break;
+        case TELNET_SUB:
+            if (byte == TELNET_IAC)
+                session.telnetState = TELNET_SUB_IAC;
+            break;
+        case TELNET_SUB_IAC:
+            session.telnetState = byte == TELNET_SE ? TELNET_DATA : TELNET_SUB;
+            break;
+        }
+    }
+}
+
+void updateSession(GameSession &session, Clock::time_point now)
+{
+    if (session.finished)
+        return;
+    if (session.over)
+    {
+        session.finished = now >= session.closeAt;
+        return;
+    }
+
+    Night &night = session.night;
+    const int target = completedTicks(session, now);
+    const int second = night.tick / TICKS_PER_SECOND;
+    const int frame = night.tick / CAMERA_FRAME_TICKS;
+    while (night.tick < target && nightOutcome(night.game) == Outcome::Running)
+    {
+        skipIdleTicks(night, nextNightEvent(night, target) - night.tick);
+        if (night.tick >= target)
+            break;
+        if (stepNight(night))
+            session.redraw = true;
+    }
+    if (night.tick / TICKS_PER_SECOND != second ||
+        (night.game.cameraUp && night.tick / CAMERA_FRAME_TICKS != frame))
+        session.redraw = true;
+
+    if (nightOutcome(night.game) != Outcome::Running)
+    {
+        session.over = true;
+        session.closeAt = now + GAME_OVER_HOLD;
+        session.redraw = true;
+    }
+}
+
+bool renderSession(GameSession &session)
+{
+    if (!session.redraw)
+        return false;
+    session.redraw = false;
+    if (session.over)
+        drawGameOverFrame(session.screen, nightOutcome(session.night.game));
+    else
+        drawNightFrame(session.screen, session.camera, session.night.game, false, false);
+    return encodeFrame(session.screen).bytes > 0;
+}
+
+Clock::time_point sessionWake(const GameSession &session)
+{
+    // Nothing left to simulate; the server only has to send the last bytes.
+    if (session.finished)
+        return Clock::time_point::max();
+    if (session.over)
+        return session.closeAt;
+    // The night's next change of its own, the clock's next second or the camera's next frame.
+    const Night &night = session.night;
+    int wakeTick = std::min(nextNightEvent(night),
+                            (night.tick / TICKS_PER_SECOND + 1) * TICKS_PER_SECOND - 1);
+    if (night.game.cameraUp)
+        wakeTick = std::min(wakeTick,
+                            (night.tick / CAMERA_FRAME_TICKS + 1) * CAMERA_FRAME_TICKS - 1);
+    return tickEnd(session, wakeTick);
+}
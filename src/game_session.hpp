@@ -0,0 +1,48 @@
+#pragma once
+
+#include "framebuffer.hpp"
+#include "render.hpp"
+#include "simulation.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// One player's night as the server runs it: the Night, the screen the player's terminal shows
+// and the wall clock the night runs against. It knows nothing about sockets; the server feeds
+// it the bytes the player typed and sends whatever it leaves in screen.out.
+struct GameSession
+{
+    using clock = std::chrono::steady_clock;
+
+    Night night;
+    Framebuffer screen;
+    CameraView camera;
+    clock::time_point start;
+    double nanosPerTick = 1e9 / TICKS_PER_SECOND;
+    bool redraw = true;
+    bool over = false;     // showing the game-over message
+    bool finished = false; // quit, or the game-over message has been up long enough
+    clock::time_point closeAt;
+    uint8_t telnetState = 0; // position inside a telnet command being skipped
+};
+
+// Starts a night at `now`. `speed` works like the game's --speed.
+void startSession(GameSession &session, uint64_t seed, uint64_t stream, double speed,
+                  GameSession::clock::time_point now);
+
+// Applies keys typed by the player, on the tick in progress at `now`: the game's keys (see
+// applyKey) and any key to dismiss the game-over message. Telnet commands are skipped.
+void sessionInput(GameSession &session, const char *bytes, size_t size,
+                  GameSession::clock::time_point now);
+
+// Runs every tick that has elapsed by `now` and moves to the game-over message (held for three
+// seconds) once the night is decided.
+void updateSession(GameSession &session, GameSession::clock::time_point now);
+
+// Draws the screen if it changed and encodes it into screen.out. False if there is nothing to
+// send.
+bool renderSession(GameSession &session);
+
+// When updateSession next has something to do unless a key comes first.
+GameSession::clock::time_point sessionWake(const GameSession &session);
@@ -1,7 +1,139 @@
 #include "game_state.hpp"
 
+#include "room_graph.hpp"
+#include "tuning.hpp"
+
+// Every room drawn on the map has a camera.
+static int firstCamera(const RoomGraph &graph)
+{
+    for (int room = 1; room <= graph.roomCount; ++room)
+    {
+        if (graph.drawn(room))
+            return room;
+    }
+    return 0;
+}
+
+GameState newGame()
+{
+    const RoomGraph &graph = activeRoomGraph();
+    return GameState{
+        true,  // running
+        100,   // battery
+        0,     // hoursSurvived
+        0,     // hourTicks
+        graph.routes[FREDDO_ROUTE].spawn, // freddoPos
+        graph.routes[CHICO_ROUTE].spawn,  // chicoPos
+        false, // leftDoor
+        false, // rightDoor
+        false, // cameraUp
+        firstCamera(graph)
+    };
+}
+
 void updateTime(GameState &game)
 {
     game.battery -= 1;
     game.hoursSurvived++;
 }
+
+// Advances one tick. Returns true when the hour ticked over.
+bool advanceClock(GameState &game)
+{
+    if (++game.hourTicks < TICKS_PER_HOUR)
+        return false;
+
+    game.hourTicks = 0;
+    updateTime(game);
+    return true;
+}
+
+int batteryDrainPerTick(const GameState &game)
+{
+    const int state = (game.leftDoor ? DRAIN_LEFT_DOOR : 0) |
+                      (game.rightDoor ? DRAIN_RIGHT_DOOR : 0) | (game.cameraUp ? DRAIN_CAMERA : 0);
+    return activeCurves().drainPerTick[state];
+}
+
+// Adds `drain` to the accumulator. Returns true when a unit of battery was used up.
+bool drainBattery(GameState &game, int &batteryAccumulator, int drain)
+{
+    batteryAccumulator += drain;
+
+    bool drained = false;
+    while (batteryAccumulator >= BATTERY_UNIT && game.battery > 0)
+    {
+        game.battery -= 1;
+        batteryAccumulator -= BATTERY_UNIT;
+        drained = true;
+    }
+    return drained;
+}
+
+Outcome nightOutcome(const GameState &game)
+{
+    if (game.battery <= 0)
+        return Outcome::BatteryDied;
+    const RoomGraph &graph = activeRoomGraph();
+    if (game.freddoPos == graph.routes[FREDDO_ROUTE].officeRoom && !game.leftDoor)
+        return Outcome::FreddoGotIn;
+    if (game.chicoPos == graph.routes[CHICO_ROUTE].officeRoom && !game.rightDoor)
+        return Outcome::ChicoGotIn;
+    if (game.hoursSurvived >= 6)
+        return Outcome::Survived;
+    return Outcome::Running;
+}
+
+// The next room along, in either direction, that has a camera.
+static int nextCamera(int camera, int step)
+{
+    const RoomGraph &graph = activeRoomGraph();
+    for (int i = 0, room = camera; i < graph.roomCount; ++i)
+    {
+        room = (room - 1 + step + graph.roomCount) % graph.roomCount + 1;
+        if (graph.drawn(room))
+            return room;
+    }
+    return camera;
+}
+
+bool applyKey(GameState &game, int key)
+{
+    switch (key)
+    {
+    case 'a':
+    case 'A':
+        game.leftDoor = !game.leftDoor;
+        return game.leftDoor;
+
+    case 'd':
+    case 'D':
+        game.rightDoor = !game.rightDoor;
+        return game.rightDoor;
+
+    case 'c':
+    case 'C':
+        game.cameraUp = !game.cameraUp;
+        break;
+
+    case '<':
+    case '>':
+        game.camera = nextCamera(game.camera, key == '<' ? -1 : 1);
+        break;
+
+    case 'q':
+    case 'Q':
+        game.running = false;
+        break;
+
+    default:
+        // A room's number brings up its camera.
+        if (key >= '1' && key <= '9' && activeRoomGraph().drawn(key - '0'))
+        {
+            game.camera = key - '0';
+            game.cameraUp = true;
+        }
+        break;
+    }
+    return false;
+}
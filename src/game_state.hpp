@@ -5,11 +5,41 @@ struct GameState
     bool running;
     int battery;
     int hoursSurvived;
-    float hourProgress;
+    int hourTicks;
     int freddoPos;
     int chicoPos;
     bool leftDoor;
     bool rightDoor;
+    bool cameraUp; // the camera monitor is up, which drains battery like a closed door
+    int camera;    // the room the monitor shows
 };
 
+// How a night ended, in the order checkGameOver tests for it.
+enum class Outcome
+{
+    Running,
+    BatteryDied,
+    FreddoGotIn,
+    ChicoGotIn,
+    Survived,
+};
+
+// The simulation runs on an integer tick clock so a night is reproducible bit for bit.
+constexpr int TICKS_PER_SECOND = 60;
+constexpr int SECONDS_PER_HOUR = 20;
+constexpr int TICKS_PER_HOUR = SECONDS_PER_HOUR * TICKS_PER_SECOND;
+
+// Battery drains in 1/240ths of a unit per tick: by default 1/4 unit per second plus 1/2 per
+// closed door (see Tuning).
+constexpr int BATTERY_UNIT = 4 * TICKS_PER_SECOND;
+
+GameState newGame();
 void updateTime(GameState &game);
+bool advanceClock(GameState &game);
+int batteryDrainPerTick(const GameState &game);
+bool drainBattery(GameState &game, int &batteryAccumulator, int drain);
+Outcome nightOutcome(const GameState &game);
+
+// A key the player pressed: A and D toggle the doors, C the camera monitor, 1-9 bring up a
+// room's camera, < and > step through the cameras and Q quits. True if it closed a door.
+bool applyKey(GameState &game, int key);
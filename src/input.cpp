@@ -1,27 +1,101 @@
 #include "audio.hpp"
 #include "input.hpp"
 
+#include <ncurses/curses.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
 void handleInput(GameState &game, int key)
 {
-    switch (key)
+    // The arrow keys step through the cameras like < and >.
+    if (key == KEY_LEFT)
+        key = '<';
+    else if (key == KEY_RIGHT)
+        key = '>';
+    if (applyKey(game, key))
+        playDoorSound();
+}
+
+static void pushKey(InputThread &input, int key)
+{
+    const KeyEvent event{key, std::chrono::steady_clock::now()};
+    // The game drains the ring every frame, so a full ring only means a stalled frame:
+    // wait for room rather than lose the key.
+    while (!input.events.push(event) && !input.stop.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+    if (input.loop)
+        wakeEventLoop(*input.loop);
+}
+
+static void readKeys(InputThread &input)
+{
+#ifdef __linux__
+    // Sleep in poll until stdin has bytes (or stopInputThread pokes stopFd), then take every
+    // key ncurses can decode from them.
+    if (input.stopFd >= 0)
+    {
+        pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {input.stopFd, POLLIN, 0}};
+        while (!input.stop.load(std::memory_order_relaxed))
+        {
+            if (poll(fds, 2, -1) < 0)
+                continue;
+            for (int key = getch(); key != ERR; key = getch())
+                pushKey(input, key);
+            // A hung-up terminal polls as ready forever with nothing to read: quit instead of
+            // spinning.
+            if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL))
+            {
+                pushKey(input, 'q');
+                break;
+            }
+        }
+        return;
+    }
+#endif
+
+    while (!input.stop.load(std::memory_order_relaxed))
+    {
+        const int key = getch();
+        if (key != ERR)
+            pushKey(input, key);
+    }
+}
+
+void startInputThread(InputThread &input)
+{
+    input.stop = false;
+#ifdef __linux__
+    input.stopFd = eventfd(0, EFD_CLOEXEC);
+    if (input.stopFd >= 0)
+        nodelay(stdscr, TRUE);
+    else
+        timeout(50);
+#else
+    // Block in getch for at most 50 ms so stopInputThread is noticed promptly.
+    timeout(50);
+#endif
+    input.thread = std::thread(readKeys, std::ref(input));
+}
+
+void stopInputThread(InputThread &input)
+{
+    input.stop = true;
+#ifdef __linux__
+    if (input.stopFd >= 0)
     {
-    case 'a':
-    case 'A':
-        if (!game.leftDoor)
-            playDoorSound();
-        game.leftDoor = !game.leftDoor;
-        break;
-
-    case 'd':
-    case 'D':
-        if (!game.rightDoor)
-            playDoorSound();
-        game.rightDoor = !game.rightDoor;
-        break;
-
-    case 'q':
-    case 'Q':
-        game.running = false;
-        break;
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = write(input.stopFd, &one, sizeof one);
     }
+#endif
+    if (input.thread.joinable())
+        input.thread.join();
+#ifdef __linux__
+    if (input.stopFd >= 0)
+        close(input.stopFd);
+    input.stopFd = -1;
+#endif
 }
@@ -1,5 +1,34 @@
 #pragma once
 
+#include "event_loop.hpp"
 #include "game_state.hpp"
+#include "spsc_ring.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// applyKey for a key read by ncurses, with the door sound.
 void handleInput(GameState &game, int key);
+
+// A key press and the moment it was read from the terminal.
+struct KeyEvent
+{
+    int key;
+    std::chrono::steady_clock::time_point time;
+};
+
+// Reads the keyboard on its own thread so a key is timestamped when it arrives, not when the
+// game loop next gets round to polling. This thread is the only one calling ncurses while it runs.
+struct InputThread
+{
+    SpscRing<KeyEvent, 256> events;
+    std::atomic<bool> stop{false};
+    std::thread thread;
+    EventLoop *loop = nullptr; // woken after each key, if set
+    int stopFd = -1;
+};
+
+// Call after initscr; stop it before endwin.
+void startInputThread(InputThread &input);
+void stopInputThread(InputThread &input);
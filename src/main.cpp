@@ -1,123 +1,1075 @@
-#include "ai.hpp"
+#include "alloc_tracker.hpp"
+#include "asset_pack.hpp"
 #include "audio.hpp"
+#include "bot.hpp"
+#include "camera_feeds.hpp"
+#include "event_loop.hpp"
+#include "event_sim.hpp"
 #include "game_state.hpp"
 #include "input.hpp"
+#include "option_parse.hpp"
+#include "profiler.hpp"
 #include "render.hpp"
+#include "render_thread.hpp"
+#include "replay.hpp"
+#include "room_graph.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+#include "spectator.hpp"
+#include "telemetry.hpp"
+#include "tuning.hpp"
+#include "tuning_watch.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
+#include <string>
 #include <ncurses/curses.h>
-#include <thread>
+#include <vector>
 
-int main()
+struct Options
 {
-    initAudio();
-    initscr();
-    cbreak();
-    noecho();
-    keypad(stdscr, TRUE);
-    nodelay(stdscr, TRUE);
-    curs_set(0);
+    const char *recordPath = nullptr;
+    std::vector<const char *> replayPaths;
+    double speed = 1.0;
+    bool headless = false;
+    bool stats = false;
+    bool profile = false;
+    const char *tracePath = nullptr;
+    const char *mapPath = nullptr;
+    const char *savePath = "night.s2ss"; // where S saves the night
+    const char *resumePath = nullptr;
+    const char *broadcastName = nullptr; // shared-memory broadcast for spectators
+    const char *watchName = nullptr;
+    const char *telemetryPath = nullptr; // log of the night's events, appended to
+    bool bot = false;                     // the MCTS bot plays instead of the keyboard
+    BotOptions botOptions;
+    bool checkAllocs = false; // headless: fail on any heap allocation during a night
+    uint64_t nights = 100;    // headless bot and --check-allocs nights
+    uint64_t seed = 0;     // 0: seed the night from the clock (headless bot: 1)
+    Tuning tuning;
+    const char *tuningPath = nullptr; // applied over --set, and reloaded while you play
+};
 
-    initTerminalColors();
+constexpr double MAX_BUDGET_MS = 60000.0; // --budget: a minute per decision
+
+static bool parseOptions(int argc, char **argv, Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--record") == 0 && hasValue)
+            options.recordPath = argv[++i];
+        else if (std::strcmp(arg, "--replay") == 0 && hasValue)
+            options.replayPaths.push_back(argv[++i]);
+        else if (std::strcmp(arg, "--speed") == 0 && hasValue)
+        {
+            if (!parseReal(argv[++i], 0.0, MAX_SPEED, options.speed))
+                return false;
+        }
+        else if (std::strcmp(arg, "--headless") == 0)
+            options.headless = true;
+        else if (std::strcmp(arg, "--stats") == 0)
+            options.stats = true;
+        else if (std::strcmp(arg, "--profile") == 0)
+            options.profile = true;
+        else if (std::strcmp(arg, "--trace") == 0 && hasValue)
+            options.tracePath = argv[++i];
+        else if (std::strcmp(arg, "--map") == 0 && hasValue)
+            options.mapPath = argv[++i];
+        else if (std::strcmp(arg, "--save") == 0 && hasValue)
+            options.savePath = argv[++i];
+        else if (std::strcmp(arg, "--resume") == 0 && hasValue)
+            options.resumePath = argv[++i];
+        else if (std::strcmp(arg, "--broadcast") == 0 && hasValue)
+            options.broadcastName = argv[++i];
+        else if (std::strcmp(arg, "--watch") == 0 && hasValue)
+            options.watchName = argv[++i];
+        else if (std::strcmp(arg, "--telemetry") == 0 && hasValue)
+            options.telemetryPath = argv[++i];
+        else if (std::strcmp(arg, "--check-allocs") == 0)
+            options.checkAllocs = true;
+        else if (std::strcmp(arg, "--bot") == 0)
+            options.bot = true;
+        else if (std::strcmp(arg, "--bot-threads") == 0 && hasValue)
+        {
+            if (!parseCount(argv[++i], 0u, MAX_THREADS, options.botOptions.threads))
+                return false;
+        }
+        else if (std::strcmp(arg, "--budget") == 0 && hasValue)
+        {
+            if (!parseReal(argv[++i], 0.0, MAX_BUDGET_MS, options.botOptions.budgetMs))
+                return false;
+        }
+        else if (std::strcmp(arg, "--nights") == 0 && hasValue)
+        {
+            if (!parseCount(argv[++i], options.nights))
+                return false;
+        }
+        else if (std::strcmp(arg, "--seed") == 0 && hasValue)
+        {
+            if (!parseCount(argv[++i], options.seed))
+                return false;
+        }
+        else if (std::strcmp(arg, "--set") == 0 && hasValue)
+        {
+            if (!parseTuningSetting(argv[++i], options.tuning))
+                return false;
+        }
+        else if (std::strcmp(arg, "--tuning") == 0 && hasValue)
+            options.tuningPath = argv[++i];
+        else if (!options.replayPaths.empty() && arg[0] != '-')
+            options.replayPaths.push_back(arg);
+        else
+            return false;
+    }
+    if (options.speed <= 0.0 || options.botOptions.budgetMs <= 0.0)
+        return false;
+    // The bot plays its own nights; it can't take over a replay or a broadcast it is watching.
+    if (options.bot && (options.watchName || !options.replayPaths.empty()))
+        return false;
+    if (options.bot && options.headless)
+        return !options.resumePath && !options.recordPath && !options.broadcastName &&
+               !options.checkAllocs;
+    // Headless replays only check logs; they play no nights of their own to log.
+    if (options.headless && !options.checkAllocs && options.telemetryPath)
+        return false;
+    if (options.checkAllocs)
+        return options.headless && options.replayPaths.empty() && !options.resumePath &&
+               !options.recordPath && !options.broadcastName && !options.watchName;
+    // A spectator only shows someone else's screen.
+    if (options.watchName)
+        return !options.headless && !options.recordPath && options.replayPaths.empty() &&
+               !options.resumePath && !options.broadcastName && !options.telemetryPath;
+    if (options.replayPaths.size() > 1 && !options.headless)
+        return false;
+    if (options.recordPath && !options.replayPaths.empty())
+        return false;
+    // A log replays from the start of a night, so it can't pick up a saved one.
+    if (options.resumePath && (options.recordPath || !options.replayPaths.empty()))
+        return false;
+    return options.replayPaths.empty() ? !options.headless : true;
+}
+
+static const char *outcomeName(Outcome outcome)
+{
+    switch (outcome)
+    {
+    case Outcome::Running:
+        return "quit";
+    case Outcome::BatteryDied:
+        return "battery died";
+    case Outcome::FreddoGotIn:
+        return "Freddo got in";
+    case Outcome::ChicoGotIn:
+        return "Chico got in";
+    case Outcome::Survived:
+        return "survived";
+    }
+    return "?";
+}
+
+// Terminal traffic over a session: the first frame paints the whole screen, later ones only
+// what changed.
+static void printFrames(const RenderThread &render)
+{
+    const RenderTotals &totals = render.totals;
+    std::printf("Frames drawn:  %llu (%llu skipped for a newer one)\n",
+                static_cast<unsigned long long>(totals.frames),
+                static_cast<unsigned long long>(render.dropped));
+    std::printf("First frame:   %d cells, %zu bytes\n", totals.first.cells, totals.first.bytes);
+    if (totals.frames > 1)
+        std::printf("Later frames:  %.1f cells, %.1f bytes on average\n",
+                    static_cast<double>(totals.cells) / (totals.frames - 1),
+                    static_cast<double>(totals.bytes) / (totals.frames - 1));
+    const CameraFrameCache &cameras = cameraFrameCache();
+    if (cameras.uses > 0)
+        std::printf("Camera frames: %llu shown, %.1f%% from the cache, %llu decoded\n",
+                    static_cast<unsigned long long>(cameras.uses),
+                    100.0 * cameras.hits / cameras.uses,
+                    static_cast<unsigned long long>(cameras.decodedFrames));
+}
+
+// Reloads are only reported under --stats, but a file that was rejected always is: the
+// player was playing on the previous values without knowing it.
+static void printTuningReloads(const char *path, const TuningReload &reloads, bool stats)
+{
+    if (stats)
+        std::printf("Tuning reloads: %u applied, %u rejected\n", reloads.applied,
+                    reloads.rejected);
+    if (reloads.rejected > 0)
+        std::fprintf(stderr, "%s: %u reload%s rejected, the last because %s\n", path,
+                     reloads.rejected, reloads.rejected == 1 ? "" : "s", reloads.lastError);
+}
+
+// The monitor's feeds come from the embedded asset pack. Without them every camera shows
+// static, so a damaged asset is reported but doesn't stop the game.
+static void loadCameras(CameraFeeds &feeds)
+{
+    const AssetPack &pack = embeddedAssets();
+    const AssetEntry *asset = findAsset(pack, "cameras.s2sc");
+    std::vector<uint8_t> data;
+    std::string error;
+    if (!asset)
+        error = "not in the asset pack";
+    else if (!unpackAsset(pack, *asset, data))
+        error = "damaged in the asset pack";
+    else if (loadCameraFeeds(std::move(data), feeds, error))
+    {
+        setCameraFeeds(&feeds);
+        return;
+    }
+    std::fprintf(stderr, "cameras.s2sc: %s\n", error.c_str());
+}
+
+static void printLoopStats(const LoopStats &stats, std::chrono::nanoseconds wall,
+                           std::clock_t cpuStart)
+{
+    const double seconds = std::chrono::duration<double>(wall).count();
+    const double asleep = std::chrono::duration<double>(stats.asleep).count();
+    const double cpu = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    if (seconds <= 0.0)
+        return;
+    std::printf("Wakeups:       %.1f per second (%llu of %llu for keys)\n",
+                stats.wakeups / seconds, static_cast<unsigned long long>(stats.keyWakeups),
+                static_cast<unsigned long long>(stats.wakeups));
+    std::printf("Game loop:     asleep %.1f%% of %.1f s\n", 100.0 * asleep / seconds, seconds);
+    std::printf("Process CPU:   %.3f s (%.2f%% of one core, audio included)\n", cpu,
+                100.0 * cpu / seconds);
+}
 
-    std::srand((unsigned)std::time(nullptr));
-
-    GameState game{
-        true,  // running
-        100,   // battery
-        0,     // hoursSurvived
-        0.0f,  // hourProgress
-        1,     // freddoPos
-        1,     // chicoPos
-        false, // leftDoor
-        false  // rightDoor
+static void printProfile()
+{
+    char line[64];
+    std::printf("  %-11s %7s %7s %7s\n", "phase (ms)", "p50", "p99", "max");
+    for (int i = 0; i < static_cast<int>(Phase::Count); ++i)
+    {
+        formatPhaseSummary(static_cast<Phase>(i), line, sizeof line);
+        std::printf("  %s (%llu)\n", line,
+                    static_cast<unsigned long long>(phaseHistogram(static_cast<Phase>(i)).total));
+    }
+}
+
+static void printAudioStats()
+{
+    const AudioStats &audio = audioStats();
+    std::printf("Sounds played: %llu (%llu cut off an earlier voice)\n",
+                static_cast<unsigned long long>(audio.plays),
+                static_cast<unsigned long long>(audio.stolen));
+    if (audio.plays > 0)
+        std::printf("Sound trigger: %.1f us average, %.1f us max\n",
+                    audio.totalTriggerNanos / 1000.0 / audio.plays, audio.maxTriggerNanos / 1000.0);
+    std::printf("Output buffer: %.1f ms\n", audio.outputLatencyMs);
+}
+
+// Startup phases, from entering main. Audio loads on its own thread, so its time no longer
+// comes before the first frame.
+struct StartupTimes
+{
+    std::chrono::steady_clock::time_point launched;
+    std::chrono::steady_clock::time_point screenReady; // ncurses initialized
+    std::chrono::steady_clock::time_point firstFrame;  // first frame on the terminal
+};
+
+static void printStartup(const StartupTimes &startup)
+{
+    auto since = [&](std::chrono::steady_clock::time_point at) {
+        return std::chrono::duration<double, std::milli>(at - startup.launched).count();
     };
+    const AudioStats &audio = audioStats();
+    std::printf("Startup:       screen ready %.1f ms, first frame %.1f ms\n",
+                since(startup.screenReady), since(startup.firstFrame));
+    if (audio.readyAt == std::chrono::steady_clock::time_point{})
+        return;
+    std::printf("Audio loading: ready at %.1f ms (%.1f ms in the background, %.2f ms unpacking "
+                "assets); %llu sounds waited for it\n",
+                since(audio.readyAt), audio.loadMs, audio.unpackMs,
+                static_cast<unsigned long long>(audio.queued));
+}
 
-    FreddoAI freddo;
-    ChicoAI chico;
+// Re-runs each log at full speed and checks it still ends the way it was recorded.
+static int replayHeadless(const Options &options)
+{
+    int diverged = 0;
+    const auto start = std::chrono::steady_clock::now();
 
+    for (const char *path : options.replayPaths)
+    {
+        ReplayLog log;
+        if (!loadReplay(path, log))
+        {
+            std::fprintf(stderr, "%s: not a replay log\n", path);
+            return 2;
+        }
+
+        // A version 1 log has no tuning of its own and plays with the command line's.
+        setActiveTuning(options.tuning);
+        Night night;
+        const Outcome outcome = replayNightHeadless(log, night);
+        const bool same = outcome == log.outcome && night.tick == log.endTick;
+        if (!same)
+            diverged++;
+
+        std::printf("%s: %s at tick %d (recorded: %s at tick %d) %s\n", path, outcomeName(outcome),
+                    night.tick, outcomeName(log.outcome), log.endTick, same ? "OK" : "DIVERGED");
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::printf("%zu replays in %.3f s, %d diverged\n", options.replayPaths.size(),
+                elapsed.count(), diverged);
+    return diverged == 0 ? 0 : 1;
+}
+
+static void printBotStats(const BotStats &stats)
+{
+    const double thinking = std::chrono::duration<double>(stats.thinking).count();
+    if (stats.decisions == 0 || thinking <= 0.0)
+        return;
+    std::printf("Bot decisions: %llu searched (%.1f per second of thinking), %llu with nobody "
+                "near, %llu keys\n",
+                static_cast<unsigned long long>(stats.decisions), stats.decisions / thinking,
+                static_cast<unsigned long long>(stats.forced),
+                static_cast<unsigned long long>(stats.keys));
+    std::printf("Bot rollouts:  %.0f per second, %.0f per decision\n", stats.rollouts / thinking,
+                static_cast<double>(stats.rollouts) / stats.decisions);
+}
+
+// Plays --nights nights with the bot as fast as it thinks, and compares its survival with the
+// scripted policy's on the same nights.
+static int playBotHeadless(const Options &options)
+{
+    MctsBot bot;
+    bot.options = options.botOptions;
+    bot.options.seed = options.seed != 0 ? options.seed : 1;
+    bot.tuning = &options.tuning;
+
+    TelemetryWriter telemetry;
+    if (options.telemetryPath)
+    {
+        std::string error;
+        if (!openTelemetry(telemetry, options.telemetryPath, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.telemetryPath, error.c_str());
+            return 2;
+        }
+    }
+
+    uint64_t outcomes[5] = {};
+    uint64_t scriptedSurvived = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < options.nights; ++i)
+    {
+        Night night = startNight(bot.options.seed, i);
+        GameState &game = night.game;
+        startBot(bot, game);
+        NightObservation logged = observeNight(night);
+        if (options.telemetryPath)
+            logNightStart(telemetry, i);
+        Outcome outcome = Outcome::Running;
+        while (outcome == Outcome::Running && night.tick < MAX_NIGHT_TICKS)
+        {
+            if (night.tick % TICKS_PER_SECOND == 0)
+            {
+                int keys[2];
+                for (int k = botKeys(bot, game, keys), j = 0; j < k; ++j)
+                    handleInput(game, keys[j]);
+            }
+            const GameState before = game;
+            stepNight(night);
+            botObserve(bot, before, game);
+            if (options.telemetryPath)
+            {
+                logNightChanges(telemetry, logged, night);
+                logged = observeNight(night);
+            }
+            outcome = nightOutcome(game);
+        }
+        outcomes[static_cast<int>(outcome)]++;
+
+        Night reference = startNight(bot.options.seed, i);
+        Rng policyRng;
+        if (runNightEvents(reference, DoorPolicy{DoorPolicyKind::Scripted}, policyRng) ==
+            Outcome::Survived)
+            scriptedSurvived++;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (options.telemetryPath)
+        closeTelemetry(telemetry);
+
+    const double nights = static_cast<double>(options.nights);
+    const double survival = outcomes[static_cast<int>(Outcome::Survived)] / nights;
+    std::printf("Bot played %llu nights (%u threads, %.1f ms per decision, seed %llu) in %.1f s\n",
+                static_cast<unsigned long long>(options.nights), bot.options.threads,
+                bot.options.budgetMs, static_cast<unsigned long long>(bot.options.seed),
+                elapsed.count());
+    std::printf("Survived:      %.2f%% +/- %.2f%% (scripted policy: %.2f%%)\n", 100.0 * survival,
+                196.0 * std::sqrt(survival * (1.0 - survival) / nights),
+                100.0 * scriptedSurvived / nights);
+    for (Outcome outcome : {Outcome::BatteryDied, Outcome::FreddoGotIn, Outcome::ChicoGotIn})
+        std::printf("  %-13s %.2f%%\n", outcomeName(outcome),
+                    100.0 * outcomes[static_cast<int>(outcome)] / nights);
+    printBotStats(bot.stats);
+    return 0;
+}
+
+// Room for this many recorded keys is made before a night starts, so recording them doesn't
+// allocate unless a player presses more.
+constexpr size_t RESERVED_REPLAY_EVENTS = 1 << 14;
+constexpr size_t RESERVED_REPLAY_TUNINGS = 64;
+
+using Clock = std::chrono::steady_clock;
+
+// When each tick ends on the wall clock. A resumed night starts part way through, as if it had
+// been running all along.
+struct TickClock
+{
+    Clock::time_point start;
+    double nanosPerTick;
+
+    // Wall-clock time by which simulation tick `tick` has fully elapsed.
+    Clock::time_point end(int tick) const
+    {
+        return start + std::chrono::nanoseconds(static_cast<int64_t>((tick + 1) * nanosPerTick));
+    }
+};
+
+// One night as the game loop plays it: the keys it takes, the ticks it runs and the snapshots
+// it hands the render thread. The live loop and --check-allocs both drive it, so the check runs
+// the very code a player does.
+struct NightLoop
+{
+    Night night;
+    ReplayLog *log = nullptr; // keys are recorded into it, or replayed from it
+    bool replaying = false;
+    size_t nextReplayEvent = 0;
+    size_t nextReplayTuning = 0;
+    MctsBot *bot = nullptr;               // presses its keys once a second, if set
+    TelemetryWriter *telemetry = nullptr; // if set, logs every step
+    NightObservation logged;              // what the telemetry log last saw
+    RenderThread *render = nullptr;
+    const char *savePath = nullptr; // where S saves the night
+    bool traceProfile = false;      // P turns on tracing as well
     bool shouldRedraw = true;
-    float batteryAccumulator = 0.0f;
+    bool showProfiler = false;
+    uint32_t resizes = 0;
+    uint64_t snapshots = 0;
+    bool quit = false;
+    bool saveRequested = false;
+    bool savedNight = false;
+};
 
-    using clock = std::chrono::steady_clock;
-    auto lastTick = clock::now();
-    constexpr auto frameDuration{std::chrono::milliseconds(16)}; // ~60 FPS
-    auto nextTick = lastTick + frameDuration;
+// A key the player (or the bot) pressed, applied to the night and recorded.
+static void pressKey(NightLoop &loop, int key)
+{
+    handleInput(loop.night.game, key);
+    loop.log->events.push_back({loop.night.tick, key});
+    loop.shouldRedraw = true;
+    loop.quit = !loop.night.game.running;
+}
 
-    // the GAME LOOP //
-    while (game.running)
+// Applies every queued key that arrived before `end`, on the tick in progress. Keys still
+// waiting in the terminal or the ring when a frame stalls keep their arrival time, so a door
+// toggle lands on the tick it was pressed in no matter when the loop gets to it.
+static void applyKeysUpTo(NightLoop &loop, SpscRing<KeyEvent, 256> &events, Clock::time_point end)
+{
+    KeyEvent event;
+    if (!events.peek(event) || event.time >= end)
+        return;
+
+    ProfileScope scope(Phase::Input);
+    while (!loop.quit && events.peek(event) && event.time < end)
+    {
+        events.pop();
+        if (event.key == KEY_RESIZE)
+        {
+            loop.resizes++;
+            loop.shouldRedraw = true;
+        }
+        else if (event.key == 'p' || event.key == 'P')
+        {
+            enableProfiler(loop.traceProfile);
+            loop.showProfiler = !loop.showProfiler;
+            loop.shouldRedraw = true;
+        }
+        else if (loop.replaying)
+        {
+            // Only Q does anything while watching a replay.
+            loop.quit = event.key == 'q' || event.key == 'Q';
+        }
+        else if (event.key == 's' || event.key == 'S')
+        {
+            // Save and quit. The recording ends here too, as if Q had been pressed.
+            loop.saveRequested = true;
+            loop.savedNight = saveSnapshot(loop.savePath, takeSnapshot(loop.night));
+            loop.log->events.push_back({loop.night.tick, 'q'});
+            loop.quit = true;
+        }
+        else
+        {
+            pressKey(loop, event.key);
+            // A full ring only loses a latency sample.
+            if (profilerEnabled())
+                loop.render->keys.push({loop.night.tick, event.time});
+        }
+    }
+}
+
+// Runs one tick after its keys: the replayed tuning and keys, the bot's keys, the step itself
+// and its telemetry. False once the night is over or stopped.
+static bool runTick(NightLoop &loop)
+{
+    Night &night = loop.night;
+    GameState &game = night.game;
+    if (loop.replaying)
     {
-        auto now = clock::now();
-        std::chrono::duration<float> delta{now - lastTick};
-        float deltaSeconds{delta.count()};
-        lastTick = now;
+        loop.nextReplayTuning = applyReplayTunings(*loop.log, loop.nextReplayTuning, night);
+        const size_t applied = applyReplayKeys(*loop.log, loop.nextReplayEvent, night);
+        if (applied != loop.nextReplayEvent)
+            loop.shouldRedraw = true;
+        loop.nextReplayEvent = applied;
+        if (!game.running)
+            return false;
+    }
 
-        int ch = getch();
-        if (ch != ERR)
+    // The bot presses its keys like a player would, and they are recorded the same.
+    if (loop.bot && night.tick % TICKS_PER_SECOND == 0)
+    {
+        int keys[2];
+        for (int k = botKeys(*loop.bot, game, keys), j = 0; j < k; ++j)
+            pressKey(loop, keys[j]);
+    }
+
+    const GameState before = game;
+    if (stepNight(night))
+        loop.shouldRedraw = true;
+    if (loop.bot)
+        botObserve(*loop.bot, before, game);
+    if (loop.telemetry)
+    {
+        logNightChanges(*loop.telemetry, loop.logged, night);
+        loop.logged = observeNight(night);
+    }
+    if (night.tick % TICKS_PER_SECOND == 0 ||
+        (game.cameraUp && night.tick % CAMERA_FRAME_TICKS == 0))
+        loop.shouldRedraw = true;
+    return nightOutcome(game) == Outcome::Running;
+}
+
+// One pass of the game loop: runs every tick that has ended by `now`, applies the keys pressed
+// during the tick in progress and hands the render thread a copy of the night if it changed.
+// True once the night is decided.
+static bool runFrame(NightLoop &loop, SpscRing<KeyEvent, 256> &events, const TickClock &ticks,
+                     Clock::time_point now)
+{
+    Night &night = loop.night;
+    GameState &game = night.game;
+    // Run every tick that has elapsed; a slow frame just runs more of them.
+    {
+        ProfileScope scope(Phase::Simulate);
+        while (game.running && ticks.end(night.tick) <= now)
         {
-            handleInput(game, ch);
-            shouldRedraw = true;
+            applyKeysUpTo(loop, events, ticks.end(night.tick));
+            if (loop.quit || !runTick(loop))
+                break;
         }
+    }
+    // Keys pressed during the tick in progress show up now; they still count for that tick.
+    if (game.running && nightOutcome(game) == Outcome::Running)
+        applyKeysUpTo(loop, events, ticks.end(night.tick));
+    if (loop.quit)
+        return false;
 
-        constexpr float SECONDS_PER_HOUR = 20.0f;
-        game.hourProgress += deltaSeconds / SECONDS_PER_HOUR;
+    // Drawing happens on the render thread, so the ticks above keep to the clock however long
+    // the terminal takes to write a frame.
+    const bool over = nightOutcome(game) != Outcome::Running;
+    if (loop.shouldRedraw || over)
+    {
+        loop.render->snapshots.back() =
+            RenderSnapshot{game, loop.showProfiler, loop.resizes, night.tick};
+        publishSnapshot(*loop.render);
+        loop.snapshots++;
+        loop.shouldRedraw = false;
+    }
+    return over;
+}
 
-        if (game.hourProgress >= 1.0f)
+// Plays nights through the game loop's runFrame with allocation tracking on, one tick per
+// frame. Keys go through the input ring, handleInput and the replay log, and the profiler is
+// on. Every other night replays the one before it from its log. Ticks are logged to
+// --telemetry if given, and drawn on the render thread with frames written to the null device.
+// Fails if any of it touched the heap, or if a replay came out differently.
+static int checkAllocsHeadless(const Options &options)
+{
+    if (!allocTrackingBuilt())
+    {
+        std::fprintf(stderr, "--check-allocs needs a build configured with -DTRACK_ALLOCS=ON\n");
+        return 2;
+    }
+#ifdef _WIN32
+    std::FILE *sink = std::fopen("NUL", "wb");
+#else
+    std::FILE *sink = std::fopen("/dev/null", "wb");
+#endif
+    if (!sink)
+    {
+        std::fprintf(stderr, "can't open the null device\n");
+        return 2;
+    }
+    TelemetryWriter telemetry;
+    if (options.telemetryPath)
+    {
+        std::string error;
+        if (!openTelemetry(telemetry, options.telemetryPath, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.telemetryPath, error.c_str());
+            return 2;
+        }
+    }
+    // A buffer of our own, so stdio has none to allocate on the first frame.
+    static char sinkBuffer[1 << 16];
+    std::setvbuf(sink, sinkBuffer, _IOFBF, sizeof sinkBuffer);
+    setRenderOutput(sink);
+    CameraFeeds cameras;
+    loadCameras(cameras);
+    enableProfiler(false);
+
+    RenderThread render;
+    startRenderThread(render);
+    ReplayLog log;
+    log.events.reserve(RESERVED_REPLAY_EVENTS);
+    log.tunings.reserve(RESERVED_REPLAY_TUNINGS);
+    // The keyboard thread is never started; the check fills its ring the way that thread would.
+    InputThread input;
+    // Ticks end a nanosecond apart from the epoch, and keys arrive at the epoch, so each frame
+    // runs exactly one tick and takes every key queued before it.
+    const TickClock ticks{Clock::time_point{}, 1.0};
+    // Random door flips press far more keys than a person would.
+    const DoorPolicy policy{DoorPolicyKind::Random};
+    const uint64_t seed = options.seed != 0 ? options.seed : 1;
+    uint64_t tickCount = 0;
+    uint64_t snapshots = 0;
+    uint64_t diverged = 0;
+
+    startAllocTracking();
+    for (uint64_t i = 0; i < options.nights; ++i)
+    {
+        NightLoop loop;
+        loop.replaying = i % 2 == 1;
+        if (!loop.replaying)
         {
-            game.hourProgress = 0.0f;
-            updateTime(game);
+            log.seed = seed + i / 2;
+            log.events.clear();
+            log.tunings.clear();
+            log.tunings.push_back({0, options.tuning});
         }
+        loop.night = startNight(log.seed);
+        loop.log = &log;
+        loop.render = &render;
+        if (options.telemetryPath)
+        {
+            loop.telemetry = &telemetry;
+            loop.logged = observeNight(loop.night);
+            logNightStart(telemetry, log.seed);
+        }
+        Night &night = loop.night;
+        GameState &game = night.game;
+        Rng policyRng;
+        policyRng.seed(~seed, i);
 
-        static float uiTimer = 0.0f;
-        uiTimer += deltaSeconds;
+        bool over = false;
+        while (!over && game.running && night.tick < MAX_NIGHT_TICKS)
+        {
+            if (!loop.replaying && night.tick % TICKS_PER_SECOND == 0)
+            {
+                GameState wanted = game;
+                applyDoorPolicy(policy, wanted, policyRng);
+                // Flip through the cameras and the profiler overlay too, so they are drawn.
+                const int second = night.tick / TICKS_PER_SECOND;
+                for (int key : {wanted.leftDoor != game.leftDoor ? 'a' : 0,
+                                wanted.rightDoor != game.rightDoor ? 'd' : 0,
+                                second % 5 == 0 ? 'c' : 0, game.cameraUp ? KEY_RIGHT : 0,
+                                second % 20 == 0 ? 'p' : 0})
+                {
+                    if (key != 0)
+                        input.events.push({key, Clock::time_point{}});
+                }
+            }
+            over = runFrame(loop, input.events, ticks, ticks.end(night.tick));
+            tickCount++;
+        }
+        snapshots += loop.snapshots;
+
+        if (!loop.replaying)
+        {
+            log.endTick = night.tick;
+            log.outcome = nightOutcome(game);
+        }
+        else if (night.tick != log.endTick || nightOutcome(game) != log.outcome)
+            diverged++;
+    }
+    stopRenderThread(render);
+    stopAllocTracking();
+    setRenderOutput(stdout);
+    std::fclose(sink);
+    if (options.telemetryPath)
+        closeTelemetry(telemetry);
+
+    const uint64_t allocations = trackedAllocations();
+    std::printf("Checked %llu nights: %llu ticks, %llu snapshots, %llu frames drawn\n",
+                static_cast<unsigned long long>(options.nights),
+                static_cast<unsigned long long>(tickCount),
+                static_cast<unsigned long long>(snapshots),
+                static_cast<unsigned long long>(render.totals.frames));
+    std::printf("Replayed nights that diverged: %llu\n", static_cast<unsigned long long>(diverged));
+    std::printf("Heap allocations during the nights: %llu\n",
+                static_cast<unsigned long long>(allocations));
+    if (allocations == 0 && diverged == 0)
+        return 0;
+    std::fflush(stdout);
+    if (allocations > 0)
+        printAllocSites(stdout);
+    return 1;
+}
+
+// How often a spectator looks for new frames. Polling keeps the game free of any work per
+// viewer.
+constexpr int WATCH_POLL_MS = 15;
+
+// Shows another game's broadcast until it ends or Q is pressed.
+static int watchBroadcast(const Options &options)
+{
+    SpectatorReader reader;
+    std::string error;
+    if (!openSpectatorReader(reader, options.watchName, error))
+    {
+        std::fprintf(stderr, "%s: %s\n", options.watchName, error.c_str());
+        return 2;
+    }
+
+    initscr();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+    timeout(WATCH_POLL_MS);
+
+    static Framebuffer view;
+    view.useColor = has_colors();
+    enableTerminalEscapes();
+    SpectatorStatus status = SpectatorStatus::Idle;
+    for (;;)
+    {
+        const int key = getch();
+        if (key == 'q' || key == 'Q')
+            break;
+        if (key == KEY_RESIZE)
+            view.invalid = true;
+        status = readFrames(reader, view);
+        if (status == SpectatorStatus::Ended)
+            break;
+        if (status == SpectatorStatus::Updated || view.invalid)
+            presentFrame(view);
+    }
+    endwin();
+
+    if (status == SpectatorStatus::Ended)
+        std::printf("The broadcast has ended.\n");
+    if (reader.resyncs > 0)
+        std::printf("Fell behind %llu times and skipped to the latest keyframe.\n",
+                    static_cast<unsigned long long>(reader.resyncs));
+    closeSpectatorReader(reader);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    StartupTimes startup;
+    startup.launched = std::chrono::steady_clock::now();
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--map FILE] [--record FILE] [--stats] [--profile] [--trace FILE]\n"
+                     "          [--save FILE] [--resume FILE] [--broadcast NAME]\n"
+                     "          [--telemetry FILE] [--bot] [--bot-threads N] [--budget MS]\n"
+                     "          [--seed N] [--set NAME=VALUE]... [--tuning FILE]\n"
+                     "       %s --replay FILE [--map FILE] [--speed X] [--stats] [--profile]\n"
+                     "          [--trace FILE]\n"
+                     "       %s --headless --replay FILE... [--map FILE]\n"
+                     "       %s --headless --bot [--nights N] [--bot-threads N] [--budget MS]\n"
+                     "          [--seed N] [--map FILE] [--set NAME=VALUE]... [--tuning FILE]\n"
+                     "          [--telemetry FILE]\n"
+                     "       %s --headless --check-allocs [--nights N] [--seed N] [--map FILE]\n"
+                     "          [--set NAME=VALUE]... [--tuning FILE] [--telemetry FILE]\n"
+                     "       %s --watch NAME\n",
+                     argv[0], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 2;
+    }
 
-        if (uiTimer >= 1.0f)
+    if (options.mapPath)
+    {
+        RoomGraph graph;
+        std::string error;
+        if (!loadRoomGraph(options.mapPath, graph, error))
         {
-            shouldRedraw = true;
-            uiTimer = 0.0f;
+            std::fprintf(stderr, "%s: %s\n", options.mapPath, error.c_str());
+            return 2;
         }
+        setActiveRoomGraph(graph);
+    }
 
-        constexpr float baseDrainPerSecond = 1.0f / 4.0f;
-        constexpr float extraPerDoorPerSecond = 0.5f;
+    const Tuning commandLineTuning = options.tuning;
+    std::string tuningError;
+    if ((options.tuningPath && !loadTuningFile(options.tuningPath, options.tuning, tuningError)) ||
+        !validateTuning(options.tuning, tuningError))
+    {
+        std::fprintf(stderr, "%s: %s\n", options.tuningPath ? options.tuningPath : "--set",
+                     tuningError.c_str());
+        return 2;
+    }
+    setActiveTuning(options.tuning);
 
-        float drainThisSecond = baseDrainPerSecond;
-        if (game.leftDoor)
-            drainThisSecond += extraPerDoorPerSecond;
-        if (game.rightDoor)
-            drainThisSecond += extraPerDoorPerSecond;
+    if (options.headless && options.bot)
+        return playBotHeadless(options);
+    if (options.checkAllocs)
+        return checkAllocsHeadless(options);
+    if (options.headless)
+        return replayHeadless(options);
+    if (options.watchName)
+        return watchBroadcast(options);
 
-        batteryAccumulator += drainThisSecond * deltaSeconds;
+    ReplayLog log;
+    const bool replaying = !options.replayPaths.empty();
+    if (replaying && !loadReplay(options.replayPaths[0], log))
+    {
+        std::fprintf(stderr, "%s: not a replay log\n", options.replayPaths[0]);
+        return 2;
+    }
+    if (!replaying)
+    {
+        log.seed = options.seed != 0 ? options.seed : static_cast<uint64_t>(std::time(nullptr));
+        log.tunings.reserve(RESERVED_REPLAY_TUNINGS);
+        log.tunings.push_back({0, options.tuning});
+    }
+    log.events.reserve(std::max(log.events.size(), RESERVED_REPLAY_EVENTS));
 
-        while (batteryAccumulator >= 1.0f && game.battery > 0)
+    NightSnapshot saved{};
+    if (options.resumePath)
+    {
+        std::string error;
+        if (!loadSnapshot(options.resumePath, saved, error))
         {
-            game.battery -= 1;
-            batteryAccumulator -= 1.0f;
-            shouldRedraw = true;
+            std::fprintf(stderr, "%s: %s\n", options.resumePath, error.c_str());
+            return 2;
         }
+    }
 
-        freddo.update(game, deltaSeconds);
-        chico.update(game, deltaSeconds);
+    SpectatorWriter spectators;
+    if (options.broadcastName)
+    {
+        std::string error;
+        if (!openSpectatorWriter(spectators, options.broadcastName, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.broadcastName, error.c_str());
+            return 2;
+        }
+    }
 
-        if (shouldRedraw)
+    TelemetryWriter telemetry;
+    if (options.telemetryPath)
+    {
+        std::string error;
+        if (!openTelemetry(telemetry, options.telemetryPath, error))
         {
-            drawUI(game);
-            shouldRedraw = false;
+            std::fprintf(stderr, "%s: %s\n", options.telemetryPath, error.c_str());
+            return 2;
         }
+    }
+
+    CameraFeeds cameras;
+    loadCameras(cameras);
 
-        if (checkGameOver(game))
+    EventLoop loop;
+    initEventLoop(loop);
+    // Only a night you play picks up changes: a replay or the bot keeps the tuning it started
+    // with.
+    TuningWatcher tuningWatcher;
+    const bool watchTuning = options.tuningPath && !replaying && !options.bot;
+    if (watchTuning)
+    {
+        std::string error;
+        tuningWatcher.loop = &loop;
+        if (!startTuningWatcher(tuningWatcher, options.tuningPath, commandLineTuning,
+                                options.tuning, error))
         {
+            std::fprintf(stderr, "%s: %s\n", options.tuningPath, error.c_str());
+            closeEventLoop(loop);
+            return 2;
+        }
+    }
+
+    const std::clock_t cpuStart = std::clock();
+    initAudio();
+    initscr();
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+
+    initTerminalColors();
+    // ncurses clears the terminal on its first refresh, which getch() on the input thread would
+    // otherwise do behind the render thread's back, wiping frames it thinks are on screen. Get
+    // it over with before either thread starts.
+    refresh();
+    startup.screenReady = std::chrono::steady_clock::now();
+
+    NightLoop nightLoop;
+    nightLoop.night = startNight(log.seed);
+    if (options.resumePath)
+        restoreSnapshot(saved, nightLoop.night);
+    Night &night = nightLoop.night;
+    GameState &game = night.game;
+    MctsBot bot;
+    bot.options = options.botOptions;
+    bot.options.seed = log.seed;
+    bot.tuning = &options.tuning;
+    if (options.bot)
+    {
+        startBot(bot, game);
+        nightLoop.bot = &bot;
+    }
+    nightLoop.log = &log;
+    nightLoop.replaying = replaying;
+    nightLoop.savePath = options.savePath;
+    nightLoop.traceProfile = options.tracePath != nullptr;
+    // Door keys between steps show up in the telemetry on the next step.
+    if (options.telemetryPath)
+    {
+        nightLoop.telemetry = &telemetry;
+        nightLoop.logged = observeNight(night);
+        logNightStart(telemetry, log.seed);
+    }
+
+    using clock = std::chrono::steady_clock;
+    const double nanosPerTick = 1e9 / (TICKS_PER_SECOND * options.speed);
+    const TickClock ticks{
+        clock::now() - std::chrono::nanoseconds(static_cast<int64_t>(night.tick * nanosPerTick)),
+        nanosPerTick};
+    const auto nightStart = ticks.start;
+
+    InputThread input;
+    input.loop = &loop;
+    startInputThread(input);
+    RenderThread render;
+    if (options.broadcastName)
+        render.spectators = &spectators;
+    startRenderThread(render);
+    nightLoop.render = &render;
+    if (options.profile || options.tracePath)
+        enableProfiler(options.tracePath != nullptr);
+
+    // the GAME LOOP //
+    while (game.running && !nightLoop.quit)
+    {
+        // A saved tuning file applies from the next tick on, and is logged so replays follow it.
+        if (watchTuning && takeTuningReload(tuningWatcher))
+            log.tunings.push_back({night.tick, activeTuning()});
+
+        const bool over = runFrame(nightLoop, input.events, ticks, clock::now());
+        if (nightLoop.quit)
+            break;
+        if (over)
+        {
+            // Leave the message up for a few seconds; a key pressed after it was sent for drawing
+            // skips the wait.
+            const auto shown = clock::now();
+            const auto until = shown + std::chrono::seconds(3);
+            bool dismissed = false;
+            while (!dismissed && clock::now() < until)
+            {
+                waitForEvent(loop, until);
+                KeyEvent event;
+                while (input.events.peek(event))
+                {
+                    input.events.pop();
+                    dismissed = dismissed || event.time >= shown;
+                }
+            }
             break;
         }
 
-        std::this_thread::sleep_until(nextTick);
-        nextTick += frameDuration;
-        if (clock::now() > nextTick)
-            nextTick = clock::now() + frameDuration;
+        // Sleep until the tick where the night next changes on its own, the clock's next second
+        // or the next replayed key or tuning, unless a key press wakes us first.
+        int wakeTick = std::min(nextNightEvent(night),
+                                (night.tick / TICKS_PER_SECOND + 1) * TICKS_PER_SECOND - 1);
+        if (game.cameraUp)
+            wakeTick = std::min(wakeTick,
+                                (night.tick / CAMERA_FRAME_TICKS + 1) * CAMERA_FRAME_TICKS - 1);
+        if (replaying && nightLoop.nextReplayEvent < log.events.size())
+            wakeTick = std::min(wakeTick, log.events[nightLoop.nextReplayEvent].tick);
+        if (replaying && nightLoop.nextReplayTuning < log.tunings.size())
+            wakeTick = std::min(wakeTick, log.tunings[nightLoop.nextReplayTuning].tick);
+        ProfileScope scope(Phase::Sleep);
+        waitForEvent(loop, ticks.end(wakeTick));
     }
+    const auto nightEnd = clock::now();
 
+    stopInputThread(input);
+    stopRenderThread(render);
+    startup.firstFrame = render.totals.firstFrame;
+    if (watchTuning)
+    {
+        stopTuningWatcher(tuningWatcher);
+        takeTuningReload(tuningWatcher);
+    }
+    closeEventLoop(loop);
+    closeSpectatorWriter(spectators);
     endwin();
+    if (options.telemetryPath)
+    {
+        if (nightOutcome(game) == Outcome::Running)
+            logNightQuit(telemetry, night);
+        closeTelemetry(telemetry);
+    }
     shutdownAudio();
+
+    if (options.stats)
+    {
+        printFrames(render);
+        printLoopStats(loop.stats, nightEnd - nightStart, cpuStart);
+        printAudioStats();
+        printStartup(startup);
+        if (profilerEnabled())
+            printProfile();
+    }
+    if (options.bot)
+        printBotStats(bot.stats);
+    if (watchTuning)
+        printTuningReloads(options.tuningPath, tuningWatcher.reloads.front(), options.stats);
+    if (nightLoop.saveRequested && nightLoop.savedNight)
+        std::printf("Night saved to %s; continue it with --resume %s\n", options.savePath,
+                    options.savePath);
+    else if (nightLoop.saveRequested)
+        std::fprintf(stderr, "Could not save the night to %s\n", options.savePath);
+    if (options.tracePath && !writeTrace(options.tracePath))
+        std::fprintf(stderr, "Could not write trace to %s\n", options.tracePath);
+
+    if (options.recordPath)
+    {
+        log.endTick = night.tick;
+        log.outcome = nightOutcome(game);
+        if (!saveReplay(options.recordPath, log))
+        {
+            std::fprintf(stderr, "Could not write replay to %s\n", options.recordPath);
+            return 1;
+        }
+    }
     return 0;
 }
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <type_traits>
+
+// Checked numbers for the tools' command-line options. The whole argument has to be a number in
+// [min, max], so "-1", "abc" or "8x" are rejected instead of being read as garbage (strtoul
+// wraps "-1" round to the largest value, and "abc" reads as 0).
+
+// Most threads a --threads option may ask for; 0 still means one per core.
+constexpr unsigned MAX_THREADS = 1024;
+// Fastest a --speed option may run nights at.
+constexpr double MAX_SPEED = 1000.0;
+
+template <typename T>
+bool parseCount(const char *text, T min, T max, T &value)
+{
+    static_assert(std::is_unsigned<T>::value, "counts are unsigned");
+    if (*text < '0' || *text > '9')
+        return false;
+    errno = 0;
+    char *end;
+    const unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (errno == ERANGE || *end != '\0' || parsed < min || parsed > max)
+        return false;
+    value = static_cast<T>(parsed);
+    return true;
+}
+
+template <typename T>
+bool parseCount(const char *text, T &value)
+{
+    return parseCount(text, T{0}, std::numeric_limits<T>::max(), value);
+}
+
+template <typename T>
+bool parseReal(const char *text, double min, double max, T &value)
+{
+    static_assert(std::is_floating_point<T>::value, "reals are floating point");
+    char *end;
+    const double parsed = std::strtod(text, &end);
+    if (end == text || *end != '\0' || !std::isfinite(parsed) || parsed < min || parsed > max)
+        return false;
+    value = static_cast<T>(parsed);
+    return true;
+}
@@ -0,0 +1,163 @@
+// Asset packer: compresses the files in assets/ and writes them out as a C++ source file that
+// defines embeddedAssets(). The build runs it whenever an asset changes.
+
+#include "asset_pack.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct PackedAsset
+{
+    std::string name;
+    std::vector<uint8_t> packed;
+    uint32_t rawBytes = 0;
+    AssetCodec codec = AssetCodec::Stored;
+};
+
+static bool readFile(const char *path, std::vector<uint8_t> &bytes)
+{
+    std::FILE *in = std::fopen(path, "rb");
+    if (!in)
+        return false;
+    std::fseek(in, 0, SEEK_END);
+    bytes.resize(static_cast<size_t>(std::ftell(in)));
+    std::fseek(in, 0, SEEK_SET);
+    const bool read = std::fread(bytes.data(), 1, bytes.size(), in) == bytes.size();
+    std::fclose(in);
+    return read;
+}
+
+static std::string baseName(const char *path)
+{
+    const char *name = path;
+    for (const char *c = path; *c; ++c)
+    {
+        if (*c == '/' || *c == '\\')
+            name = c + 1;
+    }
+    return name;
+}
+
+// Keeps the smallest codec whose output unpacks back to the original.
+static void packSmallest(const std::vector<uint8_t> &raw, PackedAsset &asset)
+{
+    asset.rawBytes = static_cast<uint32_t>(raw.size());
+    asset.packed = raw;
+    asset.codec = AssetCodec::Stored;
+
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> check;
+    for (AssetCodec codec : {AssetCodec::Lz, AssetCodec::Pcm16})
+    {
+        if (!packAsset(codec, raw, packed) || packed.size() >= asset.packed.size())
+            continue;
+        if (!unpackBytes(codec, packed.data(), packed.size(), raw.size(), check) || check != raw)
+        {
+            std::fprintf(stderr, "%s: %s codec failed to round-trip\n", asset.name.c_str(),
+                         codecName(codec));
+            continue;
+        }
+        asset.packed = packed;
+        asset.codec = codec;
+    }
+}
+
+static bool writeSource(const char *path, const std::vector<PackedAsset> &assets)
+{
+    std::FILE *out = std::fopen(path, "w");
+    if (!out)
+        return false;
+
+    std::fprintf(out, "// Generated by console_fnaf_pack from assets/. Do not edit.\n\n"
+                      "#include \"asset_pack.hpp\"\n\n"
+                      "alignas(8) static const uint8_t packData[] = {\n");
+    size_t total = 0;
+    for (const PackedAsset &asset : assets)
+    {
+        for (size_t i = 0; i < asset.packed.size(); ++i)
+            std::fprintf(out, "%s%u,%s", i % 24 == 0 ? "    " : "", asset.packed[i],
+                         i % 24 == 23 || i + 1 == asset.packed.size() ? "\n" : "");
+        total += asset.packed.size();
+    }
+    if (total == 0)
+        std::fprintf(out, "    0,\n");
+
+    std::fprintf(out, "};\n\nstatic const AssetEntry packIndex[] = {\n");
+    size_t offset = 0;
+    for (const PackedAsset &asset : assets)
+    {
+        std::fprintf(out, "    {\"%s\", %zu, %zu, %u, AssetCodec::%s},\n", asset.name.c_str(),
+                     offset, asset.packed.size(), asset.rawBytes,
+                     asset.codec == AssetCodec::Pcm16 ? "Pcm16"
+                     : asset.codec == AssetCodec::Lz  ? "Lz"
+                                                      : "Stored");
+        offset += asset.packed.size();
+    }
+    if (assets.empty())
+        std::fprintf(out, "    {\"\", 0, 0, 0, AssetCodec::Stored},\n");
+
+    std::fprintf(out,
+                 "};\n\n"
+                 "const AssetPack &embeddedAssets()\n"
+                 "{\n"
+                 "    static const AssetPack pack{packIndex, %zu, packData};\n"
+                 "    return pack;\n"
+                 "}\n",
+                 assets.size());
+    return std::fclose(out) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s OUT.cpp [FILE]...\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<PackedAsset> assets;
+    for (int i = 2; i < argc; ++i)
+    {
+        std::vector<uint8_t> raw;
+        if (!readFile(argv[i], raw))
+        {
+            std::fprintf(stderr, "%s: can't read the file\n", argv[i]);
+            return 1;
+        }
+        PackedAsset asset;
+        asset.name = baseName(argv[i]);
+        if (asset.name.find_first_of("\"\\") != std::string::npos)
+        {
+            std::fprintf(stderr, "%s: unsupported file name\n", argv[i]);
+            return 1;
+        }
+        packSmallest(raw, asset);
+        assets.push_back(std::move(asset));
+    }
+
+    std::sort(assets.begin(), assets.end(),
+              [](const PackedAsset &a, const PackedAsset &b) { return a.name < b.name; });
+    for (size_t i = 1; i < assets.size(); ++i)
+    {
+        if (assets[i].name == assets[i - 1].name)
+        {
+            std::fprintf(stderr, "%s: two assets share this name\n", assets[i].name.c_str());
+            return 1;
+        }
+    }
+
+    for (const PackedAsset &asset : assets)
+        std::printf("%-24s %8u -> %8zu bytes (%.1f%%, %s)\n", asset.name.c_str(), asset.rawBytes,
+                    asset.packed.size(),
+                    asset.rawBytes > 0 ? 100.0 * asset.packed.size() / asset.rawBytes : 100.0,
+                    codecName(asset.codec));
+    if (!writeSource(argv[1], assets))
+    {
+        std::fprintf(stderr, "%s: can't write the file\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
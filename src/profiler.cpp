@@ -0,0 +1,159 @@
+#include "profiler.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+struct TraceSpan
+{
+    Phase phase;
+    int64_t startNanos;
+    int64_t durationNanos;
+};
+
+// Phases are recorded from both the game loop and the render thread; the lock covers the
+// histograms and spans.
+static std::atomic<bool> enabled{false};
+static std::atomic<bool> tracing{false};
+static std::mutex recording;
+static Histogram histograms[static_cast<int>(Phase::Count)];
+static std::vector<TraceSpan> spans;
+static std::chrono::steady_clock::time_point origin;
+
+const char *phaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case Phase::Input:
+        return "input";
+    case Phase::Simulate:
+        return "simulate";
+    case Phase::Draw:
+        return "draw";
+    case Phase::Sleep:
+        return "sleep";
+    case Phase::KeyToScreen:
+        return "key->screen";
+    case Phase::Count:
+        break;
+    }
+    return "?";
+}
+
+static int bucketOf(uint64_t nanos)
+{
+    if (nanos < Histogram::SUB_BUCKETS)
+        return static_cast<int>(nanos);
+    int exponent = 63;
+    while (!(nanos >> exponent))
+        exponent--;
+    const int shift = exponent - Histogram::SUB_BITS;
+    const int sub = static_cast<int>((nanos >> shift) & (Histogram::SUB_BUCKETS - 1));
+    return Histogram::SUB_BUCKETS * (shift + 1) + sub;
+}
+
+static uint64_t bucketStart(int bucket)
+{
+    if (bucket < Histogram::SUB_BUCKETS)
+        return static_cast<uint64_t>(bucket);
+    const int shift = bucket / Histogram::SUB_BUCKETS - 1;
+    const uint64_t sub = static_cast<uint64_t>(bucket % Histogram::SUB_BUCKETS);
+    return (Histogram::SUB_BUCKETS + sub) << shift;
+}
+
+void Histogram::record(uint64_t nanos)
+{
+    counts[bucketOf(nanos)]++;
+    total++;
+    if (nanos > max)
+        max = nanos;
+}
+
+uint64_t Histogram::percentile(double fraction) const
+{
+    if (total == 0)
+        return 0;
+    const uint64_t wanted = static_cast<uint64_t>(fraction * (total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        seen += counts[i];
+        if (seen >= wanted)
+            return bucketStart(i) < max ? bucketStart(i) : max;
+    }
+    return max;
+}
+
+void enableProfiler(bool trace)
+{
+    std::lock_guard<std::mutex> lock(recording);
+    if (!enabled.load(std::memory_order_relaxed))
+        origin = std::chrono::steady_clock::now();
+    enabled.store(true, std::memory_order_relaxed);
+    if (trace && !tracing.load(std::memory_order_relaxed))
+    {
+        tracing.store(true, std::memory_order_relaxed);
+        spans.reserve(1 << 16);
+    }
+}
+
+bool profilerEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void recordPhase(Phase phase, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end)
+{
+    if (!enabled.load(std::memory_order_relaxed))
+        return;
+    const int64_t nanos =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    std::lock_guard<std::mutex> lock(recording);
+    histograms[static_cast<int>(phase)].record(nanos > 0 ? static_cast<uint64_t>(nanos) : 0);
+
+    if (tracing)
+    {
+        const int64_t since =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+        spans.push_back({phase, since, nanos});
+    }
+}
+
+const Histogram &phaseHistogram(Phase phase)
+{
+    return histograms[static_cast<int>(phase)];
+}
+
+bool writeTrace(const char *path)
+{
+    std::FILE *file = std::fopen(path, "w");
+    if (!file)
+        return false;
+
+    // Drawing runs on its own thread and key latency spans overlap everything, so each gets a
+    // track of its own.
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        const TraceSpan &span = spans[i];
+        std::fprintf(file,
+                     "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+                     "\"dur\":%.3f}%s\n",
+                     phaseName(span.phase),
+                     span.phase == Phase::KeyToScreen ? 2 : span.phase == Phase::Draw ? 3 : 1,
+                     span.startNanos / 1000.0, span.durationNanos / 1000.0,
+                     i + 1 < spans.size() ? "," : "");
+    }
+    std::fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+    return std::fclose(file) == 0;
+}
+
+void formatPhaseSummary(Phase phase, char *out, size_t size)
+{
+    std::lock_guard<std::mutex> lock(recording);
+    const Histogram &h = phaseHistogram(phase);
+    std::snprintf(out, size, "%-11s %7.3f %7.3f %7.3f", phaseName(phase),
+                  h.percentile(0.50) / 1e6, h.percentile(0.99) / 1e6, h.max / 1e6);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Where the game loop's time goes. Each phase gets a histogram and, when tracing, a span in a
+// Chrome trace-event timeline (load the file in chrome://tracing or ui.perfetto.dev).
+enum class Phase
+{
+    Input,       // applying queued keys
+    Simulate,    // stepping ticks
+    Draw,        // drawUI on the render thread, including the terminal write
+    Sleep,       // the game loop waiting for the next key or event
+    KeyToScreen, // key arrival until the frame showing it was written
+    Count,
+};
+
+const char *phaseName(Phase phase);
+
+// Log-linear histogram over nanoseconds: 16 buckets per power of two, so any percentile is
+// within ~6% of the true value, in fixed memory with O(1) recording.
+struct Histogram
+{
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = SUB_BUCKETS * (64 - SUB_BITS + 1);
+
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t max = 0;
+
+    void record(uint64_t nanos);
+    // Smallest value at or above the given fraction (0..1) of the samples.
+    uint64_t percentile(double fraction) const;
+};
+
+// Everything is a no-op until enableProfiler, so builds that never turn it on pay one branch
+// per phase.
+void enableProfiler(bool trace);
+bool profilerEnabled();
+
+void recordPhase(Phase phase, std::chrono::steady_clock::time_point start,
+                 std::chrono::steady_clock::time_point end);
+const Histogram &phaseHistogram(Phase phase);
+
+// Writes the recorded spans as Chrome trace-event JSON; false if the file can't be written.
+bool writeTrace(const char *path);
+
+// One line per phase: name, p50, p99 and max in milliseconds, for the overlay and --stats.
+void formatPhaseSummary(Phase phase, char *out, size_t size);
+
+// Times the enclosing scope as `phase`.
+struct ProfileScope
+{
+    Phase phase;
+    std::chrono::steady_clock::time_point start;
+
+    explicit ProfileScope(Phase p) : phase(p)
+    {
+        if (profilerEnabled())
+            start = std::chrono::steady_clock::now();
+    }
+    ~ProfileScope()
+    {
+        if (profilerEnabled() && start.time_since_epoch().count() != 0)
+            recordPhase(phase, start, std::chrono::steady_clock::now());
+    }
+};
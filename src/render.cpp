@@ -1,122 +1,233 @@
 #include "render.hpp"
+#include "profiler.hpp"
+#include "room_graph.hpp"
 
-#include <chrono>
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
+#include <string>
 #include <ncurses/curses.h>
-#include <thread>
-
-struct ScreenPos
-{
-    int row;
-    int col;
-};
 
 constexpr int MAP_START_ROW = 10;
-constexpr int MAP_WIDTH = 28;
+constexpr int MAP_WIDTH = 28; // the map is centred under the title as if at least this wide
 constexpr const char *TITLE_LINE = "=====         SURVIVE2SUNRISE        =====";
 constexpr int TITLE_WIDTH = 42;
 
-// Positions relative to the map's top-left corner (map drawn at mapCol, MAP_START_ROW).
-constexpr ScreenPos ROOM_OFFSETS[] = {
-    {0, 0},  // unused (index 0)
-    {0, 11}, // [1]
-    {2, 1},  // [2]
-    {2, 17}, // [3]
-    {5, 1},  // [4]
-    {5, 23}, // [5]
-    {8, 4},  // [6]
-    {8, 17}, // [7]
-};
-
-constexpr int LEFT_DOOR_COL = 3;
-constexpr int RIGHT_DOOR_COL = 16;
-
-constexpr const char *MAP_LINES[] = {
-    "          [1]      ", "           |       ", "[2]-------------[3]",
-    " |               | ", " |               | ", "[4]--------------+----[5]",
-    " |               | ", " |               | ", " --[6]---|YOU|--[7]",
-};
-constexpr int MAP_HEIGHT = 9;
-
-int mapStartCol()
-{
-    int col = (TITLE_WIDTH - MAP_WIDTH) / 2;
+// Room and corridor layout come from the active RoomGraph: its art is drawn at
+// (MAP_START_ROW, mapStartCol()) and each room's label position is relative to that corner.
+static int mapStartCol()
+{
+    int width = MAP_WIDTH;
+    for (const std::string &line : activeRoomGraph().art)
+        width = std::max(width, static_cast<int>(line.size()));
+    int col = (TITLE_WIDTH - width) / 2;
     return col < 0 ? 0 : col;
 }
 
+static Framebuffer screen;
+static FrameStats lastStats;
+
+// A quarter second of static when the monitor comes up, switches camera or sees an animatronic
+// come or go.
+constexpr int CAMERA_STATIC_TICKS = 15;
+static const char NOISE[] = ".:;'`,*";
+
+// Set before any drawing starts and only read after, so every thread can share it.
+static const CameraFeeds *cameraFeeds = nullptr;
+static CameraView screenCamera;
+
 void initTerminalColors()
 {
-    if (has_colors())
-    {
-        start_color();
-        init_pair(1, COLOR_RED, COLOR_BLACK);    // Low battery
-        init_pair(2, COLOR_YELLOW, COLOR_BLACK); // Medium battery
-        init_pair(3, COLOR_GREEN, COLOR_BLACK);  // High battery
-        init_pair(4, COLOR_RED, COLOR_BLACK);    // Freddo on map
-        init_pair(5, COLOR_CYAN, COLOR_BLACK);   // Chico on map
-        init_pair(6, COLOR_YELLOW, COLOR_BLACK); // Closed door indicator
-    }
+    screen.useColor = has_colors();
+    enableTerminalEscapes();
+}
+
+void setRenderOutput(std::FILE *output)
+{
+    screen.output = output;
+    screen.invalid = true;
+}
+
+void invalidateScreen()
+{
+    screen.invalid = true;
+}
+
+const FrameStats &lastFrameStats()
+{
+    return lastStats;
+}
+
+const Framebuffer &renderedScreen()
+{
+    return screen;
+}
+
+void setCameraFeeds(const CameraFeeds *feeds)
+{
+    cameraFeeds = feeds && feeds->feedCount > 0 ? feeds : nullptr;
 }
 
-void drawEnemy(char symbol, int room, int mapCol)
+const CameraFrameCache &cameraFrameCache()
 {
-    if (room <= 0 || room >= 8)
+    return screenCamera.frames;
+}
+
+static void drawEnemy(Framebuffer &fb, char symbol, int room, int mapCol, Color color)
+{
+    const RoomGraph &graph = activeRoomGraph();
+    if (!graph.drawn(room))
         return;
 
-    const ScreenPos &pos = ROOM_OFFSETS[room];
-    mvaddch(MAP_START_ROW + pos.row, mapCol + pos.col, symbol);
+    const RoomLabel &pos = graph.labels[room];
+    fb.put(MAP_START_ROW + pos.row, mapCol + pos.col, symbol, color);
 }
 
-void drawDoorOnMap(int mapCol, int doorCol, char label, bool closed)
+// A closed door covers its room's number, "[6]" -> "[#]".
+static void drawDoorOnMap(Framebuffer &fb, int mapCol, int doorRoom, bool closed)
 {
-    int row = MAP_START_ROW + ROOM_OFFSETS[6].row;
+    const RoomGraph &graph = activeRoomGraph();
+    if (!closed || !graph.drawn(doorRoom))
+        return;
 
-    if (closed && has_colors())
-        attron(COLOR_PAIR(6) | A_BOLD);
+    const RoomLabel &pos = graph.labels[doorRoom];
+    const int row = MAP_START_ROW + pos.row;
+    int col = mapCol + pos.col;
+    fb.put(row, col - 1, '[', Color::Yellow, true);
+    for (int digits = doorRoom; digits > 0; digits /= 10)
+        fb.put(row, col++, '#', Color::Yellow, true);
+    fb.put(row, col, ']', Color::Yellow, true);
+}
 
-    mvaddch(row, mapCol + doorCol, '[');
-    mvaddch(row, mapCol + doorCol + 1, closed ? '#' : label);
-    mvaddch(row, mapCol + doorCol + 2, ']');
+static void drawDoorStatus(Framebuffer &fb, int row, const char *label, bool closed)
+{
+    fb.print(row, 0, label);
+    const int labelEnd = static_cast<int>(std::strlen(label));
+    fb.print(row, labelEnd, ": ");
 
-    if (closed && has_colors())
-        attroff(COLOR_PAIR(6) | A_BOLD);
+    if (closed)
+        fb.print(row, labelEnd + 2, "CLOSED", Color::Yellow, true);
+    else
+        fb.print(row, labelEnd + 2, "OPEN");
 }
 
-void drawDoorStatus(int row, const char *label, bool closed)
+static void drawMap(Framebuffer &fb, int mapCol)
 {
-    mvprintw(row, 0, "%s: ", label);
-    const int statusCol = static_cast<int>(std::strlen(label)) + 2;
-    const char *status = closed ? "CLOSED" : "OPEN";
+    int row = MAP_START_ROW;
+    for (const std::string &line : activeRoomGraph().art)
+        fb.print(row++, mapCol, line.c_str());
+}
 
-    if (closed && has_colors())
-        attron(COLOR_PAIR(6) | A_BOLD);
+// Hash of a frame step and a cell, so the static is the same whenever the same frame is drawn.
+static uint32_t noise(uint32_t step, uint32_t cell)
+{
+    uint32_t x = step * 0x9e3779b1u ^ cell * 0x85ebca77u;
+    x ^= x >> 15;
+    x *= 0x2c1b3c6du;
+    x ^= x >> 12;
+    x *= 0x297a2d39u;
+    return x ^ (x >> 15);
+}
 
-    mvprintw(row, statusCol, "%s", status);
+static void drawSprite(Framebuffer &fb, const CameraSprite &sprite, int row, int col, Color color)
+{
+    for (int r = 0; r < sprite.rows && row + r < MAP_START_ROW + CAMERA_ROWS; ++r)
+    {
+        for (int c = 0; c < sprite.cols && col + c < CAMERA_COLS; ++c)
+        {
+            if (sprite.cells[r][c] != ' ')
+                fb.put(row + r, col + c, sprite.cells[r][c], color, true);
+        }
+    }
+}
 
-    if (closed && has_colors())
-        attroff(COLOR_PAIR(6) | A_BOLD);
+// The monitor, in place of the map: the room's feed with whoever is in the room drawn over it,
+// a few specks of noise, and heavy static for a moment after anything changes.
+static void drawCamera(Framebuffer &fb, CameraView &view, const GameState &game)
+{
+    const int tick = game.hoursSurvived * TICKS_PER_HOUR + game.hourTicks;
+    const uint32_t step = static_cast<uint32_t>(tick / CAMERA_FRAME_TICKS);
+    const int feed = cameraFeeds ? findCameraFeed(*cameraFeeds, game.camera) : -1;
+    const int occupants =
+        (game.freddoPos == game.camera ? 1 : 0) | (game.chicoPos == game.camera ? 2 : 0);
+    if (game.camera != view.shownCamera || occupants != view.shownOccupants)
+        view.staticUntilTick = tick + CAMERA_STATIC_TICKS;
+    view.shownCamera = game.camera;
+    view.shownOccupants = occupants;
+
+    char title[64];
+    if (feed >= 0)
+        std::snprintf(title, sizeof title, "CAM %d  %s", game.camera,
+                      cameraFeeds->feeds[feed].name);
+    else
+        std::snprintf(title, sizeof title, "CAM %d", game.camera);
+    fb.print(MAP_START_ROW - 1, 1, title, Color::Cyan, true);
+    if (tick / (TICKS_PER_SECOND / 2) % 2 == 0)
+        fb.print(MAP_START_ROW - 1, CAMERA_COLS - 6, "o REC", Color::Red, true);
+
+    if (feed >= 0)
+    {
+        const CameraFeed &source = cameraFeeds->feeds[feed];
+        const char *cells =
+            cameraFrame(*cameraFeeds, view.frames, feed, step % source.frameCount);
+        for (int row = 0; row < CAMERA_ROWS; ++row)
+            for (int col = 0; col < CAMERA_COLS; ++col)
+                fb.put(MAP_START_ROW + row, col, cells[row * CAMERA_COLS + col]);
+
+        // A second animatronic stands beside the first.
+        int spotCol = source.spotCol;
+        const int spotRow = MAP_START_ROW + source.spotRow;
+        if (occupants & 1)
+        {
+            drawSprite(fb, cameraFeeds->sprites[FREDDO_ROUTE], spotRow, spotCol, Color::Red);
+            spotCol += SPRITE_COLS + 1;
+        }
+        if (occupants & 2)
+            drawSprite(fb, cameraFeeds->sprites[CHICO_ROUTE], spotRow, spotCol, Color::Cyan);
+    }
+
+    const bool burst = feed < 0 || tick < view.staticUntilTick;
+    for (int cell = 0; cell < CAMERA_CELLS; ++cell)
+    {
+        const uint32_t speck = noise(step, static_cast<uint32_t>(cell));
+        if (burst ? (speck & 3) != 0 : speck % 61 == 0)
+            fb.put(MAP_START_ROW + cell / CAMERA_COLS, cell % CAMERA_COLS,
+                   NOISE[(speck >> 8) % (sizeof NOISE - 1)]);
+    }
+    if (feed < 0)
+        fb.print(MAP_START_ROW + CAMERA_ROWS / 2, CAMERA_COLS / 2 - 6, " NO SIGNAL ", Color::Red,
+                 true);
 }
 
-void drawMap(int mapCol)
+static void drawProfilerOverlay(Framebuffer &fb, int row, int col)
 {
-    for (int i = 0; i < MAP_HEIGHT; ++i)
-        mvprintw(MAP_START_ROW + i, mapCol, MAP_LINES[i]);
+    char line[64];
+    std::snprintf(line, sizeof line, "%-11s %7s %7s %7s", "phase (ms)", "p50", "p99", "max");
+    fb.print(row++, col, line, Color::Cyan);
+    for (int i = 0; i < static_cast<int>(Phase::Count); ++i)
+    {
+        formatPhaseSummary(static_cast<Phase>(i), line, sizeof line);
+        fb.print(row++, col, line);
+    }
 }
 
-void drawUI(const GameState &game)
+void drawNightFrame(Framebuffer &fb, CameraView &camera, const GameState &game,
+                    bool profilerOverlay, bool localKeys)
 {
-    clear();
+    fb.clear();
     int displayTime = (12 + game.hoursSurvived) % 12;
     if (displayTime == 0)
         displayTime = 12;
 
-    int seconds = static_cast<int>(game.hourProgress * 60.0f);
+    int seconds = game.hourTicks * 60 / TICKS_PER_HOUR;
     if (seconds >= 60)
         seconds = 59;
 
-    mvprintw(0, 0, "%s", TITLE_LINE);
-    mvprintw(1, 0, "=====   Developed by Mahdi Tanzim    =====");
-    mvprintw(3, 0, "Time: %02d:%02d AM", displayTime, seconds);
+    char text[64];
+    fb.print(0, 0, TITLE_LINE);
+    fb.print(1, 0, "=====   Developed by Mahdi Tanzim    =====");
+    std::snprintf(text, sizeof text, "Time: %02d:%02d AM", displayTime, seconds);
+    fb.print(3, 0, text);
 
     constexpr int BAR_WIDTH = 20;
     int battery = game.battery;
@@ -127,108 +238,103 @@ void drawUI(const GameState &game)
     int filled = (battery * BAR_WIDTH) / 100;
 
     int row = 4, col = 0;
-    mvprintw(row, col, "Battery: ");
+    fb.print(row, col, "Battery: ");
     int barCol = col + 9;
-    mvaddch(row, barCol++, '[');
+    fb.put(row, barCol++, '[');
 
-    int colorPair = 3;
+    Color barColor = Color::Green;
     if (battery <= 20)
-        colorPair = 1;
+        barColor = Color::Red;
     else if (battery <= 50)
-        colorPair = 2;
-
-    bool useColor = has_colors();
-    if (useColor)
-        attron(COLOR_PAIR(colorPair));
+        barColor = Color::Yellow;
 
     for (int i = 0; i < BAR_WIDTH; ++i)
-    {
-        if (i < filled)
-            mvaddch(row, barCol++, '=');
-        else
-            mvaddch(row, barCol++, ' ');
-    }
+        fb.put(row, barCol++, i < filled ? '=' : ' ', barColor);
 
-    if (useColor)
-        attroff(COLOR_PAIR(colorPair));
-    mvaddch(row, barCol++, ']');
-    mvprintw(row, barCol + 1, " %3d%%", battery);
+    fb.put(row, barCol++, ']');
+    std::snprintf(text, sizeof text, " %3d%%", battery);
+    fb.print(row, barCol + 1, text);
 
-    drawDoorStatus(5, "Left Door", game.leftDoor);
-    drawDoorStatus(6, "Right Door", game.rightDoor);
+    drawDoorStatus(fb, 5, "Left Door", game.leftDoor);
+    drawDoorStatus(fb, 6, "Right Door", game.rightDoor);
 
-    mvprintw(7, 0, "Freddo (F) - Stalks the west wing.");
-    mvprintw(8, 0, "Chico (C) - Closes in from the east.");
+    fb.print(7, 0, "Freddo (F) - Stalks the west wing.");
+    fb.print(8, 0, "Chico (C) - Closes in from the east.");
 
+    const RoomGraph &graph = activeRoomGraph();
     const int mapCol = mapStartCol();
-    drawMap(mapCol);
-
-    drawDoorOnMap(mapCol, LEFT_DOOR_COL, '6', game.leftDoor);
-    drawDoorOnMap(mapCol, RIGHT_DOOR_COL, '7', game.rightDoor);
+    const int mapRows = static_cast<int>(graph.art.size());
+    // The controls stay put whether the map or the camera is up.
+    const int controlsRow = MAP_START_ROW + std::max(mapRows, CAMERA_ROWS) + 1;
 
-    mvprintw(20, 0, "Controls: [A] Left | [D] Right | [Q] Quit");
-
-    if (game.freddoPos == game.chicoPos)
-    {
-        const ScreenPos &pos = ROOM_OFFSETS[game.freddoPos];
-        attron(COLOR_PAIR(1));
-        mvaddch(MAP_START_ROW + pos.row, mapCol + pos.col, 'X');
-        attroff(COLOR_PAIR(1));
-    }
+    if (game.cameraUp)
+        drawCamera(fb, camera, game);
     else
     {
-        if (useColor)
-            attron(COLOR_PAIR(4));
-        drawEnemy('F', game.freddoPos, mapCol);
-        if (useColor)
-            attroff(COLOR_PAIR(4));
-
-        if (useColor)
-            attron(COLOR_PAIR(5));
-        drawEnemy('C', game.chicoPos, mapCol);
-        if (useColor)
-            attroff(COLOR_PAIR(5));
+        camera.shownCamera = -1;
+        drawMap(fb, mapCol);
+        drawDoorOnMap(fb, mapCol, graph.routes[FREDDO_ROUTE].doorRoom, game.leftDoor);
+        drawDoorOnMap(fb, mapCol, graph.routes[CHICO_ROUTE].doorRoom, game.rightDoor);
+
+        if (game.freddoPos == game.chicoPos)
+            drawEnemy(fb, 'X', game.freddoPos, mapCol, Color::Red);
+        else
+        {
+            drawEnemy(fb, 'F', game.freddoPos, mapCol, Color::Red);
+            drawEnemy(fb, 'C', game.chicoPos, mapCol, Color::Cyan);
+        }
     }
-    refresh();
+
+    fb.print(controlsRow, 0,
+             localKeys
+                 ? "Controls: [A] Left | [D] Right | [S] Save & quit | [P] Profiler | [Q] Quit"
+                 : "Controls: [A] Left | [D] Right | [Q] Quit");
+    fb.print(controlsRow + 1, 0,
+             game.cameraUp ? "Cameras:  [C] Map | [1-9] Room | [<] [>] Previous, next"
+                           : "Cameras:  [C] Monitor | [1-9] Room | [<] [>] Previous, next");
+
+    if (profilerOverlay)
+        drawProfilerOverlay(fb, 3, TITLE_WIDTH + 2);
 }
 
-bool checkGameOver(GameState &game)
+void drawUI(const GameState &game, bool profilerOverlay)
 {
-    if (game.battery <= 0)
-    {
-        clear();
-        mvprintw(0, 0, "Battery died.  You sense their approach. (GAME OVER)");
-        refresh();
-        std::this_thread::sleep_for(std::chrono::seconds(3));
-        return true;
-    }
+    drawNightFrame(screen, screenCamera, game, profilerOverlay);
+    lastStats = presentFrame(screen);
+}
 
-    if (game.freddoPos == 7 && !game.leftDoor)
+void drawGameOverFrame(Framebuffer &fb, Outcome outcome)
+{
+    const char *message = "";
+    switch (outcome)
     {
-        clear();
-        mvprintw(0, 0, "Freddo appears at the door. (GAME OVER)");
-        refresh();
-        std::this_thread::sleep_for(std::chrono::seconds(3));
-        return true;
+    case Outcome::Running:
+        break;
+    case Outcome::BatteryDied:
+        message = "Battery died.  You sense their approach. (GAME OVER)";
+        break;
+    case Outcome::FreddoGotIn:
+        message = "Freddo appears at the door. (GAME OVER)";
+        break;
+    case Outcome::ChicoGotIn:
+        message = "Chico found you. (GAME OVER)";
+        break;
+    case Outcome::Survived:
+        message = "It's 6AM, see you in the next shift!";
+        break;
     }
 
-    if (game.chicoPos == 8 && !game.rightDoor)
-    {
-        clear();
-        mvprintw(0, 0, "Chico found you. (GAME OVER)");
-        refresh();
-        std::this_thread::sleep_for(std::chrono::seconds(3));
-        return true;
-    }
+    fb.clear();
+    fb.print(0, 0, message);
+}
 
-    if (game.hoursSurvived >= 6)
-    {
-        clear();
-        mvprintw(0, 0, "It's 6AM, see you in the next shift!");
-        refresh();
-        std::this_thread::sleep_for(std::chrono::seconds(3));
-        return true;
-    }
+bool checkGameOver(GameState &game)
+{
+    const Outcome outcome = nightOutcome(game);
+    if (outcome == Outcome::Running)
+        return false;
 
-    return false;
+    drawGameOverFrame(screen, outcome);
+    lastStats = presentFrame(screen);
+    return true;
 }
@@ -1,7 +1,45 @@
 #pragma once
 
+#include "camera_feeds.hpp"
+#include "framebuffer.hpp"
 #include "game_state.hpp"
 
+#include <cstdio>
+
+// What one screen's camera monitor showed last, to tell when to put static over it, and the
+// frames it decoded. Each screen has its own, so screens drawn on different threads (the
+// server's sessions) share nothing but the feeds.
+struct CameraView
+{
+    CameraFrameCache frames;
+    int shownCamera = -1;
+    int shownOccupants = 0;
+    int staticUntilTick = 0;
+};
+
 void initTerminalColors();
-void drawUI(const GameState &game);
+// Where frames are written; stdout unless redirected (e.g. by the benchmarks).
+void setRenderOutput(std::FILE *output);
+// Forces the next frame to repaint every cell (e.g. after a terminal resize).
+void invalidateScreen();
+// Cells and bytes the last drawUI or checkGameOver sent to the terminal.
+const FrameStats &lastFrameStats();
+// The screen as drawUI or checkGameOver last drew it.
+const Framebuffer &renderedScreen();
+// What the camera monitor shows. `feeds` must outlive the drawing; until it is set, or if it
+// has no feeds, every camera shows static.
+void setCameraFeeds(const CameraFeeds *feeds);
+// Frames decoded for the monitor so far, for --stats.
+const CameraFrameCache &cameraFrameCache();
+// With `profilerOverlay`, also shows live frame-phase percentiles beside the map.
+void drawUI(const GameState &game, bool profilerOverlay = false);
+// Shows the game-over message if the night is decided; true if it is. Doesn't wait: the
+// caller decides how long the message stays up.
 bool checkGameOver(GameState &game);
+
+// The same screens drawn into any Framebuffer without sending them, e.g. one per network
+// session. `camera` belongs to that screen. Without `localKeys` the controls leave out the
+// keys only the terminal game has (save and profiler).
+void drawNightFrame(Framebuffer &fb, CameraView &camera, const GameState &game,
+                    bool profilerOverlay = false, bool localKeys = true);
+void drawGameOverFrame(Framebuffer &fb, Outcome outcome);
@@ -0,0 +1,85 @@
+#include "render_thread.hpp"
+
+#include "profiler.hpp"
+#include "render.hpp"
+
+#include <functional>
+
+static void drawSnapshot(RenderThread &render, const RenderSnapshot &snapshot,
+                         uint32_t &resizes)
+{
+    if (snapshot.resizes != resizes)
+    {
+        invalidateScreen();
+        resizes = snapshot.resizes;
+    }
+    {
+        ProfileScope scope(Phase::Draw);
+        GameState game = snapshot.game;
+        if (!checkGameOver(game))
+            drawUI(game, snapshot.profilerOverlay);
+        if (render.spectators)
+            publishFrame(*render.spectators, renderedScreen());
+    }
+
+    const auto drawn = std::chrono::steady_clock::now();
+    RenderTotals &totals = render.totals;
+    const FrameStats &stats = lastFrameStats();
+    if (totals.frames == 0)
+    {
+        totals.first = stats;
+        totals.firstFrame = drawn;
+    }
+    else
+    {
+        totals.cells += stats.cells;
+        totals.bytes += stats.bytes;
+    }
+    totals.frames++;
+
+    AppliedKey key;
+    while (render.keys.peek(key) && key.tick <= snapshot.tick)
+    {
+        render.keys.pop();
+        recordPhase(Phase::KeyToScreen, key.pressed, drawn);
+    }
+}
+
+static void renderLoop(RenderThread &render)
+{
+    uint32_t resizes = 0;
+    for (;;)
+    {
+        // Read stop first: whatever was published before it was set is still drawn.
+        const bool stopping = render.stop.load(std::memory_order_acquire);
+        if (render.snapshots.update())
+            drawSnapshot(render, render.snapshots.front(), resizes);
+        else if (stopping)
+            break;
+        else
+            waitForEvent(render.loop, std::chrono::steady_clock::now() + std::chrono::seconds(1));
+    }
+}
+
+void startRenderThread(RenderThread &render)
+{
+    render.stop = false;
+    initEventLoop(render.loop);
+    render.thread = std::thread(renderLoop, std::ref(render));
+}
+
+void publishSnapshot(RenderThread &render)
+{
+    if (render.snapshots.publish())
+        render.dropped++;
+    wakeEventLoop(render.loop);
+}
+
+void stopRenderThread(RenderThread &render)
+{
+    render.stop.store(true, std::memory_order_release);
+    wakeEventLoop(render.loop);
+    if (render.thread.joinable())
+        render.thread.join();
+    closeEventLoop(render.loop);
+}
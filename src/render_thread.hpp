@@ -0,0 +1,62 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "framebuffer.hpp"
+#include "game_state.hpp"
+#include "spectator.hpp"
+#include "spsc_ring.hpp"
+#include "triple_buffer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+// Everything a frame is drawn from, copied out of the simulation once per change.
+struct RenderSnapshot
+{
+    GameState game;
+    bool profilerOverlay;
+    uint32_t resizes; // the screen is repainted in full when this changes
+    int tick;
+};
+
+// A key the simulation applied on `tick`, for key-to-screen latency: it counts as shown once
+// a frame from that tick or later is on screen.
+struct AppliedKey
+{
+    int tick;
+    std::chrono::steady_clock::time_point pressed;
+};
+
+struct RenderTotals
+{
+    uint64_t frames = 0;
+    uint64_t cells = 0; // after the first frame
+    uint64_t bytes = 0;
+    FrameStats first;
+    std::chrono::steady_clock::time_point firstFrame;
+};
+
+// Draws the game on its own thread so a slow terminal write never holds up the simulation.
+// The simulation publishes snapshots through a triple buffer and wakes the thread; it draws
+// only the newest one, and snapshots published while it was still writing are skipped.
+// While it runs, this thread is the only one writing to the terminal and the spectators.
+struct RenderThread
+{
+    TripleBuffer<RenderSnapshot> snapshots;
+    SpscRing<AppliedKey, 256> keys;
+    EventLoop loop;
+    std::atomic<bool> stop{false};
+    std::thread thread;
+    SpectatorWriter *spectators = nullptr; // each frame is published to it, if set
+    uint64_t dropped = 0;                  // simulation side: snapshots never drawn
+    RenderTotals totals;                   // render side; read after stopRenderThread
+};
+
+// Call after initscr and initTerminalColors; stop it before endwin.
+void startRenderThread(RenderThread &render);
+// Simulation side: hands over render.snapshots.back() and wakes the thread.
+void publishSnapshot(RenderThread &render);
+// Draws whatever was published last, then joins the thread.
+void stopRenderThread(RenderThread &render);
@@ -0,0 +1,189 @@
+#include "replay.hpp"
+
+#include "event_sim.hpp"
+#include "input.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+static constexpr char REPLAY_MAGIC[4] = {'S', '2', 'S', 'R'};
+static constexpr uint8_t REPLAY_VERSION = 2;
+static constexpr uint8_t UNTUNED_REPLAY_VERSION = 1;
+
+static void putVarint(std::vector<uint8_t> &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+static bool getVarint(const std::vector<uint8_t> &in, size_t &pos, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7)
+    {
+        const uint8_t byte = in[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool saveReplay(const char *path, const ReplayLog &log)
+{
+    std::vector<uint8_t> out(REPLAY_MAGIC, REPLAY_MAGIC + 4);
+    out.push_back(REPLAY_VERSION);
+    for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<uint8_t>(log.seed >> (8 * i)));
+
+    int lastTick = 0;
+    putVarint(out, log.tunings.size());
+    for (const ReplayTuning &change : log.tunings)
+    {
+        putVarint(out, static_cast<uint64_t>(change.tick - lastTick));
+        putVarint(out, static_cast<uint64_t>(TUNING_VALUE_COUNT));
+        for (int i = 0; i < TUNING_VALUE_COUNT; ++i)
+        {
+            const int64_t value = rawTuningValue(change.tuning, i);
+            putVarint(out,
+                      (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+        }
+        lastTick = change.tick;
+    }
+
+    lastTick = 0;
+    for (const ReplayEvent &event : log.events)
+    {
+        putVarint(out, static_cast<uint64_t>(event.tick - lastTick));
+        putVarint(out, static_cast<uint64_t>(event.key) + 1);
+        lastTick = event.tick;
+    }
+    putVarint(out, 0);
+    putVarint(out, 0);
+    putVarint(out, static_cast<uint64_t>(log.endTick));
+    out.push_back(static_cast<uint8_t>(log.outcome));
+
+    std::FILE *file = std::fopen(path, "wb");
+    if (!file)
+        return false;
+    const bool ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+bool loadReplay(const char *path, ReplayLog &log)
+{
+    std::FILE *file = std::fopen(path, "rb");
+    if (!file)
+        return false;
+    std::vector<uint8_t> in;
+    uint8_t chunk[4096];
+    size_t got;
+    while ((got = std::fread(chunk, 1, sizeof chunk, file)) > 0)
+        in.insert(in.end(), chunk, chunk + got);
+    std::fclose(file);
+
+    if (in.size() < 13 || std::memcmp(in.data(), REPLAY_MAGIC, 4) != 0 ||
+        (in[4] != REPLAY_VERSION && in[4] != UNTUNED_REPLAY_VERSION))
+        return false;
+
+    log = ReplayLog{};
+    for (int i = 0; i < 8; ++i)
+        log.seed |= static_cast<uint64_t>(in[5 + i]) << (8 * i);
+
+    size_t pos = 13;
+    int tick = 0;
+    uint64_t tunings = 0;
+    if (in[4] == REPLAY_VERSION && !getVarint(in, pos, tunings))
+        return false;
+    for (uint64_t t = 0; t < tunings; ++t)
+    {
+        // Values a newer version added keep their defaults; unknown ones can't be played.
+        uint64_t delta, count;
+        if (!getVarint(in, pos, delta) || !getVarint(in, pos, count) ||
+            count > static_cast<uint64_t>(TUNING_VALUE_COUNT))
+            return false;
+        tick += static_cast<int>(delta);
+        ReplayTuning change{tick, Tuning{}};
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            uint64_t zigzag;
+            if (!getVarint(in, pos, zigzag))
+                return false;
+            const int64_t value =
+                static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+            if (!setRawTuningValue(change.tuning, static_cast<int>(i), value))
+                return false;
+        }
+        std::string error;
+        if (!validateTuning(change.tuning, error))
+            return false;
+        log.tunings.push_back(change);
+    }
+
+    tick = 0;
+    for (;;)
+    {
+        uint64_t delta, key;
+        if (!getVarint(in, pos, delta) || !getVarint(in, pos, key))
+            return false;
+        if (key == 0)
+            break;
+        tick += static_cast<int>(delta);
+        log.events.push_back({tick, static_cast<int>(key - 1)});
+    }
+
+    uint64_t endTick;
+    if (!getVarint(in, pos, endTick) || pos >= in.size())
+        return false;
+    log.endTick = static_cast<int>(endTick);
+    log.outcome = static_cast<Outcome>(in[pos]);
+    return true;
+}
+
+size_t applyReplayTunings(const ReplayLog &log, size_t next, const Night &night)
+{
+    while (next < log.tunings.size() && log.tunings[next].tick <= night.tick)
+        setActiveTuning(log.tunings[next++].tuning);
+    return next;
+}
+
+size_t applyReplayKeys(const ReplayLog &log, size_t next, Night &night)
+{
+    while (next < log.events.size() && log.events[next].tick <= night.tick)
+        handleInput(night.game, log.events[next++].key);
+    return next;
+}
+
+Outcome replayNightHeadless(const ReplayLog &log, Night &night)
+{
+    night = startNight(log.seed);
+    size_t next = 0;
+    size_t nextTuning = 0;
+
+    // Same order as the game loop: the tuning and keys for a tick first, then the tick itself.
+    for (;;)
+    {
+        nextTuning = applyReplayTunings(log, nextTuning, night);
+        next = applyReplayKeys(log, next, night);
+        if (!night.game.running)
+            return Outcome::Running;
+
+        stepNight(night);
+        const Outcome outcome = nightOutcome(night.game);
+        if (outcome != Outcome::Running || night.tick >= MAX_NIGHT_TICKS)
+            return outcome;
+
+        int until = nextNightEvent(night);
+        if (next < log.events.size())
+            until = std::min(until, log.events[next].tick);
+        if (nextTuning < log.tunings.size())
+            until = std::min(until, log.tunings[nextTuning].tick);
+        skipIdleTicks(night, until - night.tick);
+    }
+}
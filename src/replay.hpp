@@ -0,0 +1,54 @@
+#pragma once
+
+#include "game_state.hpp"
+#include "simulation.hpp"
+#include "tuning.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// One key press, applied through handleInput just before tick `tick` runs.
+struct ReplayEvent
+{
+    int tick;
+    int key;
+};
+
+// The tuning the night ran with from just before tick `tick`: the starting one at tick 0, then
+// one per --tuning reload.
+struct ReplayTuning
+{
+    int tick;
+    Tuning tuning;
+};
+
+// A recorded night: the seed, the tuning and every key press on the integer tick clock, which
+// is all it takes to re-run the night bit for bit. The outcome is stored too so a replay can
+// tell whether today's code still plays the night out the same way.
+struct ReplayLog
+{
+    uint64_t seed = 0;
+    std::vector<ReplayTuning> tunings; // empty in version 1 logs, which use the active tuning
+    std::vector<ReplayEvent> events;
+    int endTick = 0;
+    Outcome outcome = Outcome::Running;
+};
+
+// Compact binary format: "S2SR", version byte, seed, the varint tuning count and for each
+// tuning its varint tick delta, value count and zigzag values (see rawTuningValue), then
+// varint (tick delta, key + 1) pairs, a 0 terminator, the varint end tick and the outcome byte.
+// Version 1 logs, which have no tunings, still load.
+bool saveReplay(const char *path, const ReplayLog &log);
+bool loadReplay(const char *path, ReplayLog &log);
+
+// Makes the logged tuning due on night.tick active, starting at tunings[next]. Returns the new
+// `next`. The log must outlive the nights using it.
+size_t applyReplayTunings(const ReplayLog &log, size_t next, const Night &night);
+
+// Applies every logged key due on night.tick, starting at events[next]. Returns the new `next`.
+size_t applyReplayKeys(const ReplayLog &log, size_t next, Night &night);
+
+// Re-runs a log without a terminal as fast as possible, skipping idle ticks between keys and
+// tuning changes.
+Outcome replayNightHeadless(const ReplayLog &log, Night &night);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+// xoshiro128** generator. Unlike std::rand(), every Rng is its own stream, so
+// simulations on different threads never share state and can be replayed from a seed.
+struct Rng
+{
+    uint32_t s[4] = {1, 2, 3, 4};
+
+    // Derives the stream for one seed/index pair (e.g. one simulated night) with splitmix64.
+    void seed(uint64_t value, uint64_t stream = 0)
+    {
+        uint64_t x = value + stream * 0xD1B54A32D192ED03ull;
+        for (int i = 0; i < 4; i += 2)
+        {
+            uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            s[i] = static_cast<uint32_t>(z);
+            s[i + 1] = static_cast<uint32_t>(z >> 32);
+        }
+    }
+
+    uint32_t next() { return step(s[0], s[1], s[2], s[3]); }
+
+    // Uniform in [0, 1).
+    float nextFloat() { return toFloat(next()); }
+
+    // One xoshiro128** step on loose state words, so batched code can keep each word in
+    // its own array and still produce exactly the stream a scalar Rng would.
+    static uint32_t step(uint32_t &s0, uint32_t &s1, uint32_t &s2, uint32_t &s3)
+    {
+        const uint32_t result = rotl(s1 * 5u, 7) * 9u;
+        const uint32_t t = s1 << 9;
+        s2 ^= s0;
+        s3 ^= s1;
+        s1 ^= s2;
+        s0 ^= s3;
+        s2 ^= t;
+        s3 = rotl(s3, 11);
+        return result;
+    }
+
+    static float toFloat(uint32_t bits) { return (bits >> 8) * (1.0f / 16777216.0f); }
+
+  private:
+    static uint32_t rotl(uint32_t x, int k) { return (x << k) | (x >> (32 - k)); }
+};
@@ -0,0 +1,275 @@
+#include "room_graph.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <sstream>
+#include <utility>
+
+// Same map as maps/default.map.
+static const char *const DEFAULT_MAP = R"(
+room 1 0 11
+room 2 2 1
+room 3 2 17
+room 4 5 1
+room 5 5 23
+room 6 8 4
+room 7 8 17
+room 8 - -
+edge 1 2
+edge 2 3
+edge 3 4
+edge 4 5
+edge 5 6
+edge 6 7
+edge 7 8
+animatronic freddo 1 6 7
+animatronic chico 1 7 8
+art           [1]
+art            |
+art [2]-------------[3]
+art  |               |
+art  |               |
+art [4]--------------+----[5]
+art  |               |
+art  |               |
+art  --[6]---|YOU|--[7]
+)";
+
+static const char *const ROUTE_NAMES[ROUTE_COUNT] = {"freddo", "chico"};
+
+// Breadth-first distances to the office, then one lookup table per kind of move.
+static void buildRoute(const RoomGraph &graph, AnimatronicRoute &route)
+{
+    const int size = graph.roomCount + 1;
+    route.distance.assign(size, -1);
+    route.advance.resize(size);
+    route.retreat.resize(size);
+
+    std::deque<int> queue{route.officeRoom};
+    route.distance[route.officeRoom] = 0;
+    while (!queue.empty())
+    {
+        const int room = queue.front();
+        queue.pop_front();
+        for (int e = graph.edgeStart[room]; e < graph.edgeStart[room + 1]; ++e)
+        {
+            const int next = graph.edges[e];
+            if (route.distance[next] < 0)
+            {
+                route.distance[next] = route.distance[room] + 1;
+                queue.push_back(next);
+            }
+        }
+    }
+
+    // Neighbours are sorted, so ties go to the lowest room id.
+    for (int room = 0; room < size; ++room)
+    {
+        route.advance[room] = room;
+        route.retreat[room] = room;
+        if (room == 0 || route.distance[room] < 0)
+            continue;
+
+        int farthest = route.distance[room];
+        for (int e = graph.edgeStart[room]; e < graph.edgeStart[room + 1]; ++e)
+        {
+            const int next = graph.edges[e];
+            if (route.advance[room] == room && route.distance[next] == route.distance[room] - 1)
+                route.advance[room] = next;
+            if (route.distance[next] > farthest)
+            {
+                farthest = route.distance[next];
+                route.retreat[room] = next;
+            }
+        }
+    }
+}
+
+static bool validRoom(const RoomGraph &graph, int room)
+{
+    return room >= 1 && room <= graph.roomCount;
+}
+
+bool parseRoomGraph(const std::string &text, RoomGraph &graph, std::string &error)
+{
+    graph = RoomGraph{};
+    std::vector<std::pair<int, int>> corridors;
+    std::vector<std::pair<int, RoomLabel>> rooms;
+    bool routeSeen[ROUTE_COUNT] = {};
+
+    std::istringstream lines(text);
+    std::string line;
+    for (int number = 1; std::getline(lines, line); ++number)
+    {
+        auto fail = [&](const char *why) {
+            error = "line " + std::to_string(number) + ": " + why;
+            return false;
+        };
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.compare(0, 4, "art ") == 0 || line == "art")
+        {
+            graph.art.push_back(line.size() > 4 ? line.substr(4) : "");
+            continue;
+        }
+
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword) || keyword[0] == '#')
+            continue;
+
+        if (keyword == "room")
+        {
+            int id;
+            std::string row, col;
+            if (!(words >> id >> row >> col) || id < 1)
+                return fail("expected: room <id> <row> <col>");
+            if (id > MAX_ROOMS)
+                return fail(("room id is over " + std::to_string(MAX_ROOMS)).c_str());
+            RoomLabel label;
+            if (row != "-")
+            {
+                label.row = std::atoi(row.c_str());
+                label.col = std::atoi(col.c_str());
+            }
+            rooms.push_back({id, label});
+            graph.roomCount = std::max(graph.roomCount, id);
+        }
+        else if (keyword == "edge")
+        {
+            int a, b;
+            if (!(words >> a >> b) || a < 1 || b < 1 || a == b)
+                return fail("expected: edge <room> <other room>");
+            corridors.push_back({a, b});
+        }
+        else if (keyword == "animatronic")
+        {
+            std::string name;
+            AnimatronicRoute route;
+            if (!(words >> name >> route.spawn >> route.doorRoom >> route.officeRoom))
+                return fail("expected: animatronic <name> <spawn> <door room> <office room>");
+            const auto found = std::find_if(std::begin(ROUTE_NAMES), std::end(ROUTE_NAMES),
+                                            [&](const char *n) { return name == n; });
+            if (found == std::end(ROUTE_NAMES))
+                return fail("unknown animatronic (expected freddo or chico)");
+            const int index = static_cast<int>(found - std::begin(ROUTE_NAMES));
+            graph.routes[index] = route;
+            routeSeen[index] = true;
+        }
+        else
+            return fail("unknown keyword");
+    }
+
+    for (const auto &corridor : corridors)
+        if (!validRoom(graph, corridor.first) || !validRoom(graph, corridor.second))
+        {
+            error = "edge to a room that was never declared";
+            return false;
+        }
+    for (int i = 0; i < ROUTE_COUNT; ++i)
+    {
+        const AnimatronicRoute &route = graph.routes[i];
+        if (!routeSeen[i])
+        {
+            error = std::string("no route for ") + ROUTE_NAMES[i];
+            return false;
+        }
+        if (!validRoom(graph, route.spawn) || !validRoom(graph, route.doorRoom) ||
+            !validRoom(graph, route.officeRoom))
+        {
+            error = std::string(ROUTE_NAMES[i]) + "'s rooms must be declared";
+            return false;
+        }
+    }
+
+    graph.labels.assign(graph.roomCount + 1, RoomLabel{});
+    for (const auto &room : rooms)
+        graph.labels[room.first] = room.second;
+
+    // Counting sort of both directions of every corridor into the CSR arrays.
+    graph.edgeStart.assign(graph.roomCount + 2, 0);
+    for (const auto &corridor : corridors)
+    {
+        graph.edgeStart[corridor.first + 1]++;
+        graph.edgeStart[corridor.second + 1]++;
+    }
+    for (int room = 1; room <= graph.roomCount + 1; ++room)
+        graph.edgeStart[room] += graph.edgeStart[room - 1];
+    graph.edges.resize(graph.edgeStart.back());
+    std::vector<int32_t> fill(graph.edgeStart.begin(), graph.edgeStart.end() - 1);
+    for (const auto &corridor : corridors)
+    {
+        graph.edges[fill[corridor.first]++] = corridor.second;
+        graph.edges[fill[corridor.second]++] = corridor.first;
+    }
+    for (int room = 1; room <= graph.roomCount; ++room)
+        std::sort(graph.edges.begin() + graph.edgeStart[room],
+                  graph.edges.begin() + graph.edgeStart[room + 1]);
+
+    for (int i = 0; i < ROUTE_COUNT; ++i)
+    {
+        AnimatronicRoute &route = graph.routes[i];
+        buildRoute(graph, route);
+        if (route.distance[route.spawn] < 0 || route.distance[route.doorRoom] != 1)
+        {
+            error = std::string(ROUTE_NAMES[i]) +
+                    "'s door room must be next to its office and reachable from its spawn";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool loadRoomGraph(const char *path, RoomGraph &graph, std::string &error)
+{
+    std::FILE *file = std::fopen(path, "rb");
+    if (!file)
+    {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, file)) > 0)
+        text.append(buf, n);
+    std::fclose(file);
+    return parseRoomGraph(text, graph, error);
+}
+
+const RoomGraph &defaultRoomGraph()
+{
+    static const RoomGraph graph = [] {
+        RoomGraph g;
+        std::string error;
+        parseRoomGraph(DEFAULT_MAP, g, error);
+        return g;
+    }();
+    return graph;
+}
+
+const RoomGraph *activeGraph = &defaultRoomGraph();
+
+void setActiveRoomGraph(const RoomGraph &graph)
+{
+    static RoomGraph custom;
+    custom = graph;
+    activeGraph = &custom;
+}
+
+bool hasDefaultRoutes(const RoomGraph &graph)
+{
+    const RoomGraph &builtin = defaultRoomGraph();
+    for (int i = 0; i < ROUTE_COUNT; ++i)
+    {
+        const AnimatronicRoute &a = graph.routes[i];
+        const AnimatronicRoute &b = builtin.routes[i];
+        if (graph.roomCount != builtin.roomCount || a.spawn != b.spawn ||
+            a.doorRoom != b.doorRoom || a.officeRoom != b.officeRoom ||
+            a.advance != b.advance || a.retreat != b.retreat)
+            return false;
+    }
+    return true;
+}
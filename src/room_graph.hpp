@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Which route in a RoomGraph belongs to which animatronic. Map files name them.
+constexpr int FREDDO_ROUTE = 0;
+constexpr int CHICO_ROUTE = 1;
+constexpr int ROUTE_COUNT = 2;
+
+// One animatronic's way through the map, with every move precomputed so a decision is a single
+// table lookup however big the map is. Tables are indexed by room id.
+struct AnimatronicRoute
+{
+    int spawn = 0;
+    int doorRoom = 0;   // room right outside its office door
+    int officeRoom = 0; // reaching it with the door open ends the night
+    std::vector<int32_t> advance;  // next room on a shortest path to officeRoom
+    std::vector<int32_t> retreat;  // neighbouring room farthest from officeRoom (or stay)
+    std::vector<int32_t> distance; // corridors to officeRoom; -1 if unreachable
+};
+
+struct RoomLabel
+{
+    int row = -1; // where the room's number is drawn, relative to the map art; -1 if hidden
+    int col = -1;
+};
+
+// Highest room id a map may use. Every per-room table is sized by the highest id, so a typo'd
+// id must not size them.
+constexpr int MAX_ROOMS = 65536;
+
+// Rooms 1..roomCount joined by two-way corridors, stored as adjacency arrays (CSR): the
+// neighbours of room r are edges[edgeStart[r]] .. edges[edgeStart[r + 1] - 1].
+struct RoomGraph
+{
+    int roomCount = 0;
+    std::vector<int32_t> edgeStart;
+    std::vector<int32_t> edges;
+    std::vector<RoomLabel> labels;
+    std::vector<std::string> art; // the map drawing, one string per screen row
+    AnimatronicRoute routes[ROUTE_COUNT];
+
+    bool drawn(int room) const
+    {
+        return room > 0 && room <= roomCount && labels[room].row >= 0;
+    }
+};
+
+// Reads the map file format (see maps/default.map). On failure returns false and says why.
+bool parseRoomGraph(const std::string &text, RoomGraph &graph, std::string &error);
+bool loadRoomGraph(const char *path, RoomGraph &graph, std::string &error);
+
+// The original seven-room map, built in so the game needs no files.
+const RoomGraph &defaultRoomGraph();
+
+// The map every night runs on. Set it before starting a night.
+extern const RoomGraph *activeGraph;
+inline const RoomGraph &activeRoomGraph() { return *activeGraph; }
+void setActiveRoomGraph(const RoomGraph &graph);
+
+// True when the routes move exactly like the built-in map's (the batched engine hard-codes them).
+bool hasDefaultRoutes(const RoomGraph &graph);
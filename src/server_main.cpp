@@ -0,0 +1,728 @@
+// Multiplayer night server: hosts many independent nights in one process, one per connection,
+// over a Unix-domain socket or loopback TCP. A few event-loop threads (epoll plus a timerfd)
+// share the sessions; each session keeps its own Night and screen and sends only the cells
+// that changed, and a slow client only delays its own frames. --load-test drives it with
+// simulated players to measure how many sessions one core can carry.
+
+#include "game_session.hpp"
+#include "option_parse.hpp"
+#include "room_graph.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct ServerOptions
+{
+    const char *unixPath = nullptr;
+    int port = -1;
+    unsigned threads = 0;
+    double speed = 1.0;
+    bool telnet = false;
+    uint64_t seed = 0;
+    const char *mapPath = nullptr;
+    unsigned loadClients = 0; // --load-test
+    double duration = 10.0;
+};
+
+constexpr double MAX_DURATION = 24 * 60 * 60.0; // --duration: a day of load test
+
+// Puts telnet clients in character mode with the server doing the echoing (which it never
+// does), so keys arrive as they're pressed: IAC WILL ECHO, IAC WILL SUPPRESS-GO-AHEAD.
+constexpr char TELNET_HELLO[] = "\xff\xfb\x01\xff\xfb\x03";
+constexpr char SCREEN_HELLO[] = "\x1b[?25l";          // hide the cursor
+constexpr char SCREEN_BYE[] = "\x1b[0m\x1b[?25h\r\n"; // reset colours, show the cursor
+// How long a finished session waits for a client that stopped reading to take its last frame.
+constexpr auto FINISH_TIMEOUT = std::chrono::seconds(5);
+
+struct Connection
+{
+    int fd = -1;
+    GameSession game;
+    std::string pending; // frame bytes not yet accepted by the socket
+    size_t sent = 0;
+    bool writeArmed = false; // waiting for EPOLLOUT
+    bool dead = false;
+    Clock::time_point wake;
+    Clock::time_point dropAt = Clock::time_point::max(); // set once the session is finished
+};
+
+// When the loop next has to look at the connection. A finished session only waits for its
+// pending bytes to drain (EPOLLOUT), up to FINISH_TIMEOUT, after which it is dropped.
+static Clock::time_point connectionWake(Connection &conn, Clock::time_point now)
+{
+    if (!conn.game.finished)
+        return sessionWake(conn.game);
+    if (conn.dropAt == Clock::time_point::max())
+        conn.dropAt = now + FINISH_TIMEOUT;
+    return conn.dropAt;
+}
+
+// One event-loop thread and the sessions it owns. Other threads only hand it new sockets.
+struct alignas(64) LoopThread
+{
+    int epollFd = -1;
+    int wakeFd = -1;
+    int timerFd = -1;
+    std::mutex lock;
+    std::vector<int> incoming;
+    std::thread thread;
+
+    // Published for the report.
+    std::atomic<size_t> live{0};
+    std::atomic<size_t> memory{0};
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<int64_t> cpuNanos{0};
+};
+
+struct Server
+{
+    ServerOptions options;
+    std::vector<std::unique_ptr<LoopThread>> loops;
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> served{0};
+    std::atomic<unsigned> nextLoop{0};
+};
+
+static bool parseOptions(int argc, char **argv, ServerOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--unix") == 0 && hasValue)
+            options.unixPath = argv[++i];
+        else if (std::strcmp(arg, "--port") == 0 && hasValue)
+        {
+            unsigned port;
+            if (!parseCount(argv[++i], 0u, 65535u, port))
+                return false;
+            options.port = static_cast<int>(port);
+        }
+        else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+        {
+            if (!parseCount(argv[++i], 0u, MAX_THREADS, options.threads))
+                return false;
+        }
+        else if (std::strcmp(arg, "--speed") == 0 && hasValue)
+        {
+            if (!parseReal(argv[++i], 0.0, MAX_SPEED, options.speed))
+                return false;
+        }
+        else if (std::strcmp(arg, "--telnet") == 0)
+            options.telnet = true;
+        else if (std::strcmp(arg, "--seed") == 0 && hasValue)
+        {
+            if (!parseCount(argv[++i], options.seed))
+                return false;
+        }
+        else if (std::strcmp(arg, "--map") == 0 && hasValue)
+            options.mapPath = argv[++i];
+        else if (std::strcmp(arg, "--load-test") == 0 && hasValue)
+        {
+            if (!parseCount(argv[++i], options.loadClients))
+                return false;
+        }
+        else if (std::strcmp(arg, "--duration") == 0 && hasValue)
+        {
+            if (!parseReal(argv[++i], 0.0, MAX_DURATION, options.duration))
+                return false;
+        }
+        else
+            return false;
+    }
+    if (options.speed <= 0.0 || options.duration <= 0.0)
+        return false;
+    if (options.loadClients > 0)
+        return !options.unixPath && options.port < 0;
+    if (options.unixPath && options.port >= 0)
+        return false;
+    return options.unixPath || (options.port > 0 && options.port < 65536);
+}
+
+static void setTimer(int timerFd, Clock::time_point when)
+{
+    itimerspec spec{};
+    const auto nanos =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(when.time_since_epoch()).count();
+    // An all-zero it_value disarms the timer, so a deadline already passed becomes 1 ns.
+    spec.it_value.tv_sec = nanos > 0 ? nanos / 1000000000 : 0;
+    spec.it_value.tv_nsec = nanos > 0 ? nanos % 1000000000 : 1;
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
+
+static void watch(LoopThread &loop, Connection &conn, bool writable)
+{
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0u);
+    event.data.ptr = &conn;
+    epoll_ctl(loop.epollFd, EPOLL_CTL_MOD, conn.fd, &event);
+    conn.writeArmed = writable;
+}
+
+// Sends as much of the pending frame as the socket takes and waits for EPOLLOUT for the rest.
+static void flush(LoopThread &loop, Connection &conn)
+{
+    while (conn.sent < conn.pending.size())
+    {
+        const ssize_t n = send(conn.fd, conn.pending.data() + conn.sent,
+                               conn.pending.size() - conn.sent, MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            conn.sent += static_cast<size_t>(n);
+            loop.bytesSent.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            if (!conn.writeArmed)
+                watch(loop, conn, true);
+            return;
+        }
+        else if (n < 0 && errno == EINTR)
+            continue;
+        else
+        {
+            conn.dead = true;
+            return;
+        }
+    }
+    conn.pending.clear();
+    conn.sent = 0;
+    if (conn.writeArmed)
+        watch(loop, conn, false);
+}
+
+// Draws the session if it changed. While an earlier frame is still going out the new one
+// waits; the framebuffer diff then covers everything that changed in between.
+static void present(LoopThread &loop, Connection &conn)
+{
+    if (conn.sent < conn.pending.size() || conn.dead)
+        return;
+    if (conn.game.finished)
+    {
+        conn.pending += SCREEN_BYE;
+        flush(loop, conn);
+        conn.dead = true;
+        return;
+    }
+    if (!renderSession(conn.game))
+        return;
+    conn.pending.swap(conn.game.screen.out);
+    conn.sent = 0;
+    flush(loop, conn);
+}
+
+static void openSession(Server &server, LoopThread &loop,
+                        std::vector<std::unique_ptr<Connection>> &conns, int fd,
+                        Clock::time_point now, Clock::time_point &armed)
+{
+    auto conn = std::make_unique<Connection>();
+    conn->fd = fd;
+    const uint64_t stream = server.served.fetch_add(1);
+    startSession(conn->game, server.options.seed, stream, server.options.speed, now);
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.ptr = conn.get();
+    if (epoll_ctl(loop.epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        close(fd);
+        return;
+    }
+
+    if (server.options.telnet)
+        conn->pending.append(TELNET_HELLO, sizeof TELNET_HELLO - 1);
+    conn->pending += SCREEN_HELLO;
+    flush(loop, *conn);
+    present(loop, *conn);
+    conn->wake = connectionWake(*conn, now);
+    armed = std::min(armed, conn->wake);
+    conns.push_back(std::move(conn));
+}
+
+static void readKeys(LoopThread &loop, Connection &conn, Clock::time_point now,
+                     Clock::time_point &armed)
+{
+    char bytes[256];
+    for (;;)
+    {
+        const ssize_t n = recv(conn.fd, bytes, sizeof bytes, 0);
+        if (n > 0)
+        {
+            sessionInput(conn.game, bytes, static_cast<size_t>(n), now);
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            conn.dead = true;
+        if (n < 0 && errno == EINTR)
+            continue;
+        break;
+    }
+    present(loop, conn);
+    // A door toggle changes when the battery next drops, so the wake time may come sooner.
+    conn.wake = connectionWake(conn, now);
+    armed = std::min(armed, conn.wake);
+}
+
+static size_t sessionMemory(const Connection &conn)
+{
+    return sizeof conn + conn.pending.capacity() + conn.game.screen.out.capacity();
+}
+
+static void runLoop(Server &server, LoopThread &loop)
+{
+    std::vector<std::unique_ptr<Connection>> conns;
+    Clock::time_point armed = Clock::time_point::max();
+    auto lastPublish = Clock::now();
+    epoll_event events[64];
+
+    while (!server.stopping.load())
+    {
+        setTimer(loop.timerFd, armed);
+        const int ready = epoll_wait(loop.epollFd, events, 64, -1);
+        const auto now = Clock::now();
+        bool timerFired = false;
+
+        for (int i = 0; i < ready; ++i)
+        {
+            void *tag = events[i].data.ptr;
+            if (tag == &loop.wakeFd)
+            {
+                uint64_t count;
+                if (read(loop.wakeFd, &count, sizeof count) < 0)
+                    continue;
+                std::vector<int> fds;
+                {
+                    std::lock_guard<std::mutex> guard(loop.lock);
+                    fds.swap(loop.incoming);
+                }
+                for (int fd : fds)
+                    openSession(server, loop, conns, fd, now, armed);
+            }
+            else if (tag == &loop.timerFd)
+            {
+                uint64_t expirations;
+                if (read(loop.timerFd, &expirations, sizeof expirations) >= 0)
+                    timerFired = true;
+            }
+            else
+            {
+                Connection &conn = *static_cast<Connection *>(tag);
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    conn.dead = true;
+                if (!conn.dead && (events[i].events & EPOLLOUT))
+                {
+                    flush(loop, conn);
+                    present(loop, conn);
+                }
+                if (!conn.dead && (events[i].events & (EPOLLIN | EPOLLRDHUP)))
+                    readKeys(loop, conn, now, armed);
+            }
+        }
+
+        // Sessions whose wake time has come; the rest keep their cached wake time.
+        if (timerFired)
+        {
+            armed = Clock::time_point::max();
+            for (auto &conn : conns)
+            {
+                if (!conn->dead && conn->wake <= now && conn->game.finished)
+                    conn->dead = true; // its last frame never drained
+                else if (!conn->dead && conn->wake <= now)
+                {
+                    updateSession(conn->game, now);
+                    present(loop, *conn);
+                    conn->wake = connectionWake(*conn, now);
+                }
+                if (!conn->dead)
+                    armed = std::min(armed, conn->wake);
+            }
+        }
+
+        // Closing happens here, after the batch, since an event later in it may name the same
+        // connection.
+        for (size_t i = 0; i < conns.size();)
+        {
+            if (!conns[i]->dead)
+            {
+                ++i;
+                continue;
+            }
+            close(conns[i]->fd);
+            conns[i] = std::move(conns.back());
+            conns.pop_back();
+        }
+
+        timespec cpu;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+        loop.cpuNanos.store(static_cast<int64_t>(cpu.tv_sec) * 1000000000 + cpu.tv_nsec);
+        loop.live.store(conns.size());
+        if (now - lastPublish >= std::chrono::seconds(1) || conns.empty())
+        {
+            size_t memory = 0;
+            for (const auto &conn : conns)
+                memory += sessionMemory(*conn);
+            loop.memory.store(memory);
+            lastPublish = now;
+        }
+    }
+
+    for (auto &conn : conns)
+    {
+        send(conn->fd, SCREEN_BYE, sizeof SCREEN_BYE - 1, MSG_NOSIGNAL);
+        close(conn->fd);
+    }
+    loop.live.store(0);
+}
+
+static bool addWatch(int epollFd, int fd, void *tag)
+{
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = tag;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+static bool startLoops(Server &server)
+{
+    for (unsigned i = 0; i < server.options.threads; ++i)
+    {
+        auto loop = std::make_unique<LoopThread>();
+        loop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        loop->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (loop->epollFd < 0 || loop->wakeFd < 0 || loop->timerFd < 0 ||
+            !addWatch(loop->epollFd, loop->wakeFd, &loop->wakeFd) ||
+            !addWatch(loop->epollFd, loop->timerFd, &loop->timerFd))
+            return false;
+        server.loops.push_back(std::move(loop));
+    }
+    for (auto &loop : server.loops)
+        loop->thread = std::thread(runLoop, std::ref(server), std::ref(*loop));
+    return true;
+}
+
+static void wake(LoopThread &loop)
+{
+    const uint64_t one = 1;
+    if (write(loop.wakeFd, &one, sizeof one) < 0)
+        std::perror("eventfd");
+}
+
+static void stopLoops(Server &server)
+{
+    server.stopping.store(true);
+    for (auto &loop : server.loops)
+        wake(*loop);
+    for (auto &loop : server.loops)
+    {
+        loop->thread.join();
+        close(loop->epollFd);
+        close(loop->wakeFd);
+        close(loop->timerFd);
+    }
+}
+
+// Hands a connected socket to the loops in turn. Safe to call from any thread.
+static void dispatch(Server &server, int fd)
+{
+    LoopThread &loop = *server.loops[server.nextLoop.fetch_add(1) % server.loops.size()];
+    {
+        std::lock_guard<std::mutex> guard(loop.lock);
+        loop.incoming.push_back(fd);
+    }
+    wake(loop);
+}
+
+static int listenOn(const ServerOptions &options)
+{
+    int fd;
+    if (options.unixPath)
+    {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (std::strlen(options.unixPath) >= sizeof address.sun_path)
+            return -1;
+        std::strcpy(address.sun_path, options.unixPath);
+        unlink(options.unixPath);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0 || bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0)
+            return -1;
+    }
+    else
+    {
+        // Loopback only: there is no authentication or encryption.
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(options.port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int on = 1;
+        if (fd < 0 || setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on) != 0 ||
+            bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0)
+            return -1;
+    }
+    return listen(fd, SOMAXCONN) == 0 ? fd : -1;
+}
+
+// Sessions alive over time, sampled by the main thread.
+struct Occupancy
+{
+    size_t peak = 0;
+    double sessionSeconds = 0.0;
+    Clock::time_point last = Clock::now();
+
+    void sample(const Server &server)
+    {
+        const auto now = Clock::now();
+        size_t live = 0;
+        for (const auto &loop : server.loops)
+            live += loop->live.load();
+        peak = std::max(peak, live);
+        sessionSeconds += live * std::chrono::duration<double>(now - last).count();
+        last = now;
+    }
+};
+
+static void printReport(const Server &server, const Occupancy &occupancy, double wall)
+{
+    double cpu = 0.0;
+    size_t memory = 0;
+    size_t live = 0;
+    uint64_t bytes = 0;
+    for (const auto &loop : server.loops)
+    {
+        cpu += loop->cpuNanos.load() / 1e9;
+        memory += loop->memory.load();
+        live += loop->live.load();
+        bytes += loop->bytesSent.load();
+    }
+
+    std::printf("Sessions:      %llu served, %zu at most at once, %u loop threads\n",
+                static_cast<unsigned long long>(server.served.load()), occupancy.peak,
+                server.options.threads);
+    if (live > 0)
+        std::printf("Per session:   %zu bytes (%zu of session state, the rest buffers)\n",
+                    memory / live, sizeof(Connection));
+    else
+        std::printf("Per session:   %zu bytes of session state plus buffers\n",
+                    sizeof(Connection));
+    if (wall <= 0.0 || occupancy.sessionSeconds <= 0.0)
+        return;
+    const double average = occupancy.sessionSeconds / wall;
+    std::printf("Loop CPU:      %.2f s over %.1f s, %.1f sessions live on average\n", cpu, wall,
+                average);
+    std::printf("Traffic:       %.0f bytes per session-second\n",
+                bytes / occupancy.sessionSeconds);
+    if (cpu > 0.0)
+        std::printf("Capacity:      about %.0f sessions per core at this game speed\n",
+                    occupancy.sessionSeconds / cpu);
+}
+
+// Simulated players: read and throw away every frame, and press A or D about once every three
+// seconds. A player whose night ends reconnects straight away, so the load stays constant.
+static void runLoadClients(Server &server, std::atomic<bool> &stop)
+{
+    const unsigned count = server.options.loadClients;
+    const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    std::vector<int> clients;
+    auto connect = [&]() {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair) != 0)
+            return false;
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = pair[0];
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, pair[0], &event);
+        clients.push_back(pair[0]);
+        dispatch(server, pair[1]);
+        return true;
+    };
+    for (unsigned i = 0; i < count; ++i)
+        if (!connect())
+        {
+            std::perror("socketpair");
+            break;
+        }
+
+    std::mt19937 rng(12345);
+    std::vector<epoll_event> events(256);
+    std::vector<char> sink(16384);
+    auto nextPresses = Clock::now();
+    while (!stop.load())
+    {
+        const int ready = epoll_wait(epollFd, events.data(), static_cast<int>(events.size()), 50);
+        for (int i = 0; i < ready; ++i)
+        {
+            const int fd = events[i].data.fd;
+            ssize_t n;
+            while ((n = recv(fd, sink.data(), sink.size(), 0)) > 0)
+            {
+            }
+            if (n == 0)
+            {
+                close(fd);
+                clients.erase(std::find(clients.begin(), clients.end(), fd));
+                connect();
+            }
+        }
+        if (Clock::now() >= nextPresses)
+        {
+            nextPresses += std::chrono::milliseconds(100);
+            for (int fd : clients)
+                if (rng() % 30 == 0)
+                    send(fd, rng() % 2 ? "a" : "d", 1, MSG_NOSIGNAL);
+        }
+    }
+    for (int fd : clients)
+        close(fd);
+    close(epollFd);
+}
+
+int main(int argc, char **argv)
+{
+    Server server;
+    ServerOptions &options = server.options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s (--unix PATH | --port N) [--threads N] [--speed X] [--telnet]\n"
+                     "          [--seed N] [--map FILE]\n"
+                     "       %s --load-test CLIENTS [--duration SECONDS] [--threads N]\n"
+                     "          [--speed X] [--map FILE]\n",
+                     argv[0], argv[0]);
+        return 2;
+    }
+    if (options.threads == 0)
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (options.seed == 0)
+        options.seed = static_cast<uint64_t>(std::time(nullptr));
+
+    if (options.mapPath)
+    {
+        RoomGraph graph;
+        std::string error;
+        if (!loadRoomGraph(options.mapPath, graph, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.mapPath, error.c_str());
+            return 2;
+        }
+        setActiveRoomGraph(graph);
+    }
+
+    // SIGINT and SIGTERM arrive on a signalfd so the report still gets printed.
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    const int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    const int listenFd = options.loadClients > 0 ? -1 : listenOn(options);
+    if (options.loadClients == 0 && listenFd < 0)
+    {
+        std::perror(options.unixPath ? options.unixPath : "listen");
+        return 1;
+    }
+    if (!startLoops(server))
+    {
+        std::perror("epoll");
+        return 1;
+    }
+
+    const int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    addWatch(epollFd, signalFd, nullptr);
+    if (listenFd >= 0)
+    {
+        addWatch(epollFd, listenFd, &server);
+        if (options.unixPath)
+            std::printf("Listening on %s with %u loop threads\n", options.unixPath,
+                        options.threads);
+        else
+            std::printf("Listening on 127.0.0.1:%d with %u loop threads\n", options.port,
+                        options.threads);
+        std::fflush(stdout);
+    }
+
+    std::atomic<bool> stopClients{false};
+    std::thread clients;
+    if (options.loadClients > 0)
+        clients = std::thread(runLoadClients, std::ref(server), std::ref(stopClients));
+
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(options.duration));
+    Occupancy occupancy;
+    bool running = true;
+    while (running)
+    {
+        epoll_event events[4];
+        const int ready = epoll_wait(epollFd, events, 4, 100);
+        for (int i = 0; i < ready; ++i)
+        {
+            if (events[i].data.ptr == nullptr)
+                running = false;
+            else
+                for (;;)
+                {
+                    const int fd = accept4(listenFd, nullptr, nullptr,
+                                           SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (fd < 0)
+                        break;
+                    if (options.port >= 0)
+                    {
+                        const int on = 1;
+                        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+                    }
+                    dispatch(server, fd);
+                }
+        }
+        occupancy.sample(server);
+        if (options.loadClients > 0 && Clock::now() >= end)
+            running = false;
+    }
+
+    // Report before the sessions close, while the memory figures are still live.
+    const double wall = std::chrono::duration<double>(Clock::now() - start).count();
+    occupancy.sample(server);
+    printReport(server, occupancy, wall);
+    stopClients.store(true);
+    if (clients.joinable())
+        clients.join();
+    stopLoops(server);
+
+    close(epollFd);
+    close(signalFd);
+    if (listenFd >= 0)
+        close(listenFd);
+    if (options.unixPath)
+        unlink(options.unixPath);
+    return 0;
+}
@@ -0,0 +1,558 @@
+// Headless Monte Carlo night simulator: plays many nights per second across all cores
+// using the same Night rules as the game, with a scripted or random door policy. --solve
+// computes the same odds exactly instead of sampling them, and --fork plays on from a saved
+// night with each possible door choice.
+
+#include "batch_sim.hpp"
+#include "door_policy.hpp"
+#include "event_sim.hpp"
+#include "game_state.hpp"
+#include "option_parse.hpp"
+#include "room_graph.hpp"
+#include "simulation.hpp"
+#include "snapshot.hpp"
+#include "survival_solver.hpp"
+#include "telemetry.hpp"
+#include "tuning.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class Engine
+{
+    Fixed,  // one stepNight per tick
+    Event,  // jump between scheduled events
+    Batch,  // structure-of-arrays kernel, many nights per pass
+    Verify, // run all three and compare the results
+};
+
+struct SimOptions
+{
+    uint64_t nights = 100000;
+    unsigned threads = 0;
+    uint64_t seed = 1;
+    DoorPolicy policy;
+    Engine engine = Engine::Event;
+    bool bench = false;
+    bool solve = false;
+    bool optimal = false; // --policy optimal, for --solve
+    const char *policyPath = nullptr;
+    const char *forkPath = nullptr;
+    const char *mapPath = nullptr;
+    const char *telemetryPrefix = nullptr; // PREFIX-<thread>.s2st, one log per worker
+    Tuning tuning;
+};
+
+// Nights per NightBatch: enough lanes to fill vector units, few enough to stay in L2.
+constexpr uint64_t BATCH_LANES = 1024;
+
+struct SimStats
+{
+    uint64_t outcomes[5] = {};
+    uint64_t deathsByHour[6] = {};
+    uint64_t mismatches = 0;
+
+    void record(int hour, Outcome outcome)
+    {
+        outcomes[static_cast<int>(outcome)]++;
+        if (outcome != Outcome::Survived && outcome != Outcome::Running)
+            deathsByHour[std::min(std::max(hour, 0), 5)]++;
+    }
+
+    void merge(const SimStats &other)
+    {
+        for (int i = 0; i < 5; ++i)
+            outcomes[i] += other.outcomes[i];
+        for (int i = 0; i < 6; ++i)
+            deathsByHour[i] += other.deathsByHour[i];
+        mismatches += other.mismatches;
+    }
+};
+
+template <typename AI>
+static bool sameAI(const AI &a, const AI &b)
+{
+    return a.aggro == b.aggro && a.cooldown == b.cooldown && a.decisionAcc == b.decisionAcc &&
+           a.blockedTimer == b.blockedTimer;
+}
+
+static bool sameNight(const Night &a, const Night &b)
+{
+    const GameState &x = a.game;
+    const GameState &y = b.game;
+    return x.running == y.running && x.battery == y.battery &&
+           x.hoursSurvived == y.hoursSurvived && x.hourTicks == y.hourTicks &&
+           x.freddoPos == y.freddoPos && x.chicoPos == y.chicoPos &&
+           x.leftDoor == y.leftDoor && x.rightDoor == y.rightDoor &&
+           a.batteryAccumulator == b.batteryAccumulator && a.tick == b.tick &&
+           sameAI(std::get<Freddo>(a.animatronics), std::get<Freddo>(b.animatronics)) &&
+           sameAI(std::get<Chico>(a.animatronics), std::get<Chico>(b.animatronics)) &&
+           std::memcmp(a.rng.s, b.rng.s, sizeof a.rng.s) == 0;
+}
+
+// Runs one night on the scalar engines. With `lanes` (Verify), also checks the batch result.
+static void simulateNight(const SimOptions &options, uint64_t index, SimStats &stats,
+                          const NightBatch *lanes = nullptr, size_t lane = 0,
+                          TelemetryWriter *telemetry = nullptr)
+{
+    Night night = startNight(options.seed, index);
+    Rng policyRng;
+    policyRng.seed(~options.seed, index);
+
+    if (options.engine == Engine::Fixed)
+    {
+        const Outcome outcome = runNightFixed(night, options.policy, policyRng);
+        stats.record(night.game.hoursSurvived, outcome);
+        return;
+    }
+
+    if (options.engine == Engine::Verify)
+    {
+        Night fixed = night;
+        Rng fixedPolicyRng = policyRng;
+        const Outcome expected = runNightFixed(fixed, options.policy, fixedPolicyRng);
+        const Outcome outcome = runNightEvents(night, options.policy, policyRng);
+        stats.record(night.game.hoursSurvived, outcome);
+
+        bool same = sameNight(night, fixed) &&
+                    std::memcmp(policyRng.s, fixedPolicyRng.s, sizeof policyRng.s) == 0;
+        if (lanes && expected != Outcome::Running)
+            same = same && lanes->outcome[lane] == static_cast<int32_t>(expected) &&
+                   lanes->endTick[lane] == fixed.tick - 1;
+        if (!same)
+            stats.mismatches++;
+        return;
+    }
+
+    if (telemetry)
+        logNightStart(*telemetry, index);
+    const Outcome outcome =
+        runNightEvents(night, options.policy, policyRng, MAX_NIGHT_TICKS, telemetry);
+    stats.record(night.game.hoursSurvived, outcome);
+}
+
+static void simulateBatch(const SimOptions &options, uint64_t begin, uint64_t end,
+                          NightBatch &batch, SimStats &stats)
+{
+    startNightBatch(batch, end - begin, options.seed, begin);
+    runNightBatch(batch, options.policy);
+
+    for (size_t lane = 0; lane < batch.size(); ++lane)
+    {
+        if (options.engine == Engine::Verify)
+        {
+            simulateNight(options, begin + lane, stats, &batch, lane);
+            continue;
+        }
+        const int hour = (batch.endTick[lane] + 1) / TICKS_PER_HOUR;
+        stats.record(hour, static_cast<Outcome>(batch.outcome[lane]));
+    }
+}
+
+static void runWorker(const SimOptions &options, std::atomic<uint64_t> &nextNight, SimStats &stats,
+                      TelemetryWriter *telemetry = nullptr)
+{
+    setActiveTuning(options.tuning);
+    const bool batched = options.engine == Engine::Batch || options.engine == Engine::Verify;
+    const uint64_t chunk = batched ? BATCH_LANES : 256;
+    NightBatch batch;
+
+    for (;;)
+    {
+        const uint64_t begin = nextNight.fetch_add(chunk);
+        if (begin >= options.nights)
+            return;
+        const uint64_t end = std::min(begin + chunk, options.nights);
+
+        if (batched)
+        {
+            simulateBatch(options, begin, end, batch, stats);
+            continue;
+        }
+        for (uint64_t i = begin; i < end; ++i)
+            simulateNight(options, i, stats, nullptr, 0, telemetry);
+    }
+}
+
+// Single-threaded throughput of each engine over the same nights.
+static int runBenchmark(SimOptions options)
+{
+    std::printf("Benchmarking %llu nights (policy %s) on one thread\n",
+                static_cast<unsigned long long>(options.nights),
+                doorPolicyName(options.policy.kind));
+
+    double fixedRate = 0.0;
+    uint64_t survivedByFixed = 0;
+    bool agree = true;
+
+    for (Engine engine : {Engine::Fixed, Engine::Event, Engine::Batch})
+    {
+        options.engine = engine;
+        std::atomic<uint64_t> nextNight{0};
+        SimStats stats;
+
+        const auto start = std::chrono::steady_clock::now();
+        runWorker(options, nextNight, stats);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const double rate = elapsed.count() > 0 ? options.nights / elapsed.count() : 0.0;
+        const uint64_t survived = stats.outcomes[static_cast<int>(Outcome::Survived)];
+        if (engine == Engine::Fixed)
+        {
+            fixedRate = rate;
+            survivedByFixed = survived;
+        }
+        agree = agree && survived == survivedByFixed;
+
+        const char *name = engine == Engine::Fixed   ? "fixed (virtual)"
+                           : engine == Engine::Event ? "event"
+                                                     : "batch (SoA)";
+        std::printf("  %-16s %12.0f nights/sec  %6.1fx\n", name, rate,
+                    fixedRate > 0 ? rate / fixedRate : 0.0);
+    }
+
+    if (!agree)
+        std::printf("  engines disagree on survivals; run --engine verify\n");
+    return agree ? 0 : 1;
+}
+
+// Exact odds for the policy, by dynamic programming over every state of the night.
+static int runSolver(const SimOptions &options, unsigned threads)
+{
+    SolveOptions solve;
+    solve.policy = options.policy;
+    solve.optimal = options.optimal;
+    solve.threads = threads;
+    solve.policyPath = options.policyPath;
+
+    const auto start = std::chrono::steady_clock::now();
+    SolveResult result;
+    std::string error;
+    if (!solveSurvival(solve, result, error))
+    {
+        std::fprintf(stderr, "--solve: %s\n", error.c_str());
+        return 2;
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("Solved policy %s exactly on %u threads in %.2f s\n",
+                options.optimal ? "optimal" : doorPolicyName(options.policy.kind), threads,
+                elapsed.count());
+    std::printf("  states/second  %12llu\n",
+                static_cast<unsigned long long>(result.statesPerSecond));
+    std::printf("  survived       %11.4f%%\n", 100.0 * result.survival);
+    std::printf("  battery died   %11.4f%%\n",
+                100.0 * result.outcomes[static_cast<int>(Outcome::BatteryDied)]);
+    std::printf("  Freddo got in  %11.4f%%\n",
+                100.0 * result.outcomes[static_cast<int>(Outcome::FreddoGotIn)]);
+    std::printf("  Chico got in   %11.4f%%\n",
+                100.0 * result.outcomes[static_cast<int>(Outcome::ChicoGotIn)]);
+    std::printf("  deaths by hour ");
+    for (int hour = 0; hour < 6; ++hour)
+        std::printf(" %d:%.4f%%", hour == 0 ? 12 : hour, 100.0 * result.deathsByHour[hour]);
+    std::printf("\n");
+    if (!options.policyPath)
+        return 0;
+    if (!result.policyWritten)
+    {
+        std::fprintf(stderr, "%s: can't write the policy\n", options.policyPath);
+        return 1;
+    }
+    std::printf("  policy rows    %12llu -> %s\n",
+                static_cast<unsigned long long>(result.policyRows), options.policyPath);
+    return 0;
+}
+
+// Plays one branch on from a restored night. The doors it was given hold until the policy
+// next looks, on the following whole second.
+static Outcome runBranch(Night &night, const DoorPolicy &policy, Rng &policyRng)
+{
+    Outcome outcome = nightOutcome(night.game);
+    if (outcome == Outcome::Running && night.tick % TICKS_PER_SECOND == 0)
+    {
+        stepNight(night);
+        outcome = nightOutcome(night.game);
+    }
+    if (outcome == Outcome::Running)
+        outcome = runNightEvents(night, policy, policyRng);
+    return outcome;
+}
+
+// "What if I close the door now": forks a saved night into --nights branches for each door
+// setting, each with its own RNG stream, and compares how they end.
+static int runFork(const SimOptions &options, unsigned threads)
+{
+    NightSnapshot snapshot;
+    std::string error;
+    if (!loadSnapshot(options.forkPath, snapshot, error))
+    {
+        std::fprintf(stderr, "%s: %s\n", options.forkPath, error.c_str());
+        return 2;
+    }
+    Night saved;
+    restoreSnapshot(snapshot, saved);
+    if (nightOutcome(saved.game) != Outcome::Running)
+    {
+        std::fprintf(stderr, "%s: that night is already over\n", options.forkPath);
+        return 2;
+    }
+
+    const int hour = saved.game.hoursSurvived == 0 ? 12 : saved.game.hoursSurvived;
+    std::printf("Forking %s at tick %d (%d AM, battery %d%%) into %llu branches per door "
+                "setting, policy %s afterwards\n",
+                options.forkPath, saved.tick, hour, saved.game.battery,
+                static_cast<unsigned long long>(options.nights),
+                doorPolicyName(options.policy.kind));
+
+    const int now = (saved.game.leftDoor ? 1 : 0) | (saved.game.rightDoor ? 2 : 0);
+    for (int doors = 0; doors < 4; ++doors)
+    {
+        std::atomic<uint64_t> nextBranch{0};
+        std::vector<SimStats> perThread(threads);
+        auto worker = [&](SimStats &stats) {
+            setActiveTuning(options.tuning);
+            for (;;)
+            {
+                const uint64_t branch = nextBranch.fetch_add(1);
+                if (branch >= options.nights)
+                    return;
+                Night night;
+                restoreSnapshot(snapshot, night);
+                night.game.leftDoor = doors & 1;
+                night.game.rightDoor = doors & 2;
+                reseedBranch(night, options.seed, branch);
+                Rng policyRng;
+                policyRng.seed(~options.seed, branch);
+                const Outcome outcome = runBranch(night, options.policy, policyRng);
+                stats.record(night.game.hoursSurvived, outcome);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threads; ++t)
+            workers.emplace_back(worker, std::ref(perThread[t]));
+        worker(perThread[0]);
+        for (auto &thread : workers)
+            thread.join();
+
+        SimStats total;
+        for (const auto &stats : perThread)
+            total.merge(stats);
+        auto percent = [&](Outcome outcome) {
+            return options.nights > 0
+                       ? 100.0 * total.outcomes[static_cast<int>(outcome)] / options.nights
+                       : 0.0;
+        };
+        std::printf("  left %-6s right %-6s survived %6.2f%%  battery died %6.2f%%  "
+                    "Freddo %6.2f%%  Chico %6.2f%%%s\n",
+                    doors & 1 ? "closed" : "open", doors & 2 ? "closed" : "open",
+                    percent(Outcome::Survived), percent(Outcome::BatteryDied),
+                    percent(Outcome::FreddoGotIn), percent(Outcome::ChicoGotIn),
+                    doors == now ? "  (as saved)" : "");
+    }
+    return 0;
+}
+
+static bool parseOptions(int argc, char **argv, SimOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(arg, "--nights") == 0 && value)
+        {
+            if (!parseCount(argv[++i], options.nights))
+                return false;
+        }
+        else if (std::strcmp(arg, "--threads") == 0 && value)
+        {
+            if (!parseCount(argv[++i], 0u, MAX_THREADS, options.threads))
+                return false;
+        }
+        else if (std::strcmp(arg, "--seed") == 0 && value)
+        {
+            if (!parseCount(argv[++i], options.seed))
+                return false;
+        }
+        else if (std::strcmp(arg, "--toggle-chance") == 0 && value)
+        {
+            if (!parseReal(argv[++i], 0.0, 1.0, options.policy.toggleChance))
+                return false;
+        }
+        else if (std::strcmp(arg, "--policy") == 0 && value)
+        {
+            ++i;
+            options.optimal = std::strcmp(value, "optimal") == 0;
+            if (!options.optimal && !parseDoorPolicy(value, options.policy.kind))
+                return false;
+        }
+        else if (std::strcmp(arg, "--solve") == 0)
+            options.solve = true;
+        else if (std::strcmp(arg, "--policy-csv") == 0 && value)
+            options.policyPath = argv[++i];
+        else if (std::strcmp(arg, "--fork") == 0 && value)
+            options.forkPath = argv[++i];
+        else if (std::strcmp(arg, "--bench") == 0)
+            options.bench = true;
+        else if (std::strcmp(arg, "--map") == 0 && value)
+            options.mapPath = argv[++i];
+        else if (std::strcmp(arg, "--telemetry") == 0 && value)
+            options.telemetryPrefix = argv[++i];
+        else if (std::strcmp(arg, "--set") == 0 && value)
+        {
+            if (!parseTuningSetting(argv[++i], options.tuning))
+                return false;
+        }
+        else if (std::strcmp(arg, "--engine") == 0 && value)
+        {
+            ++i;
+            if (std::strcmp(value, "fixed") == 0)
+                options.engine = Engine::Fixed;
+            else if (std::strcmp(value, "event") == 0)
+                options.engine = Engine::Event;
+            else if (std::strcmp(value, "batch") == 0)
+                options.engine = Engine::Batch;
+            else if (std::strcmp(value, "verify") == 0)
+                options.engine = Engine::Verify;
+            else
+                return false;
+        }
+        else
+            return false;
+    }
+    // Only the event engine logs telemetry; the others have no per-step hook.
+    if (options.telemetryPrefix && (options.engine != Engine::Event || options.solve ||
+                                    options.forkPath || options.bench))
+        return false;
+    // Only the solver can play the optimal policy; it has to know every state's odds.
+    return options.solve || (!options.optimal && !options.policyPath);
+}
+
+int main(int argc, char **argv)
+{
+    SimOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [--nights N] [--threads N] [--seed N]\n"
+                     "          [--policy none|scripted|random] [--toggle-chance P]\n"
+                     "          [--engine event|fixed|batch|verify] [--bench] [--map FILE]\n"
+                     "          [--set NAME=VALUE]... [--telemetry PREFIX]\n"
+                     "       %s --solve [--policy none|scripted|random|optimal]\n"
+                     "          [--toggle-chance P] [--threads N] [--policy-csv FILE]\n"
+                     "          [--map FILE] [--set NAME=VALUE]...\n"
+                     "       %s --fork SAVED.s2ss [--nights N] [--policy none|scripted|random]\n"
+                     "          [--threads N] [--seed N] [--map FILE] [--set NAME=VALUE]...\n",
+                     argv[0], argv[0], argv[0]);
+        return 2;
+    }
+
+    std::string error;
+    if (!validateTuning(options.tuning, error))
+    {
+        std::fprintf(stderr, "--set: %s\n", error.c_str());
+        return 2;
+    }
+    setActiveTuning(options.tuning);
+
+    if (options.mapPath)
+    {
+        RoomGraph graph;
+        if (!loadRoomGraph(options.mapPath, graph, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.mapPath, error.c_str());
+            return 2;
+        }
+        setActiveRoomGraph(graph);
+    }
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    if (options.solve)
+        return runSolver(options, threads);
+    if (options.forkPath)
+        return runFork(options, threads);
+
+    // The batched kernel has the built-in routes compiled in.
+    if (!hasDefaultRoutes(activeRoomGraph()) &&
+        (options.bench || options.engine == Engine::Batch || options.engine == Engine::Verify))
+    {
+        std::fprintf(stderr, "The batch engine only runs the built-in map; use --engine event "
+                             "or fixed\n");
+        return 2;
+    }
+
+    if (options.bench)
+        return runBenchmark(options);
+
+    std::vector<TelemetryWriter> telemetry(options.telemetryPrefix ? threads : 0);
+    for (unsigned t = 0; t < telemetry.size(); ++t)
+    {
+        const std::string path =
+            std::string(options.telemetryPrefix) + "-" + std::to_string(t) + ".s2st";
+        if (!openTelemetry(telemetry[t], path.c_str(), error))
+        {
+            std::fprintf(stderr, "%s: %s\n", path.c_str(), error.c_str());
+            return 2;
+        }
+    }
+
+    std::atomic<uint64_t> nextNight{0};
+    std::vector<SimStats> perThread(threads);
+    std::vector<std::thread> workers;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t)
+    {
+        TelemetryWriter *log = telemetry.empty() ? nullptr : &telemetry[t];
+        workers.emplace_back(runWorker, std::cref(options), std::ref(nextNight),
+                             std::ref(perThread[t]), log);
+    }
+    for (auto &worker : workers)
+        worker.join();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    for (TelemetryWriter &writer : telemetry)
+        closeTelemetry(writer);
+
+    SimStats total;
+    for (const auto &stats : perThread)
+        total.merge(stats);
+
+    const double nights = static_cast<double>(options.nights);
+    auto percent = [&](Outcome outcome) {
+        return nights > 0 ? 100.0 * total.outcomes[static_cast<int>(outcome)] / nights : 0.0;
+    };
+
+    std::printf("Simulated %llu nights (policy %s, seed %llu) on %u threads in %.2f s\n",
+                static_cast<unsigned long long>(options.nights),
+                doorPolicyName(options.policy.kind), static_cast<unsigned long long>(options.seed),
+                threads, elapsed.count());
+    std::printf("  nights/sec     %12.0f\n", elapsed.count() > 0 ? nights / elapsed.count() : 0.0);
+    std::printf("  survived       %11.2f%%\n", percent(Outcome::Survived));
+    std::printf("  battery died   %11.2f%%\n", percent(Outcome::BatteryDied));
+    std::printf("  Freddo got in  %11.2f%%\n", percent(Outcome::FreddoGotIn));
+    std::printf("  Chico got in   %11.2f%%\n", percent(Outcome::ChicoGotIn));
+    std::printf("  deaths by hour ");
+    for (int hour = 0; hour < 6; ++hour)
+        std::printf(" %d:%llu", hour == 0 ? 12 : hour,
+                    static_cast<unsigned long long>(total.deathsByHour[hour]));
+    std::printf("\n");
+    if (total.outcomes[static_cast<int>(Outcome::Running)] > 0)
+        std::printf("  unfinished     %11.2f%%\n", percent(Outcome::Running));
+    if (options.engine == Engine::Verify)
+    {
+        std::printf("  engine mismatches %9llu\n",
+                    static_cast<unsigned long long>(total.mismatches));
+        return total.mismatches == 0 ? 0 : 1;
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "simulation.hpp"
+
+Night startNight(uint64_t seed, uint64_t stream)
+{
+    Night night;
+    night.rng.seed(seed, stream);
+    return night;
+}
+
+bool stepNight(Night &night)
+{
+    GameState &game = night.game;
+
+    bool changed = advanceClock(game);
+    if (drainBattery(game, night.batteryAccumulator, batteryDrainPerTick(game)))
+        changed = true;
+
+    forEachAnimatronic(night.animatronics, [&](auto &ai) { ai.update(game, night.rng); });
+    night.tick++;
+    return changed;
+}
+
+Outcome runNightFixed(Night &night, const DoorPolicy &policy, Rng &policyRng, int maxTicks)
+{
+    Outcome outcome = nightOutcome(night.game);
+
+    while (outcome == Outcome::Running && night.tick < maxTicks)
+    {
+        if (night.tick % TICKS_PER_SECOND == 0)
+            applyDoorPolicy(policy, night.game, policyRng);
+
+        stepNight(night);
+        outcome = nightOutcome(night.game);
+    }
+    return outcome;
+}
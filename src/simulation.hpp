@@ -0,0 +1,33 @@
+#pragma once
+
+#include "animatronic.hpp"
+#include "door_policy.hpp"
+#include "game_state.hpp"
+#include "rng.hpp"
+
+#include <cstdint>
+
+// Everything that changes during one night, free of ncurses and the wall clock, so the
+// same rules drive the terminal game and the headless simulator.
+struct Night
+{
+    GameState game = newGame();
+    Animatronics animatronics;
+    int batteryAccumulator = 0;
+    int tick = 0;
+    Rng rng;
+};
+
+// Six hours plus slack; every night is decided well before this.
+constexpr int MAX_NIGHT_TICKS = 7 * TICKS_PER_HOUR;
+
+Night startNight(uint64_t seed, uint64_t stream = 0);
+
+// Advances clock, battery and both animatronics by one tick. Returns true when the battery
+// or hour changed.
+bool stepNight(Night &night);
+
+// Reference fixed-step run: the policy acts at the start of every whole second, then one
+// stepNight per tick until the night is decided or maxTicks pass.
+Outcome runNightFixed(Night &night, const DoorPolicy &policy, Rng &policyRng,
+                      int maxTicks = MAX_NIGHT_TICKS);
@@ -0,0 +1,126 @@
+#include "snapshot.hpp"
+
+#include "room_graph.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+static constexpr char SNAPSHOT_MAGIC[4] = {'S', '2', 'S', 'S'};
+static constexpr uint8_t SNAPSHOT_VERSION = 1;
+static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+static constexpr size_t HEADER_SIZE = 4 + 1 + 4 + 1;
+
+NightSnapshot takeSnapshot(const Night &night)
+{
+    const GameState &game = night.game;
+    NightSnapshot snapshot;
+    std::memcpy(snapshot.rng, night.rng.s, sizeof snapshot.rng);
+    snapshot.tick = night.tick;
+    snapshot.freddoPos = game.freddoPos;
+    snapshot.chicoPos = game.chicoPos;
+    snapshot.hourTicks = static_cast<uint16_t>(game.hourTicks);
+    snapshot.batteryAccumulator = static_cast<uint16_t>(night.batteryAccumulator);
+    snapshot.battery = static_cast<int16_t>(game.battery);
+    snapshot.hoursSurvived = static_cast<uint8_t>(game.hoursSurvived);
+    snapshot.flags = (game.running ? SNAPSHOT_RUNNING : 0) |
+                     (game.leftDoor ? SNAPSHOT_LEFT_DOOR : 0) |
+                     (game.rightDoor ? SNAPSHOT_RIGHT_DOOR : 0) |
+                     (game.cameraUp ? SNAPSHOT_CAMERA_UP : 0);
+
+    AnimatronicSnapshot *out = snapshot.animatronics;
+    forEachAnimatronic(night.animatronics, [&](const auto &ai) {
+        *out++ = {ai.cooldown, static_cast<uint16_t>(ai.aggro),
+                  static_cast<uint8_t>(ai.decisionAcc), static_cast<uint8_t>(ai.blockedTimer)};
+    });
+    return snapshot;
+}
+
+void restoreSnapshot(const NightSnapshot &snapshot, Night &night)
+{
+    GameState &game = night.game;
+    std::memcpy(night.rng.s, snapshot.rng, sizeof snapshot.rng);
+    night.tick = snapshot.tick;
+    game.freddoPos = snapshot.freddoPos;
+    game.chicoPos = snapshot.chicoPos;
+    game.hourTicks = snapshot.hourTicks;
+    night.batteryAccumulator = snapshot.batteryAccumulator;
+    game.battery = snapshot.battery;
+    game.hoursSurvived = snapshot.hoursSurvived;
+    game.running = snapshot.flags & SNAPSHOT_RUNNING;
+    game.leftDoor = snapshot.flags & SNAPSHOT_LEFT_DOOR;
+    game.rightDoor = snapshot.flags & SNAPSHOT_RIGHT_DOOR;
+    game.cameraUp = snapshot.flags & SNAPSHOT_CAMERA_UP;
+
+    const AnimatronicSnapshot *in = snapshot.animatronics;
+    forEachAnimatronic(night.animatronics, [&](auto &ai) {
+        ai.cooldown = in->cooldown;
+        ai.aggro = in->aggro;
+        ai.decisionAcc = in->decisionAcc;
+        ai.blockedTimer = in->blockedTimer;
+        ++in;
+    });
+}
+
+void reseedBranch(Night &night, uint64_t seed, uint64_t branch) { night.rng.seed(seed, branch); }
+
+bool saveSnapshot(const char *path, const NightSnapshot &snapshot)
+{
+    uint8_t out[HEADER_SIZE + sizeof snapshot];
+    std::memcpy(out, SNAPSHOT_MAGIC, 4);
+    out[4] = SNAPSHOT_VERSION;
+    std::memcpy(out + 5, &BYTE_ORDER_MARK, 4);
+    out[9] = static_cast<uint8_t>(sizeof snapshot);
+    std::memcpy(out + HEADER_SIZE, &snapshot, sizeof snapshot);
+
+    std::FILE *file = std::fopen(path, "wb");
+    if (!file)
+        return false;
+    const bool ok = std::fwrite(out, 1, sizeof out, file) == sizeof out;
+    return std::fclose(file) == 0 && ok;
+}
+
+// A snapshot from another map, a corrupt file or an old build must not put animatronics in
+// rooms that don't exist.
+static bool plausible(const NightSnapshot &snapshot)
+{
+    const int rooms = activeRoomGraph().roomCount;
+    if (snapshot.freddoPos < 1 || snapshot.freddoPos > rooms || snapshot.chicoPos < 1 ||
+        snapshot.chicoPos > rooms || snapshot.tick < 0 || snapshot.hourTicks >= TICKS_PER_HOUR ||
+        snapshot.batteryAccumulator >= BATTERY_UNIT || snapshot.flags > 15)
+        return false;
+    for (const AnimatronicSnapshot &ai : snapshot.animatronics)
+        if (ai.cooldown < 0 || ai.aggro > AGGRO_ONE || ai.decisionAcc >= DECISION_TICKS)
+            return false;
+    return true;
+}
+
+bool loadSnapshot(const char *path, NightSnapshot &snapshot, std::string &error)
+{
+    std::FILE *file = std::fopen(path, "rb");
+    if (!file)
+    {
+        error = "can't open the file";
+        return false;
+    }
+    uint8_t in[HEADER_SIZE + sizeof snapshot + 1];
+    const size_t got = std::fread(in, 1, sizeof in, file);
+    std::fclose(file);
+
+    uint32_t mark = 0;
+    if (got >= HEADER_SIZE)
+        std::memcpy(&mark, in + 5, 4);
+    if (got < HEADER_SIZE || std::memcmp(in, SNAPSHOT_MAGIC, 4) != 0)
+        error = "not a saved night";
+    else if (in[4] != SNAPSHOT_VERSION || in[9] != sizeof snapshot || mark != BYTE_ORDER_MARK)
+        error = "saved by a different version or machine";
+    else if (got != HEADER_SIZE + sizeof snapshot)
+        error = "truncated or corrupt";
+    else
+    {
+        std::memcpy(&snapshot, in + HEADER_SIZE, sizeof snapshot);
+        if (plausible(snapshot))
+            return true;
+        error = "doesn't fit the current map";
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "simulation.hpp"
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+// Everything a Night is, packed into a fixed 52-byte record that copies with memcpy: the
+// GameState, each animatronic's timers, the battery accumulator, the tick and the RNG. Taking
+// or restoring one is a handful of moves, so a mid-night state can be saved for later or forked
+// into thousands of branches. Snapshots only make sense with the map and tuning they came from.
+struct AnimatronicSnapshot
+{
+    int32_t cooldown;
+    uint16_t aggro;       // 0..AGGRO_ONE
+    uint8_t decisionAcc;  // 0..DECISION_TICKS - 1
+    uint8_t blockedTimer; // at most the retreat decisions (see validateTuning)
+};
+
+struct NightSnapshot
+{
+    uint32_t rng[4];
+    int32_t tick;
+    int32_t freddoPos;
+    int32_t chicoPos;
+    uint16_t hourTicks;
+    uint16_t batteryAccumulator;
+    int16_t battery;
+    uint8_t hoursSurvived;
+    uint8_t flags; // the SNAPSHOT_* bits below
+    AnimatronicSnapshot animatronics[std::tuple_size<Animatronics>::value];
+};
+
+constexpr uint8_t SNAPSHOT_RUNNING = 1;
+constexpr uint8_t SNAPSHOT_LEFT_DOOR = 2;
+constexpr uint8_t SNAPSHOT_RIGHT_DOOR = 4;
+// Which camera the monitor shows isn't kept; a resumed night starts on the first one.
+constexpr uint8_t SNAPSHOT_CAMERA_UP = 8;
+
+static_assert(std::is_trivially_copyable<NightSnapshot>::value, "snapshots are copied as bytes");
+static_assert(sizeof(NightSnapshot) == 52, "snapshot layout changed; bump SNAPSHOT_VERSION");
+
+NightSnapshot takeSnapshot(const Night &night);
+void restoreSnapshot(const NightSnapshot &snapshot, Night &night);
+
+// Gives a restored night its own RNG stream, so branches forked from one snapshot play out
+// differently. Stream numbers work like startNight's.
+void reseedBranch(Night &night, uint64_t seed, uint64_t branch);
+
+// Save file: "S2SS", version byte, a byte-order mark, the snapshot size and the raw record.
+// Loading checks the record against the active map before accepting it.
+bool saveSnapshot(const char *path, const NightSnapshot &snapshot);
+bool loadSnapshot(const char *path, NightSnapshot &snapshot, std::string &error);
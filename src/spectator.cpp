@@ -0,0 +1,374 @@
+#include "spectator.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SPECTATOR_SHM 1
+#endif
+
+constexpr char SPECTATOR_MAGIC[8] = {'S', '2', 'S', 'C', 'A', 'S', 'T', '\0'};
+constexpr uint32_t SPECTATOR_VERSION = 1;
+constexpr uint32_t RING_BYTES = 1u << 20;
+constexpr uint64_t NO_KEYFRAME = ~0ull;
+constexpr int CELL_COUNT = Framebuffer::ROWS * Framebuffer::COLS;
+// A keyframe at least this often, and whenever the deltas since the last one fill a quarter of
+// the ring, so the latest keyframe is always still in the ring for a viewer to start from.
+constexpr uint32_t KEYFRAME_INTERVAL = 64;
+
+static_assert(sizeof(Cell) == 3, "rows are compared with memcmp, so cells have no padding");
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the ring's counters are shared between processes");
+
+// Lives at the start of the mapping, followed by the ring. Positions count bytes ever written,
+// so position % RING_BYTES is where a record sits.
+struct SpectatorShared
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t ringBytes;
+    alignas(64) std::atomic<uint64_t> reserved;  // the writer may be overwriting below this
+    std::atomic<uint64_t> published;             // records before this are complete
+    std::atomic<uint64_t> keyframe;              // position of the latest keyframe
+    std::atomic<uint32_t> ended;
+};
+
+constexpr size_t RING_OFFSET = (sizeof(SpectatorShared) + 63) / 64 * 64;
+
+// Records are 8-byte aligned so a padding record always fits in the space left before the end
+// of the ring. A delta is `count` 4-byte entries (cell index, character, attributes); a
+// keyframe is every cell as (character, attributes).
+enum RecordKind : uint8_t
+{
+    RECORD_PADDING,
+    RECORD_KEYFRAME,
+    RECORD_DELTA,
+};
+
+struct RecordHeader
+{
+    uint32_t size; // header included
+    uint8_t kind;
+    uint8_t unused;
+    uint16_t count;
+};
+
+constexpr size_t MAX_RECORD = sizeof(RecordHeader) + CELL_COUNT * 4;
+
+static uint32_t alignRecord(size_t size) { return static_cast<uint32_t>((size + 7) / 8 * 8); }
+
+static uint8_t packAttributes(const Cell &cell)
+{
+    return static_cast<uint8_t>(static_cast<uint8_t>(cell.color) | (cell.bold ? 0x80 : 0));
+}
+
+static Cell unpackCell(uint8_t ch, uint8_t attributes)
+{
+    Cell cell;
+    cell.ch = static_cast<char>(ch);
+    cell.color = static_cast<Color>(attributes & 0x7f);
+    cell.bold = (attributes & 0x80) != 0;
+    return cell;
+}
+
+#ifdef SPECTATOR_SHM
+
+// Shared-memory names start with a slash; "s2s" and "/s2s" name the same broadcast.
+static std::string objectName(const char *name)
+{
+    return name[0] == '/' ? std::string(name) : "/" + std::string(name);
+}
+
+bool openSpectatorWriter(SpectatorWriter &writer, const char *name, std::string &error)
+{
+    const std::string object = objectName(name);
+    shm_unlink(object.c_str());
+    const int fd = shm_open(object.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    const size_t bytes = RING_OFFSET + RING_BYTES;
+    if (fd < 0 || ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+    {
+        error = std::strerror(errno);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    void *map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        error = std::strerror(errno);
+        shm_unlink(object.c_str());
+        return false;
+    }
+
+    SpectatorShared *shared = new (map) SpectatorShared;
+    shared->version = SPECTATOR_VERSION;
+    shared->ringBytes = RING_BYTES;
+    shared->reserved.store(0);
+    shared->published.store(0);
+    shared->keyframe.store(NO_KEYFRAME);
+    shared->ended.store(0);
+    // Viewers check the magic before anything else, so it goes in last.
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(shared->magic, SPECTATOR_MAGIC, sizeof shared->magic);
+
+    writer.shared = shared;
+    writer.ring = static_cast<uint8_t *>(map) + RING_OFFSET;
+    writer.mappedBytes = bytes;
+    writer.name = object;
+    writer.started = false;
+    writer.framesSinceKeyframe = 0;
+    return true;
+}
+
+// Copies one finished record into the ring, wrapping to the start with a padding record when
+// it doesn't fit before the end.
+static uint64_t appendRecord(SpectatorWriter &writer, const uint8_t *record, uint32_t size)
+{
+    SpectatorShared &shared = *writer.shared;
+    uint64_t position = shared.published.load(std::memory_order_relaxed);
+    const uint32_t room = RING_BYTES - static_cast<uint32_t>(position % RING_BYTES);
+    const uint32_t padding = room < size ? room : 0;
+
+    // Announce the bytes about to be overwritten before touching them; a reader that copied
+    // them meanwhile sees this and throws its copy away.
+    shared.reserved.store(position + padding + size, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (padding > 0)
+    {
+        const RecordHeader pad{padding, RECORD_PADDING, 0, 0};
+        std::memcpy(writer.ring + position % RING_BYTES, &pad, sizeof pad);
+        position += padding;
+    }
+    std::memcpy(writer.ring + position % RING_BYTES, record, size);
+    shared.published.store(position + size, std::memory_order_release);
+    return position;
+}
+
+void publishFrame(SpectatorWriter &writer, const Framebuffer &fb)
+{
+    if (!writer.shared)
+        return;
+
+    uint8_t record[MAX_RECORD];
+    uint8_t *out = record + sizeof(RecordHeader);
+    const bool keyframe = !writer.started || writer.framesSinceKeyframe >= KEYFRAME_INTERVAL ||
+                          writer.shared->published.load(std::memory_order_relaxed) -
+                                  writer.lastKeyframe >
+                              RING_BYTES / 4;
+    int count = 0;
+    for (int row = 0; row < Framebuffer::ROWS; ++row)
+    {
+        // Most rows are the same as last frame; skip them whole.
+        if (!keyframe && std::memcmp(fb.cells[row], writer.last[row], sizeof fb.cells[row]) == 0)
+            continue;
+        for (int col = 0; col < Framebuffer::COLS; ++col)
+        {
+            const Cell &cell = fb.cells[row][col];
+            if (keyframe)
+            {
+                *out++ = static_cast<uint8_t>(cell.ch);
+                *out++ = packAttributes(cell);
+            }
+            else if (cell != writer.last[row][col])
+            {
+                const uint16_t index = static_cast<uint16_t>(row * Framebuffer::COLS + col);
+                std::memcpy(out, &index, 2);
+                out[2] = static_cast<uint8_t>(cell.ch);
+                out[3] = packAttributes(cell);
+                out += 4;
+                count++;
+            }
+        }
+        std::memcpy(writer.last[row], fb.cells[row], sizeof fb.cells[row]);
+    }
+    if (!keyframe && count == 0)
+        return;
+
+    const uint32_t size = alignRecord(out - record);
+    std::memset(out, 0, record + size - out);
+    const RecordHeader header{size, keyframe ? RECORD_KEYFRAME : RECORD_DELTA, 0,
+                              static_cast<uint16_t>(keyframe ? CELL_COUNT : count)};
+    std::memcpy(record, &header, sizeof header);
+
+    const uint64_t position = appendRecord(writer, record, size);
+    if (keyframe)
+    {
+        writer.shared->keyframe.store(position, std::memory_order_release);
+        writer.lastKeyframe = position;
+        writer.framesSinceKeyframe = 0;
+        writer.started = true;
+    }
+    else
+        writer.framesSinceKeyframe++;
+}
+
+void closeSpectatorWriter(SpectatorWriter &writer)
+{
+    if (!writer.shared)
+        return;
+    writer.shared->ended.store(1, std::memory_order_release);
+    munmap(writer.shared, writer.mappedBytes);
+    shm_unlink(writer.name.c_str());
+    writer.shared = nullptr;
+    writer.ring = nullptr;
+}
+
+bool openSpectatorReader(SpectatorReader &reader, const char *name, std::string &error)
+{
+    const int fd = shm_open(objectName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0)
+    {
+        error = errno == ENOENT ? "no broadcast by that name" : std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    const bool sized = fstat(fd, &info) == 0 &&
+                       static_cast<size_t>(info.st_size) >= RING_OFFSET + RING_BYTES;
+    void *map = sized ? mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED,
+                             fd, 0)
+                      : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        error = sized ? std::strerror(errno) : "not a broadcast";
+        return false;
+    }
+
+    const SpectatorShared *shared = static_cast<const SpectatorShared *>(map);
+    if (std::memcmp(shared->magic, SPECTATOR_MAGIC, sizeof shared->magic) != 0 ||
+        shared->version != SPECTATOR_VERSION || shared->ringBytes != RING_BYTES)
+    {
+        munmap(map, static_cast<size_t>(info.st_size));
+        error = "not a broadcast from this version";
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    reader.shared = shared;
+    reader.ring = static_cast<const uint8_t *>(map) + RING_OFFSET;
+    reader.mappedBytes = static_cast<size_t>(info.st_size);
+    reader.synced = false;
+    reader.resyncs = 0;
+    return true;
+}
+
+static void applyRecord(const RecordHeader &header, const uint8_t *payload, Framebuffer &fb)
+{
+    Cell *cells = &fb.cells[0][0];
+    if (header.kind == RECORD_KEYFRAME)
+    {
+        for (int i = 0; i < CELL_COUNT; ++i)
+            cells[i] = unpackCell(payload[2 * i], payload[2 * i + 1]);
+        return;
+    }
+    for (int i = 0; i < header.count; ++i)
+    {
+        const uint8_t *entry = payload + 4 * i;
+        uint16_t index;
+        std::memcpy(&index, entry, 2);
+        if (index < CELL_COUNT)
+            cells[index] = unpackCell(entry[2], entry[3]);
+    }
+}
+
+// Copies the record at the reader's position; false if the writer lapped the reader while it
+// was copying (or before), in which case the copy is garbage.
+static bool copyRecord(const SpectatorReader &reader, uint8_t *record, RecordHeader &header)
+{
+    const uint32_t offset = static_cast<uint32_t>(reader.position % RING_BYTES);
+    std::memcpy(&header, reader.ring + offset, sizeof header);
+    const bool sane = header.size >= sizeof header && header.size <= MAX_RECORD &&
+                      header.size % 8 == 0 && offset + header.size <= RING_BYTES;
+    if (sane)
+        std::memcpy(record, reader.ring + offset, header.size);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t reserved = reader.shared->reserved.load(std::memory_order_relaxed);
+    return sane && reserved <= reader.position + RING_BYTES;
+}
+
+SpectatorStatus readFrames(SpectatorReader &reader, Framebuffer &fb)
+{
+    const SpectatorShared &shared = *reader.shared;
+    // Read before `published`, so every frame sent before the end is seen.
+    const bool ended = shared.ended.load(std::memory_order_acquire) != 0;
+    const uint64_t published = shared.published.load(std::memory_order_acquire);
+    bool updated = false;
+    uint8_t record[MAX_RECORD];
+
+    for (int attempt = 0; attempt < 4; ++attempt)
+    {
+        if (!reader.synced || published - reader.position > RING_BYTES)
+        {
+            const uint64_t keyframe = shared.keyframe.load(std::memory_order_acquire);
+            if (keyframe == NO_KEYFRAME)
+                break;
+            if (reader.synced)
+                reader.resyncs++;
+            reader.position = keyframe;
+            reader.synced = false;
+        }
+
+        bool lapped = false;
+        while (reader.position < published)
+        {
+            RecordHeader header;
+            if (!copyRecord(reader, record, header))
+            {
+                lapped = true;
+                break;
+            }
+            if (header.kind == RECORD_KEYFRAME || (header.kind == RECORD_DELTA && reader.synced))
+            {
+                applyRecord(header, record + sizeof header, fb);
+                reader.synced = true;
+                updated = true;
+            }
+            reader.position += header.size;
+        }
+        if (!lapped)
+            break;
+        reader.synced = false;
+    }
+
+    if (updated)
+        return SpectatorStatus::Updated;
+    return ended && reader.position >= published ? SpectatorStatus::Ended : SpectatorStatus::Idle;
+}
+
+void closeSpectatorReader(SpectatorReader &reader)
+{
+    if (reader.shared)
+        munmap(const_cast<SpectatorShared *>(reader.shared), reader.mappedBytes);
+    reader.shared = nullptr;
+    reader.ring = nullptr;
+}
+
+#else
+
+bool openSpectatorWriter(SpectatorWriter &, const char *, std::string &error)
+{
+    error = "broadcasting needs POSIX shared memory";
+    return false;
+}
+
+void publishFrame(SpectatorWriter &, const Framebuffer &) {}
+void closeSpectatorWriter(SpectatorWriter &) {}
+
+bool openSpectatorReader(SpectatorReader &, const char *, std::string &error)
+{
+    error = "watching needs POSIX shared memory";
+    return false;
+}
+
+SpectatorStatus readFrames(SpectatorReader &, Framebuffer &) { return SpectatorStatus::Ended; }
+void closeSpectatorReader(SpectatorReader &) {}
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "framebuffer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct SpectatorShared;
+
+// Live broadcast of the game's screen to any number of local viewer processes through a
+// POSIX shared-memory ring. The game appends each frame's changed cells (and every so often a
+// keyframe of the whole screen) and never waits for anyone: viewers map the ring read-only,
+// poll it and check after copying a record that the game hasn't lapped them meanwhile. A viewer
+// that joins late, or falls a whole ring behind, restarts from the latest keyframe. The game's
+// cost per frame is the same with no viewers or a hundred.
+struct SpectatorWriter
+{
+    SpectatorShared *shared = nullptr;
+    uint8_t *ring = nullptr;
+    size_t mappedBytes = 0;
+    std::string name;
+    Cell last[Framebuffer::ROWS][Framebuffer::COLS];
+    uint64_t lastKeyframe = 0; // ring position of the latest keyframe
+    uint32_t framesSinceKeyframe = 0;
+    bool started = false;
+};
+
+struct SpectatorReader
+{
+    const SpectatorShared *shared = nullptr;
+    const uint8_t *ring = nullptr;
+    size_t mappedBytes = 0;
+    uint64_t position = 0; // next record to read
+    bool synced = false;   // false until a keyframe has been applied
+    uint64_t resyncs = 0;  // times the reader was lapped and jumped to a keyframe
+};
+
+enum class SpectatorStatus
+{
+    Idle,    // nothing new
+    Updated, // the screen changed
+    Ended,   // the game closed the broadcast; the last frame stays as it was
+};
+
+// `name` is a shared-memory object name such as "/s2s". Opening a writer replaces any earlier
+// broadcast under the same name.
+bool openSpectatorWriter(SpectatorWriter &writer, const char *name, std::string &error);
+// Appends the cells of `fb` that changed since the last call.
+void publishFrame(SpectatorWriter &writer, const Framebuffer &fb);
+// Tells viewers the broadcast is over and removes the name.
+void closeSpectatorWriter(SpectatorWriter &writer);
+
+bool openSpectatorReader(SpectatorReader &reader, const char *name, std::string &error);
+// Applies every frame published since the last call to fb.cells.
+SpectatorStatus readFrames(SpectatorReader &reader, Framebuffer &fb);
+void closeSpectatorReader(SpectatorReader &reader);
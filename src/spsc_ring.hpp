@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed-size lock-free queue for exactly one producer thread and one consumer thread.
+// N must be a power of two; the indices only ever grow and are masked on access.
+template <typename T, size_t N>
+struct SpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+    // Producer side. Returns false (and drops nothing) when the ring is full.
+    bool push(const T &item)
+    {
+        const size_t back = tail.load(std::memory_order_relaxed);
+        if (back - head.load(std::memory_order_acquire) == N)
+            return false;
+        items[back & (N - 1)] = item;
+        tail.store(back + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side: copies the oldest item without removing it.
+    bool peek(T &item) const
+    {
+        const size_t front = head.load(std::memory_order_relaxed);
+        if (front == tail.load(std::memory_order_acquire))
+            return false;
+        item = items[front & (N - 1)];
+        return true;
+    }
+
+    // Consumer side: removes the item peek returned.
+    void pop() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  private:
+    T items[N];
+    // Each index on its own cache line so the two threads don't fight over one line.
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
@@ -0,0 +1,625 @@
+#include "survival_solver.hpp"
+
+#include "animatronic.hpp"
+#include "game_state.hpp"
+#include "room_graph.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+constexpr int SECONDS_PER_NIGHT = 6 * SECONDS_PER_HOUR;
+
+// A second drains 60 accumulator units per unit of drain, so the accumulator is always a
+// whole number of these steps.
+constexpr int BATTERY_STEPS = BATTERY_UNIT / TICKS_PER_SECOND;
+static_assert(BATTERY_UNIT % TICKS_PER_SECOND == 0, "battery steps must divide a unit");
+
+constexpr int DOOR_CHOICES = 4; // bit 0 left closed, bit 1 right closed
+
+// Long cooldowns and retreat counts multiply the states; beyond these the solve would take
+// minutes or more memory than a desktop has. The built-in tuning needs about 2M states a
+// second and 70 MB.
+constexpr double MAX_STATES_PER_SECOND = 16e6;
+constexpr double MAX_SOLVER_BYTES = 1024.0 * 1024 * 1024;
+
+// Cooldowns are always set at a decision, so one set to C ticks skips the next
+// ceil(C / 60) - 1 decisions.
+int cooldownDecisions(int cooldownTicks)
+{
+    return std::max(0, (cooldownTicks + DECISION_TICKS - 1) / DECISION_TICKS - 1);
+}
+
+// One animatronic as the solver sees it at the start of a second.
+struct LocalState
+{
+    int room;
+    int cooldown; // decisions still skipped
+    int blocked;  // blockedTimer; only non-zero at the door
+};
+
+// Where one decision can take an animatronic: one or two outcomes.
+struct Move
+{
+    int32_t to[2];
+    double chance[2];
+};
+
+// Every state one animatronic can be in. Blocked timers only exist at its door room.
+struct LocalSpace
+{
+    int rooms = 0;
+    int doorRoom = 0;
+    int officeRoom = 0;
+    int cooldownStates = 0; // 0 .. longest cooldown's skipped decisions
+    int blockedStates = 0;  // retreat is certain once blockedTimer reaches this
+    std::vector<LocalState> states;
+
+    void build(const AnimatronicRoute &route, int roomCount, const Tuning &tuning)
+    {
+        rooms = roomCount;
+        doorRoom = route.doorRoom;
+        officeRoom = route.officeRoom;
+        cooldownStates =
+            1 + cooldownDecisions(std::max({tuning.retreatCooldownTicks, tuning.cooldownTicksCalm,
+                                            tuning.cooldownTicksFull}));
+        blockedStates = std::max(tuning.retreatDecisionsCalm, tuning.retreatDecisionsFull);
+
+        states.clear();
+        for (int room = 1; room <= rooms; ++room)
+            for (int cooldown = 0; cooldown < cooldownStates; ++cooldown)
+                states.push_back({room, cooldown, 0});
+        for (int blocked = 1; blocked < blockedStates; ++blocked)
+            for (int cooldown = 0; cooldown < cooldownStates; ++cooldown)
+                states.push_back({doorRoom, cooldown, blocked});
+    }
+
+    int index(int room, int cooldown, int blocked) const
+    {
+        if (blocked == 0)
+            return (room - 1) * cooldownStates + cooldown;
+        return (rooms + blocked - 1) * cooldownStates + cooldown;
+    }
+
+    int size() const { return static_cast<int>(states.size()); }
+};
+
+// Aggro at each second's decision. It only depends on the clock, so it is the same in every
+// state; this replays the clock tick by tick so rounding matches the game exactly.
+template <typename AI>
+std::vector<int> aggroAtDecisions()
+{
+    std::vector<int> aggro(SECONDS_PER_NIGHT);
+    GameState clock = newGame();
+    int value = 0;
+    for (int tick = 0; tick < SECONDS_PER_NIGHT * TICKS_PER_SECOND; ++tick)
+    {
+        advanceClock(clock);
+        value = std::min(value + AI::aggroRate(clock), AGGRO_ONE);
+        if (tick % DECISION_TICKS == DECISION_TICKS - 1)
+            aggro[tick / DECISION_TICKS] = value;
+    }
+    return aggro;
+}
+
+// AI::decide as a distribution: what each state becomes after one decision with its door
+// open or closed. Moves go through the Animatronic's own advance and retreat.
+template <typename AI>
+void buildMoves(const LocalSpace &space, int aggro, bool closed, std::vector<Move> &moves)
+{
+    moves.resize(space.states.size());
+    for (int i = 0; i < space.size(); ++i)
+    {
+        const LocalState &state = space.states[i];
+        GameState game{};
+        game.*AI::spec.position = state.room;
+        (AI::spec.door == DoorSide::Left ? game.leftDoor : game.rightDoor) = closed;
+
+        const int nextCooldown = std::max(state.cooldown - 1, 0);
+        Move &move = moves[i];
+        move.chance[0] = 1.0;
+        move.chance[1] = 0.0;
+        move.to[1] = 0;
+
+        if (AI::atDoor(game) && AI::isBlocked(game))
+        {
+            const int blocked = state.blocked + 1;
+            if (blocked * AGGRO_ONE >= retreatThreshold(aggro))
+            {
+                AI::retreat(game);
+                move.to[0] = space.index(AI::position(game),
+                                         cooldownDecisions(activeTuning().retreatCooldownTicks), 0);
+            }
+            else
+                move.to[0] = space.index(state.room, nextCooldown, blocked);
+            continue;
+        }
+
+        if (state.cooldown > 0)
+        {
+            move.to[0] = space.index(state.room, nextCooldown, 0);
+            continue;
+        }
+
+        AI::advance(game);
+        move.to[0] = space.index(AI::position(game), cooldownDecisions(cooldownTicks(aggro)), 0);
+        move.chance[0] = advanceChance(aggro) / 4294967296.0;
+        move.to[1] = space.index(state.room, 0, 0);
+        move.chance[1] = 1.0 - move.chance[0];
+    }
+}
+
+// Battery state (battery - 1) * BATTERY_STEPS + accumulator steps, for battery 1..newGame().
+struct BatteryTable
+{
+    int states = 0;
+    // next[hourChange][closedDoors][state]: the state a second later, or -1 once it is flat.
+    std::vector<int32_t> next[2][3];
+    // diesEarly[closedDoors][state]: flat before the second's last tick (where the hour
+    // changes), so the night ends in the hour the second started in.
+    std::vector<uint8_t> diesEarly[3];
+
+    void build(int fullBattery, const Tuning &tuning)
+    {
+        states = fullBattery * BATTERY_STEPS;
+        for (int hourChange = 0; hourChange < 2; ++hourChange)
+        {
+            for (int closed = 0; closed < 3; ++closed)
+            {
+                const int drain = tuning.baseDrainPerTick + closed * tuning.doorDrainPerTick;
+                std::vector<int32_t> &table = next[hourChange][closed];
+                table.resize(states);
+                for (int state = 0; state < states; ++state)
+                {
+                    const int accumulator =
+                        (state % BATTERY_STEPS) * TICKS_PER_SECOND + drain * TICKS_PER_SECOND;
+                    const int battery =
+                        state / BATTERY_STEPS + 1 - accumulator / BATTERY_UNIT - hourChange;
+                    table[state] = battery <= 0 ? -1
+                                                : (battery - 1) * BATTERY_STEPS +
+                                                      accumulator % BATTERY_UNIT / TICKS_PER_SECOND;
+                }
+
+                std::vector<uint8_t> &early = diesEarly[closed];
+                early.resize(states);
+                for (int state = 0; state < states; ++state)
+                {
+                    const int accumulator = (state % BATTERY_STEPS) * TICKS_PER_SECOND +
+                                            drain * (TICKS_PER_SECOND - 1);
+                    early[state] = state / BATTERY_STEPS + 1 - accumulator / BATTERY_UNIT <= 0;
+                }
+            }
+        }
+    }
+
+    int index(int battery, int accumulator) const
+    {
+        return (battery - 1) * BATTERY_STEPS + accumulator / TICKS_PER_SECOND;
+    }
+};
+
+// Chance that nextFloat() < chance, which is what the random policy rolls.
+double toggleProbability(float chance)
+{
+    const double steps = std::ceil(static_cast<double>(chance) * 16777216.0);
+    return std::min(std::max(steps, 0.0), 16777216.0) / 16777216.0;
+}
+
+struct Solver
+{
+    const SolveOptions &options;
+    LocalSpace freddo, chico;
+    BatteryTable battery;
+    std::vector<int> freddoAggro, chicoAggro;
+    std::vector<int32_t> freddoDistance, chicoDistance;
+
+    // Random carries the doors from second to second; every other policy picks them afresh.
+    int doorStates = 1;
+    double doorChange[DOOR_CHOICES][DOOR_CHOICES] = {};
+
+    // This second's decisions: moves[doorClosed][local state].
+    std::vector<Move> freddoMoves[2], chicoMoves[2];
+
+    // Survival from the start of second e (value) and from the start of e + 1 (later), indexed
+    // [doors][freddo][chico][battery].
+    std::vector<double> value, later;
+    // Optimal only: the doors chosen at [second][freddo][chico][battery].
+    std::vector<uint8_t> choice;
+
+    explicit Solver(const SolveOptions &solveOptions) : options(solveOptions) {}
+
+    size_t stateIndex(int doors, int f, int c, int b) const
+    {
+        return ((static_cast<size_t>(doors) * freddo.size() + f) * chico.size() + c) *
+                   battery.states +
+               b;
+    }
+
+    size_t statesPerSecond() const
+    {
+        return static_cast<size_t>(doorStates) * freddo.size() * chico.size() * battery.states;
+    }
+
+    bool gotIn(int f, int c, int doors) const
+    {
+        return (freddo.states[f].room == freddo.officeRoom && !(doors & 1)) ||
+               (chico.states[c].room == chico.officeRoom && !(doors & 2));
+    }
+
+    int scriptedDoors(int f, int c) const
+    {
+        return (freddoDistance[freddo.states[f].room] <= 1 ? 1 : 0) |
+               (chicoDistance[chico.states[c].room] <= 1 ? 2 : 0);
+    }
+
+    // False, with a reason, if the night has too many states to solve. Counted in doubles, as
+    // the product can overflow.
+    bool fits(std::string &error) const
+    {
+        const double states = static_cast<double>(doorStates) * freddo.size() * chico.size() *
+                              battery.states;
+        const double bytes =
+            states * 2 * sizeof(double) +
+            (options.optimal ? states * SECONDS_PER_NIGHT * sizeof(uint8_t) : 0.0);
+        if (states <= MAX_STATES_PER_SECOND && bytes <= MAX_SOLVER_BYTES)
+            return true;
+        char why[160];
+        std::snprintf(why, sizeof why,
+                      "the tuning needs %.3g states a second and %.0f MB to solve (at most %.3g "
+                      "and %.0f MB); shorten the cooldowns or retreats",
+                      states, bytes / (1024 * 1024), MAX_STATES_PER_SECOND,
+                      MAX_SOLVER_BYTES / (1024 * 1024));
+        error = why;
+        return false;
+    }
+
+    bool setup(std::string &error)
+    {
+        const RoomGraph &graph = activeRoomGraph();
+        const Tuning &tuning = activeTuning();
+        freddo.build(graph.routes[FREDDO_ROUTE], graph.roomCount, tuning);
+        chico.build(graph.routes[CHICO_ROUTE], graph.roomCount, tuning);
+        freddoDistance = graph.routes[FREDDO_ROUTE].distance;
+        chicoDistance = graph.routes[CHICO_ROUTE].distance;
+        battery.build(newGame().battery, tuning);
+        freddoAggro = aggroAtDecisions<Freddo>();
+        chicoAggro = aggroAtDecisions<Chico>();
+
+        if (!options.optimal && options.policy.kind == DoorPolicyKind::Random)
+        {
+            doorStates = DOOR_CHOICES;
+            const double flip = toggleProbability(options.policy.toggleChance);
+            for (int from = 0; from < DOOR_CHOICES; ++from)
+            {
+                for (int to = 0; to < DOOR_CHOICES; ++to)
+                {
+                    double chance = 1.0;
+                    for (int bit = 1; bit <= 2; bit <<= 1)
+                        chance *= (from & bit) != (to & bit) ? flip : 1.0 - flip;
+                    doorChange[from][to] = chance;
+                }
+            }
+        }
+
+        if (!fits(error))
+            return false;
+        value.assign(statesPerSecond(), 0.0);
+        later.assign(statesPerSecond(), 0.0);
+        if (options.optimal)
+            choice.assign(SECONDS_PER_NIGHT * freddo.size() * chico.size() * battery.states, 0);
+        return true;
+    }
+
+    // Survival of every battery state once `doors` are set for second `second`, with Freddo
+    // and Chico in f and c. Reads `later`.
+    void survivalWithDoors(int second, int doors, int f, int c, double *out) const
+    {
+        if (gotIn(f, c, doors))
+        {
+            std::fill(out, out + battery.states, 0.0);
+            return;
+        }
+
+        // The (chance, next state) pairs for the two decisions, minus those that end the night.
+        const Move &fm = freddoMoves[doors & 1 ? 1 : 0][f];
+        const Move &cm = chicoMoves[doors & 2 ? 1 : 0][c];
+        const bool lastSecond = second == SECONDS_PER_NIGHT - 1;
+        const int nextDoors = doorStates > 1 ? doors : 0;
+        double weight[4];
+        size_t base[4];
+        int outcomes = 0;
+        for (int i = 0; i < 2; ++i)
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                const double chance = fm.chance[i] * cm.chance[j];
+                if (chance == 0.0 || gotIn(fm.to[i], cm.to[j], doors))
+                    continue;
+                weight[outcomes] = chance;
+                base[outcomes] = stateIndex(nextDoors, fm.to[i], cm.to[j], 0);
+                outcomes++;
+            }
+        }
+
+        const bool hourChange = (second + 1) % SECONDS_PER_HOUR == 0;
+        const int closed = (doors & 1) + (doors >> 1);
+        const int32_t *next = battery.next[hourChange][closed].data();
+        for (int b = 0; b < battery.states; ++b)
+        {
+            const int32_t nb = next[b];
+            double sum = 0.0;
+            if (nb >= 0)
+            {
+                for (int k = 0; k < outcomes; ++k)
+                    sum += weight[k] * (lastSecond ? 1.0 : later[base[k] + nb]);
+            }
+            out[b] = sum;
+        }
+    }
+
+    // Fills `value` for second `second`, for Freddo states [fBegin, fEnd).
+    void solveRange(int second, int fBegin, int fEnd)
+    {
+        std::vector<double> withDoors(static_cast<size_t>(DOOR_CHOICES) * battery.states);
+        const size_t secondBase =
+            static_cast<size_t>(second) * freddo.size() * chico.size() * battery.states;
+
+        for (int f = fBegin; f < fEnd; ++f)
+        {
+            for (int c = 0; c < chico.size(); ++c)
+            {
+                if (options.optimal)
+                {
+                    for (int doors = 0; doors < DOOR_CHOICES; ++doors)
+                        survivalWithDoors(second, doors, f, c,
+                                          &withDoors[doors * battery.states]);
+                    double *out = &value[stateIndex(0, f, c, 0)];
+                    uint8_t *chosen = &choice[secondBase + stateIndex(0, f, c, 0)];
+                    for (int b = 0; b < battery.states; ++b)
+                    {
+                        int best = 0;
+                        for (int doors = 1; doors < DOOR_CHOICES; ++doors)
+                            if (withDoors[doors * battery.states + b] >
+                                withDoors[best * battery.states + b])
+                                best = doors;
+                        out[b] = withDoors[best * battery.states + b];
+                        chosen[b] = static_cast<uint8_t>(best);
+                    }
+                    continue;
+                }
+
+                switch (options.policy.kind)
+                {
+                case DoorPolicyKind::None:
+                    survivalWithDoors(second, 0, f, c, &value[stateIndex(0, f, c, 0)]);
+                    break;
+                case DoorPolicyKind::Scripted:
+                    survivalWithDoors(second, scriptedDoors(f, c), f, c,
+                                      &value[stateIndex(0, f, c, 0)]);
+                    break;
+                case DoorPolicyKind::Random:
+                    for (int doors = 0; doors < DOOR_CHOICES; ++doors)
+                        survivalWithDoors(second, doors, f, c,
+                                          &withDoors[doors * battery.states]);
+                    for (int from = 0; from < DOOR_CHOICES; ++from)
+                    {
+                        double *out = &value[stateIndex(from, f, c, 0)];
+                        for (int b = 0; b < battery.states; ++b)
+                        {
+                            double sum = 0.0;
+                            for (int to = 0; to < DOOR_CHOICES; ++to)
+                                sum += doorChange[from][to] * withDoors[to * battery.states + b];
+                            out[b] = sum;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    // Backwards from the last second. Each second's states only read the next second's, so
+    // the threads split Freddo's states between them and meet once per second.
+    void solve()
+    {
+        const unsigned threads = std::max(1u, options.threads);
+        const Tuning &tuning = activeTuning();
+        for (int second = SECONDS_PER_NIGHT - 1; second >= 0; --second)
+        {
+            buildMoves<Freddo>(freddo, freddoAggro[second], false, freddoMoves[0]);
+            buildMoves<Freddo>(freddo, freddoAggro[second], true, freddoMoves[1]);
+            buildMoves<Chico>(chico, chicoAggro[second], false, chicoMoves[0]);
+            buildMoves<Chico>(chico, chicoAggro[second], true, chicoMoves[1]);
+
+            std::atomic<int> nextF{0};
+            auto worker = [&] {
+                setActiveTuning(tuning);
+                for (;;)
+                {
+                    const int f = nextF.fetch_add(1);
+                    if (f >= freddo.size())
+                        return;
+                    solveRange(second, f, f + 1);
+                }
+            };
+            std::vector<std::thread> pool;
+            for (unsigned t = 1; t < threads; ++t)
+                pool.emplace_back(worker);
+            worker();
+            for (auto &thread : pool)
+                thread.join();
+
+            value.swap(later);
+        }
+        value.swap(later);
+    }
+
+    size_t startIndex() const
+    {
+        const GameState game = newGame();
+        return stateIndex(0, freddo.index(game.freddoPos, 0, 0), chico.index(game.chicoPos, 0, 0),
+                          battery.index(game.battery, 0));
+    }
+
+    int doorsFor(int second, int f, int c, int b) const
+    {
+        if (options.optimal)
+            return choice[static_cast<size_t>(second) * statesPerSecond() + stateIndex(0, f, c, b)];
+        if (options.policy.kind == DoorPolicyKind::Scripted)
+            return scriptedDoors(f, c);
+        return 0;
+    }
+
+    static void endNight(SolveResult &result, Outcome outcome, int hour, double chance)
+    {
+        result.outcomes[static_cast<int>(outcome)] += chance;
+        if (outcome != Outcome::Survived)
+            result.deathsByHour[std::min(hour, 5)] += chance;
+    }
+
+    // One second from state (f, c, b) with `doors` set: adds its chance to the states it leads
+    // to in `reachNext`, or to how the night ended. The checks run in nightOutcome's order.
+    void spread(SolveResult &result, std::vector<double> &reachNext, int second, int doors,
+                int f, int c, int b, double chance) const
+    {
+        // Doors only change on a second's first tick and rooms on its last, so a night that ends
+        // before the decisions ends in the hour the second started in.
+        const int startHour = second / SECONDS_PER_HOUR;
+        const int endHour = (second + 1) / SECONDS_PER_HOUR;
+        if (freddo.states[f].room == freddo.officeRoom && !(doors & 1))
+            return endNight(result, Outcome::FreddoGotIn, startHour, chance);
+        if (chico.states[c].room == chico.officeRoom && !(doors & 2))
+            return endNight(result, Outcome::ChicoGotIn, startHour, chance);
+
+        const bool hourChange = (second + 1) % SECONDS_PER_HOUR == 0;
+        const int closed = (doors & 1) + (doors >> 1);
+        const int32_t nb = battery.next[hourChange][closed][b];
+        if (nb < 0)
+            return endNight(result, Outcome::BatteryDied,
+                            battery.diesEarly[closed][b] ? startHour : endHour, chance);
+
+        const Move &fm = freddoMoves[doors & 1][f];
+        const Move &cm = chicoMoves[doors >> 1][c];
+        const int nextDoors = doorStates > 1 ? doors : 0;
+        for (int i = 0; i < 2; ++i)
+        {
+            for (int j = 0; j < 2; ++j)
+            {
+                const double p = chance * fm.chance[i] * cm.chance[j];
+                if (p == 0.0)
+                    continue;
+                if (freddo.states[fm.to[i]].room == freddo.officeRoom && !(doors & 1))
+                    endNight(result, Outcome::FreddoGotIn, endHour, p);
+                else if (chico.states[cm.to[j]].room == chico.officeRoom && !(doors & 2))
+                    endNight(result, Outcome::ChicoGotIn, endHour, p);
+                else if (second == SECONDS_PER_NIGHT - 1)
+                    endNight(result, Outcome::Survived, endHour, p);
+                else
+                    reachNext[stateIndex(nextDoors, fm.to[i], cm.to[j], nb)] += p;
+            }
+        }
+    }
+
+    // Plays the policy forwards from the start of the night, spreading each state's chance over
+    // the states it leads to, and adds up how nights end. With `file` (optimal only), also
+    // writes the doors chosen for every state reached with at least minProbability.
+    void playForward(SolveResult &result, std::FILE *file, double minProbability)
+    {
+        const size_t perSecond = statesPerSecond();
+        std::vector<double> reach(perSecond, 0.0), reachNext(perSecond, 0.0);
+        reach[startIndex()] = 1.0;
+
+        for (int second = 0; second < SECONDS_PER_NIGHT; ++second)
+        {
+            buildMoves<Freddo>(freddo, freddoAggro[second], false, freddoMoves[0]);
+            buildMoves<Freddo>(freddo, freddoAggro[second], true, freddoMoves[1]);
+            buildMoves<Chico>(chico, chicoAggro[second], false, chicoMoves[0]);
+            buildMoves<Chico>(chico, chicoAggro[second], true, chicoMoves[1]);
+            std::fill(reachNext.begin(), reachNext.end(), 0.0);
+
+            for (int from = 0; from < doorStates; ++from)
+            {
+                for (int f = 0; f < freddo.size(); ++f)
+                {
+                    for (int c = 0; c < chico.size(); ++c)
+                    {
+                        for (int b = 0; b < battery.states; ++b)
+                        {
+                            const double chance = reach[stateIndex(from, f, c, b)];
+                            if (chance == 0.0)
+                                continue;
+
+                            if (doorStates > 1)
+                            {
+                                for (int to = 0; to < DOOR_CHOICES; ++to)
+                                    spread(result, reachNext, second, to, f, c, b,
+                                           chance * doorChange[from][to]);
+                                continue;
+                            }
+
+                            const int doors = doorsFor(second, f, c, b);
+                            if (file && chance >= minProbability)
+                            {
+                                writePolicyRow(file, second, f, c, b, doors, chance);
+                                result.policyRows++;
+                            }
+                            spread(result, reachNext, second, doors, f, c, b, chance);
+                        }
+                    }
+                }
+            }
+            reach.swap(reachNext);
+        }
+    }
+
+    void writePolicyRow(std::FILE *file, int second, int f, int c, int b, int doors,
+                        double chance) const
+    {
+        const LocalState &fs = freddo.states[f];
+        const LocalState &cs = chico.states[c];
+        // The accumulator holds charge already used from the current unit.
+        const double charge =
+            b / BATTERY_STEPS + 1 - static_cast<double>(b % BATTERY_STEPS) / BATTERY_STEPS;
+        std::fprintf(file, "%d,%d,%d,%d,%d,%d,%d,%.2f,%d,%d,%.6g\n", second, fs.room, fs.cooldown,
+                     fs.blocked, cs.room, cs.cooldown, cs.blocked, charge, doors & 1, doors >> 1,
+                     chance);
+    }
+};
+
+} // namespace
+
+bool solveSurvival(const SolveOptions &options, SolveResult &result, std::string &error)
+{
+    Solver solver(options);
+    if (!solver.setup(error))
+        return false;
+    solver.solve();
+
+    result = SolveResult{};
+    result.survival = solver.value[solver.startIndex()];
+    result.statesPerSecond = solver.statesPerSecond();
+
+    std::FILE *file = nullptr;
+    if (options.optimal && options.policyPath)
+    {
+        file = std::fopen(options.policyPath, "w");
+        if (!file)
+            result.policyWritten = false;
+        else
+            std::fprintf(file, "second,freddo_room,freddo_cooldown,freddo_blocked,chico_room,"
+                               "chico_cooldown,chico_blocked,battery,left_door,right_door,"
+                               "reach_probability\n");
+    }
+    solver.playForward(result, file, options.policyMinProbability);
+    if (file && std::fclose(file) != 0)
+        result.policyWritten = false;
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "door_policy.hpp"
+#include "game_state.hpp"
+
+#include <cstddef>
+#include <string>
+
+// Exact survival odds by dynamic programming instead of sampling.
+//
+// Between AI decisions nothing random happens, and policies only touch the doors at the start
+// of a second, so a night is a Markov chain with one step per second. Aggro only depends on the
+// clock, a cooldown only matters as the number of decisions it still skips (0..2 by default), a
+// blocked timer is only non-zero at the door (0..4) and the battery moves in quarter units. That
+// leaves a few hundred thousand states per second on the built-in map, solved backwards from
+// 6 AM with each second's transition tables built once and shared by every state.
+struct SolveOptions
+{
+    DoorPolicy policy;
+    bool optimal = false; // choose the best doors every second instead of following `policy`
+    unsigned threads = 1;
+
+    // Optimal only: where to write the chosen doors for every state the night reaches with at
+    // least `policyMinProbability`.
+    const char *policyPath = nullptr;
+    double policyMinProbability = 1e-4;
+};
+
+struct SolveResult
+{
+    double survival = 0.0;      // chance of reaching 6 AM from the start of the night
+    size_t statesPerSecond = 0; // states solved for each second of the night
+
+    // Chance of each Outcome and of dying in each hour, as the simulator counts them.
+    double outcomes[5] = {};
+    double deathsByHour[6] = {};
+
+    size_t policyRows = 0;     // rows written to policyPath
+    bool policyWritten = true; // false if policyPath couldn't be written
+};
+
+// Solves the night on the active map and tuning. False, with a reason, if the tuning makes the
+// night too big to solve.
+bool solveSurvival(const SolveOptions &options, SolveResult &result, std::string &error);
@@ -0,0 +1,381 @@
+// Difficulty sweep: plays headless nights over a grid of tuning values and reports the survival
+// rate at every grid point, as CSV and as a heatmap. Grid points stop early once their survival
+// rate is known to the requested precision.
+
+#include "door_policy.hpp"
+#include "event_sim.hpp"
+#include "game_state.hpp"
+#include "option_parse.hpp"
+#include "room_graph.hpp"
+#include "simulation.hpp"
+#include "tuning.hpp"
+#include "work_stealing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Nights per task: big enough to amortize scheduling, small enough to stop soon after
+// converging.
+constexpr uint64_t CHUNK_NIGHTS = 1024;
+// Most values one --vary axis may take, so a tiny step can't ask for an endless grid.
+constexpr double MAX_AXIS_VALUES = 10000;
+
+struct Axis
+{
+    std::string name;
+    std::vector<double> values;
+};
+
+struct SweepOptions
+{
+    std::vector<Axis> axes;
+    Tuning base;
+    DoorPolicy policy;
+    uint64_t seed = 1;
+    unsigned threads = 0;
+    uint64_t minNights = 4 * CHUNK_NIGHTS;
+    uint64_t maxNights = 1000000;
+    double precision = 0.005; // stop once the 95% interval is this narrow on each side
+    const char *csvPath = nullptr;
+    const char *mapPath = nullptr;
+};
+
+struct GridPoint
+{
+    Tuning tuning;
+    std::vector<double> values; // one per axis
+    uint64_t nights = 0;
+    uint64_t outcomes[5] = {};
+
+    double rate(Outcome outcome) const
+    {
+        return nights > 0 ? static_cast<double>(outcomes[static_cast<int>(outcome)]) / nights
+                          : 0.0;
+    }
+
+    // Half-width of the 95% Wilson interval for the survival rate. Unlike the normal
+    // approximation it stays honest at 0% and 100%.
+    double margin() const
+    {
+        constexpr double Z = 1.96;
+        const double n = static_cast<double>(nights);
+        const double p = rate(Outcome::Survived);
+        return Z * std::sqrt(p * (1 - p) / n + Z * Z / (4 * n * n)) / (1 + Z * Z / n);
+    }
+};
+
+struct ChunkTask
+{
+    uint32_t point = 0;
+    uint32_t chunk = 0;
+};
+
+// "name=start:stop:step" or "name=a,b,c".
+static bool parseAxis(const char *text, Axis &axis)
+{
+    const char *equals = std::strchr(text, '=');
+    if (!equals)
+        return false;
+    axis.name.assign(text, equals);
+    Tuning probe;
+    if (!setTuningValue(probe, axis.name.c_str(), 0.0))
+        return false;
+    // Every value must fit the setting; validateTuning checks the grid points it makes.
+    auto settable = [&] {
+        return std::all_of(axis.values.begin(), axis.values.end(), [&](double value) {
+            return setTuningValue(probe, axis.name.c_str(), value);
+        });
+    };
+
+    const char *range = equals + 1;
+    char *end = nullptr;
+    if (std::strchr(range, ':'))
+    {
+        const double start = std::strtod(range, &end);
+        if (*end != ':')
+            return false;
+        const double stop = std::strtod(end + 1, &end);
+        if (*end != ':')
+            return false;
+        const double step = std::strtod(end + 1, &end);
+        if (*end != '\0' || !(step > 0) || stop < start || (stop - start) / step >= MAX_AXIS_VALUES)
+            return false;
+        for (int i = 0; start + i * step <= stop + step * 1e-9; ++i)
+            axis.values.push_back(start + i * step);
+        return settable();
+    }
+
+    for (;;)
+    {
+        axis.values.push_back(std::strtod(range, &end));
+        if (end == range)
+            return false;
+        if (*end == '\0')
+            return settable();
+        if (*end != ',')
+            return false;
+        range = end + 1;
+    }
+}
+
+static bool parseOptions(int argc, char **argv, SweepOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+        if (std::strcmp(arg, "--vary") == 0 && value)
+        {
+            Axis axis;
+            if (!parseAxis(argv[++i], axis))
+                return false;
+            options.axes.push_back(axis);
+        }
+        else if (std::strcmp(arg, "--set") == 0 && value)
+        {
+            if (!parseTuningSetting(argv[++i], options.base))
+                return false;
+        }
+        else if (std::strcmp(arg, "--policy") == 0 && value)
+        {
+            if (!parseDoorPolicy(argv[++i], options.policy.kind))
+                return false;
+        }
+        else if (std::strcmp(arg, "--toggle-chance") == 0 && value)
+        {
+            if (!parseReal(argv[++i], 0.0, 1.0, options.policy.toggleChance))
+                return false;
+        }
+        else if (std::strcmp(arg, "--seed") == 0 && value)
+        {
+            if (!parseCount(argv[++i], options.seed))
+                return false;
+        }
+        else if (std::strcmp(arg, "--threads") == 0 && value)
+        {
+            if (!parseCount(argv[++i], 0u, MAX_THREADS, options.threads))
+                return false;
+        }
+        else if (std::strcmp(arg, "--min-nights") == 0 && value)
+        {
+            if (!parseCount(argv[++i], options.minNights))
+                return false;
+        }
+        else if (std::strcmp(arg, "--max-nights") == 0 && value)
+        {
+            if (!parseCount(argv[++i], options.maxNights))
+                return false;
+        }
+        else if (std::strcmp(arg, "--precision") == 0 && value)
+        {
+            if (!parseReal(argv[++i], 0.0, 1.0, options.precision))
+                return false;
+        }
+        else if (std::strcmp(arg, "--csv") == 0 && value)
+            options.csvPath = argv[++i];
+        else if (std::strcmp(arg, "--map") == 0 && value)
+            options.mapPath = argv[++i];
+        else
+            return false;
+    }
+    return !options.axes.empty() && options.maxNights > 0;
+}
+
+// Every combination of axis values, first axis slowest.
+static std::vector<GridPoint> buildGrid(const SweepOptions &options)
+{
+    std::vector<GridPoint> grid(1);
+    grid[0].tuning = options.base;
+    for (const Axis &axis : options.axes)
+    {
+        std::vector<GridPoint> next;
+        for (const GridPoint &point : grid)
+        {
+            for (double value : axis.values)
+            {
+                GridPoint extended = point;
+                setTuningValue(extended.tuning, axis.name.c_str(), value);
+                extended.values.push_back(value);
+                next.push_back(extended);
+            }
+        }
+        grid.swap(next);
+    }
+    return grid;
+}
+
+// Plays one chunk of a grid point's nights. Night i of every grid point uses the same RNG
+// streams, so neighbouring points differ only by their tuning (common random numbers).
+static void runChunk(const SweepOptions &options, GridPoint &point, uint32_t chunk)
+{
+    setActiveTuning(point.tuning);
+    const uint64_t begin = uint64_t{chunk} * CHUNK_NIGHTS;
+    const uint64_t end = std::min(begin + CHUNK_NIGHTS, options.maxNights);
+    for (uint64_t index = begin; index < end; ++index)
+    {
+        Night night = startNight(options.seed, index);
+        Rng policyRng;
+        policyRng.seed(~options.seed, index);
+        const Outcome outcome = runNightEvents(night, options.policy, policyRng);
+        point.outcomes[static_cast<int>(outcome)]++;
+    }
+    point.nights += end - begin;
+}
+
+static bool converged(const SweepOptions &options, const GridPoint &point)
+{
+    if (point.nights >= options.maxNights)
+        return true;
+    return point.nights >= options.minNights && point.margin() <= options.precision;
+}
+
+static void writeCsv(std::FILE *file, const SweepOptions &options,
+                     const std::vector<GridPoint> &grid)
+{
+    for (const Axis &axis : options.axes)
+        std::fprintf(file, "%s,", axis.name.c_str());
+    std::fprintf(file, "nights,survived,battery_died,freddo_got_in,chico_got_in,margin\n");
+    for (const GridPoint &point : grid)
+    {
+        for (double value : point.values)
+            std::fprintf(file, "%g,", value);
+        std::fprintf(file, "%llu,%.5f,%.5f,%.5f,%.5f,%.5f\n",
+                     static_cast<unsigned long long>(point.nights), point.rate(Outcome::Survived),
+                     point.rate(Outcome::BatteryDied), point.rate(Outcome::FreddoGotIn),
+                     point.rate(Outcome::ChicoGotIn), point.margin());
+    }
+}
+
+// Survival percentages with the first axis down and the second across. Any further axes get
+// one table per combination of their values.
+static void printHeatmap(const SweepOptions &options, const std::vector<GridPoint> &grid)
+{
+    const Axis &rows = options.axes[0];
+    if (options.axes.size() == 1)
+    {
+        std::printf("\n%16s  survived\n", rows.name.c_str());
+        for (const GridPoint &point : grid)
+            std::printf("%16g  %7.2f%%\n", point.values[0], 100.0 * point.rate(Outcome::Survived));
+        return;
+    }
+
+    // Grid order is first axis slowest, so the extra axes are the low digits of the index.
+    const Axis &cols = options.axes[1];
+    const size_t tables = grid.size() / (rows.values.size() * cols.values.size());
+    for (size_t extra = 0; extra < tables; ++extra)
+    {
+        std::printf("\nsurvived %%, %s down, %s across", rows.name.c_str(), cols.name.c_str());
+        for (size_t axis = 2; axis < options.axes.size(); ++axis)
+            std::printf(", %s=%g", options.axes[axis].name.c_str(), grid[extra].values[axis]);
+        std::printf("\n%10s", "");
+        for (double value : cols.values)
+            std::printf(" %7g", value);
+        std::printf("\n");
+        for (size_t r = 0; r < rows.values.size(); ++r)
+        {
+            std::printf("%10g", rows.values[r]);
+            for (size_t c = 0; c < cols.values.size(); ++c)
+            {
+                const GridPoint &point = grid[(r * cols.values.size() + c) * tables + extra];
+                std::printf(" %7.2f", 100.0 * point.rate(Outcome::Survived));
+            }
+            std::printf("\n");
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    SweepOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr,
+                     "Usage: %s --vary NAME=START:STOP:STEP|NAME=A,B,C [--vary ...]\n"
+                     "          [--set NAME=VALUE]... [--policy none|scripted|random]\n"
+                     "          [--toggle-chance P] [--seed N] [--threads N] [--min-nights N]\n"
+                     "          [--max-nights N] [--precision P] [--csv FILE] [--map FILE]\n"
+                     "Tunable values:",
+                     argv[0]);
+        for (int i = 0; i < TUNING_VALUE_COUNT; ++i)
+            std::fprintf(stderr, " %s", tuningName(i));
+        std::fprintf(stderr, "\n");
+        return 2;
+    }
+
+    if (options.mapPath)
+    {
+        RoomGraph graph;
+        std::string error;
+        if (!loadRoomGraph(options.mapPath, graph, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.mapPath, error.c_str());
+            return 2;
+        }
+        setActiveRoomGraph(graph);
+    }
+
+    std::vector<GridPoint> grid = buildGrid(options);
+    for (const GridPoint &point : grid)
+    {
+        std::string error;
+        if (!validateTuning(point.tuning, error))
+        {
+            std::fprintf(stderr, "Grid point %zu: %s\n", &point - grid.data(), error.c_str());
+            return 2;
+        }
+    }
+
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Each grid point has one chunk in flight at a time and queues its next chunk only if it
+    // hasn't converged, so results don't depend on the thread count or on scheduling.
+    WorkStealingPool<ChunkTask> pool(threads);
+    for (size_t i = 0; i < grid.size(); ++i)
+        pool.push(static_cast<unsigned>(i % pool.workers()), {static_cast<uint32_t>(i), 0});
+
+    const auto start = std::chrono::steady_clock::now();
+    pool.run([&](const ChunkTask &task, unsigned worker) {
+        GridPoint &point = grid[task.point];
+        runChunk(options, point, task.chunk);
+        if (!converged(options, point))
+            pool.push(worker, {task.point, task.chunk + 1});
+    });
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    uint64_t nights = 0;
+    for (const GridPoint &point : grid)
+        nights += point.nights;
+    const double budget = static_cast<double>(options.maxNights) * grid.size();
+
+    std::printf("Swept %zu grid points (policy %s) on %u threads in %.2f s\n", grid.size(),
+                doorPolicyName(options.policy.kind), threads, elapsed.count());
+    std::printf("  nights played  %12llu (%.1f%% of the --max-nights budget)\n",
+                static_cast<unsigned long long>(nights), 100.0 * nights / budget);
+    std::printf("  nights/sec     %12.0f\n", elapsed.count() > 0 ? nights / elapsed.count() : 0.0);
+    std::printf("  tasks stolen   %12llu\n", static_cast<unsigned long long>(pool.steals()));
+    printHeatmap(options, grid);
+
+    if (options.csvPath)
+    {
+        std::FILE *file = std::fopen(options.csvPath, "w");
+        if (!file)
+        {
+            std::fprintf(stderr, "%s: can't write\n", options.csvPath);
+            return 1;
+        }
+        writeCsv(file, options, grid);
+        std::fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,368 @@
+#include "telemetry.hpp"
+
+#include "room_graph.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TELEMETRY_MMAP 1
+#endif
+
+constexpr char TELEMETRY_MAGIC[4] = {'S', '2', 'S', 'T'};
+constexpr uint16_t TELEMETRY_VERSION = 1;
+
+static void pointAtColumns(TelemetryWriter &writer)
+{
+    uint8_t *block = writer.block;
+    writer.header = reinterpret_cast<TelemetryBlockHeader *>(block);
+    writer.nights = reinterpret_cast<uint32_t *>(block + TelemetryLayout::night);
+    writer.ticks = reinterpret_cast<uint16_t *>(block + TelemetryLayout::tick);
+    writer.values = reinterpret_cast<int16_t *>(block + TelemetryLayout::value);
+    writer.kinds = block + TelemetryLayout::kind;
+    writer.subjects = block + TelemetryLayout::subject;
+}
+
+static void startBlock(TelemetryWriter &writer)
+{
+    TelemetryBlockHeader &header = *reinterpret_cast<TelemetryBlockHeader *>(writer.block);
+    std::memcpy(header.magic, TELEMETRY_MAGIC, sizeof header.magic);
+    header.version = TELEMETRY_VERSION;
+    header.headerBytes = sizeof header;
+    header.capacity = TELEMETRY_BLOCK_EVENTS;
+    header.count = 0;
+    header.unused = 0;
+    pointAtColumns(writer);
+    writer.count = 0;
+}
+
+static bool validBlock(const TelemetryBlockHeader &header)
+{
+    return std::memcmp(header.magic, TELEMETRY_MAGIC, sizeof header.magic) == 0 &&
+           header.version == TELEMETRY_VERSION && header.headerBytes == sizeof header &&
+           header.capacity == TELEMETRY_BLOCK_EVENTS && header.count <= header.capacity;
+}
+
+// Picks up after the last block of an existing log: its night numbers carry on, and a block
+// with room left is filled before a new one is added.
+static bool resume(TelemetryWriter &writer, std::string &error)
+{
+    if (!validBlock(*writer.header))
+    {
+        error = "not a telemetry log from this version";
+        return false;
+    }
+    pointAtColumns(writer);
+    writer.count = writer.header->count;
+    writer.nextNight = writer.count > 0 ? writer.nights[writer.count - 1] + 1 : 0;
+    writer.night = writer.nextNight;
+    if (writer.count == TELEMETRY_BLOCK_EVENTS)
+        nextTelemetryBlock(writer);
+    return true;
+}
+
+#ifdef TELEMETRY_MMAP
+
+// Where events go once a new block can't be added.
+alignas(8) static uint8_t discardBlock[TelemetryLayout::blockBytes];
+
+// Grows the file to `end`. The space is allocated up front where the platform can, so a full
+// disk fails here rather than as SIGBUS on the first store into the mapped block; ftruncate
+// alone would only make a sparse file.
+static bool growFile(int fd, off_t offset, off_t end)
+{
+#ifdef __linux__
+    const int result = posix_fallocate(fd, offset, end - offset);
+    if (result == 0)
+        return true;
+    if (result != EINVAL && result != EOPNOTSUPP)
+    {
+        // Leave the file whole blocks long, as openTelemetry expects.
+        [[maybe_unused]] const int truncated = ftruncate(fd, offset);
+        errno = result;
+        return false;
+    }
+    // The file system can't preallocate.
+#else
+    (void)offset;
+#endif
+    return ftruncate(fd, end) == 0;
+}
+
+// Maps block `index`, growing the file to hold it first if `fresh`.
+static bool mapBlock(TelemetryWriter &writer, uint64_t index, bool fresh)
+{
+    const off_t offset = static_cast<off_t>(index * TelemetryLayout::blockBytes);
+    const off_t end = offset + static_cast<off_t>(TelemetryLayout::blockBytes);
+    if (fresh && !growFile(writer.fd, offset, end))
+        return false;
+    void *map = mmap(nullptr, TelemetryLayout::blockBytes, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     writer.fd, offset);
+    if (map == MAP_FAILED)
+        return false;
+    writer.block = static_cast<uint8_t *>(map);
+    writer.blockIndex = index;
+    if (fresh)
+        startBlock(writer);
+    else
+        pointAtColumns(writer);
+    return true;
+}
+
+bool openTelemetry(TelemetryWriter &writer, const char *path, std::string &error)
+{
+    writer.fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat info;
+    if (writer.fd < 0 || fstat(writer.fd, &info) != 0)
+    {
+        error = std::strerror(errno);
+        return false;
+    }
+    const uint64_t size = static_cast<uint64_t>(info.st_size);
+    if (size % TelemetryLayout::blockBytes != 0)
+    {
+        error = "not a telemetry log from this version";
+        closeTelemetry(writer);
+        return false;
+    }
+
+    const bool empty = size == 0;
+    if (!mapBlock(writer, empty ? 0 : size / TelemetryLayout::blockBytes - 1, empty))
+    {
+        error = std::strerror(errno);
+        closeTelemetry(writer);
+        return false;
+    }
+    if (!empty && !resume(writer, error))
+    {
+        closeTelemetry(writer);
+        return false;
+    }
+    return true;
+}
+
+void nextTelemetryBlock(TelemetryWriter &writer)
+{
+    munmap(writer.block, TelemetryLayout::blockBytes);
+    writer.block = nullptr;
+    if (!mapBlock(writer, writer.blockIndex + 1, true))
+    {
+        // Out of disk or address space: keep the night going and stop recording it.
+        writer.block = discardBlock;
+        startBlock(writer);
+    }
+}
+
+void closeTelemetry(TelemetryWriter &writer)
+{
+    if (writer.block && writer.block != discardBlock)
+        munmap(writer.block, TelemetryLayout::blockBytes);
+    if (writer.fd >= 0)
+        close(writer.fd);
+    writer.block = nullptr;
+    writer.fd = -1;
+}
+
+#else
+
+static void writeBlock(TelemetryWriter &writer)
+{
+    std::fseek(writer.file, static_cast<long>(writer.blockIndex * TelemetryLayout::blockBytes),
+               SEEK_SET);
+    std::fwrite(writer.block, 1, TelemetryLayout::blockBytes, writer.file);
+    std::fflush(writer.file);
+}
+
+bool openTelemetry(TelemetryWriter &writer, const char *path, std::string &error)
+{
+    writer.file = std::fopen(path, "r+b");
+    if (!writer.file)
+        writer.file = std::fopen(path, "w+b");
+    if (!writer.file)
+    {
+        error = std::strerror(errno);
+        return false;
+    }
+    std::fseek(writer.file, 0, SEEK_END);
+    const uint64_t size = static_cast<uint64_t>(std::ftell(writer.file));
+    if (size % TelemetryLayout::blockBytes != 0)
+    {
+        error = "not a telemetry log from this version";
+        closeTelemetry(writer);
+        return false;
+    }
+
+    writer.block = new uint8_t[TelemetryLayout::blockBytes]();
+    if (size == 0)
+    {
+        writer.blockIndex = 0;
+        startBlock(writer);
+        return true;
+    }
+    writer.blockIndex = size / TelemetryLayout::blockBytes - 1;
+    std::fseek(writer.file, static_cast<long>(writer.blockIndex * TelemetryLayout::blockBytes),
+               SEEK_SET);
+    if (std::fread(writer.block, 1, TelemetryLayout::blockBytes, writer.file) !=
+            TelemetryLayout::blockBytes ||
+        !resume(writer, error))
+    {
+        if (error.empty())
+            error = "truncated";
+        closeTelemetry(writer);
+        return false;
+    }
+    return true;
+}
+
+void nextTelemetryBlock(TelemetryWriter &writer)
+{
+    writeBlock(writer);
+    writer.blockIndex++;
+    startBlock(writer);
+}
+
+void closeTelemetry(TelemetryWriter &writer)
+{
+    if (writer.file && writer.block)
+        writeBlock(writer);
+    if (writer.file)
+        std::fclose(writer.file);
+    delete[] writer.block;
+    writer.block = nullptr;
+    writer.file = nullptr;
+}
+
+#endif
+
+void logNightStart(TelemetryWriter &writer, uint64_t seed)
+{
+    writer.night = writer.nextNight++;
+    logEvent(writer, 0, TelemetryKind::NightStart, 0, static_cast<int>(seed & 0xffff));
+}
+
+static void logMove(TelemetryWriter &writer, int tick, int subject, int from, int to)
+{
+    if (from == to)
+        return;
+    const std::vector<int32_t> &distance = activeRoomGraph().routes[subject].distance;
+    const TelemetryKind kind =
+        distance[to] > distance[from] ? TelemetryKind::Retreat : TelemetryKind::Move;
+    logEvent(writer, tick, kind, subject, to);
+}
+
+void logNightChanges(TelemetryWriter &writer, const NightObservation &before, const Night &night)
+{
+    const GameState &game = night.game;
+    const int tick = night.tick;
+    if (game.leftDoor != before.leftDoor)
+        logEvent(writer, tick, TelemetryKind::Door, 0, game.leftDoor);
+    if (game.rightDoor != before.rightDoor)
+        logEvent(writer, tick, TelemetryKind::Door, 1, game.rightDoor);
+    logMove(writer, tick, FREDDO_ROUTE, before.freddoPos, game.freddoPos);
+    logMove(writer, tick, CHICO_ROUTE, before.chicoPos, game.chicoPos);
+    if (game.battery != before.battery)
+        logEvent(writer, tick, TelemetryKind::Battery, 0, game.battery);
+
+    const Outcome outcome = nightOutcome(game);
+    if (outcome != Outcome::Running)
+        logEvent(writer, tick, TelemetryKind::NightEnd,
+                 outcome == Outcome::ChicoGotIn ? CHICO_ROUTE : FREDDO_ROUTE,
+                 static_cast<int>(outcome));
+}
+
+void logNightQuit(TelemetryWriter &writer, const Night &night)
+{
+    logEvent(writer, night.tick, TelemetryKind::NightEnd, 0, static_cast<int>(Outcome::Running));
+}
+
+static bool checkBlocks(TelemetryFile &file, std::string &error)
+{
+    file.blocks = file.bytes / TelemetryLayout::blockBytes;
+    bool valid = file.bytes % TelemetryLayout::blockBytes == 0;
+    for (size_t i = 0; valid && i < file.blocks; ++i)
+    {
+        TelemetryBlockHeader header;
+        std::memcpy(&header, file.data + i * TelemetryLayout::blockBytes, sizeof header);
+        valid = validBlock(header);
+    }
+    if (!valid)
+        error = "not a telemetry log from this version";
+    return valid;
+}
+
+bool mapTelemetry(const char *path, TelemetryFile &file, std::string &error)
+{
+#ifdef TELEMETRY_MMAP
+    const int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        error = std::strerror(errno);
+        if (fd >= 0)
+            close(fd);
+        return false;
+    }
+    file.bytes = static_cast<size_t>(info.st_size);
+    void *map = file.bytes > 0 ? mmap(nullptr, file.bytes, PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        error = std::strerror(errno);
+        return false;
+    }
+    file.data = static_cast<const uint8_t *>(map);
+#else
+    std::FILE *in = std::fopen(path, "rb");
+    if (!in)
+    {
+        error = std::strerror(errno);
+        return false;
+    }
+    std::fseek(in, 0, SEEK_END);
+    file.copy.resize(static_cast<size_t>(std::ftell(in)));
+    std::fseek(in, 0, SEEK_SET);
+    const bool read = std::fread(file.copy.data(), 1, file.copy.size(), in) == file.copy.size();
+    std::fclose(in);
+    if (!read)
+    {
+        error = "can't read the file";
+        return false;
+    }
+    file.data = file.copy.data();
+    file.bytes = file.copy.size();
+#endif
+    if (checkBlocks(file, error))
+        return true;
+    unmapTelemetry(file);
+    return false;
+}
+
+void unmapTelemetry(TelemetryFile &file)
+{
+#ifdef TELEMETRY_MMAP
+    if (file.data)
+        munmap(const_cast<uint8_t *>(file.data), file.bytes);
+#endif
+    file.copy.clear();
+    file.data = nullptr;
+    file.bytes = 0;
+    file.blocks = 0;
+}
+
+TelemetryBlock telemetryBlock(const TelemetryFile &file, size_t index)
+{
+    const uint8_t *block = file.data + index * TelemetryLayout::blockBytes;
+    TelemetryBlock view;
+    std::memcpy(&view.count, block + offsetof(TelemetryBlockHeader, count), sizeof view.count);
+    view.nights = reinterpret_cast<const uint32_t *>(block + TelemetryLayout::night);
+    view.ticks = reinterpret_cast<const uint16_t *>(block + TelemetryLayout::tick);
+    view.values = reinterpret_cast<const int16_t *>(block + TelemetryLayout::value);
+    view.kinds = block + TelemetryLayout::kind;
+    view.subjects = block + TelemetryLayout::subject;
+    return view;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "simulation.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// What happened during a night, as a stream of small fixed-width events.
+enum class TelemetryKind : uint8_t
+{
+    NightStart, // value: the seed's low 16 bits
+    Move,       // subject: animatronic (0 Freddo, 1 Chico); value: the room it moved to
+    Retreat,    // subject: animatronic; value: the room it fell back to
+    Door,       // subject: 0 left, 1 right; value: 1 closed, 0 opened
+    Battery,    // value: the new battery percentage
+    NightEnd,   // value: the Outcome (Running means quit); subject: the animatronic, if one
+};
+
+// Telemetry file: an append-only run of fixed-size blocks, each a header followed by one
+// array per field (night, tick, value, kind, subject) of TELEMETRY_BLOCK_EVENTS entries. A
+// scan touches only the columns it needs, and blocks can be read in parallel. Night numbers
+// count up through the file; a night may carry on into the next block.
+constexpr uint32_t TELEMETRY_BLOCK_EVENTS = 16384;
+
+struct TelemetryBlockHeader
+{
+    char magic[4]; // "S2ST"
+    uint16_t version;
+    uint16_t headerBytes;
+    uint32_t capacity; // events per block
+    uint32_t count;    // events written so far
+    uint64_t unused;
+};
+
+// Byte offsets of the columns inside a block.
+struct TelemetryLayout
+{
+    static constexpr size_t night = sizeof(TelemetryBlockHeader);
+    static constexpr size_t tick = night + 4 * TELEMETRY_BLOCK_EVENTS;
+    static constexpr size_t value = tick + 2 * TELEMETRY_BLOCK_EVENTS;
+    static constexpr size_t kind = value + 2 * TELEMETRY_BLOCK_EVENTS;
+    static constexpr size_t subject = kind + TELEMETRY_BLOCK_EVENTS;
+    // Whole pages, so every block can be mapped on its own.
+    static constexpr size_t blockBytes = (subject + TELEMETRY_BLOCK_EVENTS + 4095) / 4096 * 4096;
+};
+
+// Appends events into the current block, which is mapped straight from the file: logging an
+// event is five stores and a count, and the only system calls happen once per block.
+struct TelemetryWriter
+{
+    uint8_t *block = nullptr;
+    uint32_t *nights = nullptr;
+    uint16_t *ticks = nullptr;
+    int16_t *values = nullptr;
+    uint8_t *kinds = nullptr;
+    uint8_t *subjects = nullptr;
+    TelemetryBlockHeader *header = nullptr;
+    uint32_t count = 0;
+    uint32_t night = 0;     // the night being logged
+    uint32_t nextNight = 0;
+    uint64_t blockIndex = 0;
+    int fd = -1;
+    std::FILE *file = nullptr; // where there is no mmap, full blocks are written out instead
+};
+
+// Appends to `path`, creating it if needed.
+bool openTelemetry(TelemetryWriter &writer, const char *path, std::string &error);
+void closeTelemetry(TelemetryWriter &writer);
+
+// Moves to the next block; logEvent calls it when the current one is full.
+void nextTelemetryBlock(TelemetryWriter &writer);
+
+inline void logEvent(TelemetryWriter &writer, int tick, TelemetryKind kind, int subject,
+                     int value)
+{
+    if (writer.count == TELEMETRY_BLOCK_EVENTS)
+        nextTelemetryBlock(writer);
+    const uint32_t i = writer.count++;
+    writer.nights[i] = writer.night;
+    writer.ticks[i] = static_cast<uint16_t>(tick);
+    writer.values[i] = static_cast<int16_t>(value);
+    writer.kinds[i] = static_cast<uint8_t>(kind);
+    writer.subjects[i] = static_cast<uint8_t>(subject);
+    writer.header->count = writer.count;
+}
+
+// The parts of a Night that events are about, to compare before and after a step.
+struct NightObservation
+{
+    int freddoPos;
+    int chicoPos;
+    int battery;
+    bool leftDoor;
+    bool rightDoor;
+};
+
+inline NightObservation observeNight(const Night &night)
+{
+    const GameState &game = night.game;
+    return {game.freddoPos, game.chicoPos, game.battery, game.leftDoor, game.rightDoor};
+}
+
+// Starts a new night number and logs its start.
+void logNightStart(TelemetryWriter &writer, uint64_t seed);
+// Logs whatever changed since `before`: moves and retreats, doors, battery, and the end of the
+// night if it just ended.
+void logNightChanges(TelemetryWriter &writer, const NightObservation &before, const Night &night);
+// Logs a night that stopped without being decided (the player quit).
+void logNightQuit(TelemetryWriter &writer, const Night &night);
+
+// A telemetry log mapped read-only for analysis, and one block's columns.
+struct TelemetryFile
+{
+    const uint8_t *data = nullptr;
+    size_t bytes = 0;
+    size_t blocks = 0;
+    std::vector<uint8_t> copy; // the file's contents where it can't be mapped
+};
+
+struct TelemetryBlock
+{
+    uint32_t count = 0;
+    const uint32_t *nights = nullptr;
+    const uint16_t *ticks = nullptr;
+    const int16_t *values = nullptr;
+    const uint8_t *kinds = nullptr;
+    const uint8_t *subjects = nullptr;
+};
+
+bool mapTelemetry(const char *path, TelemetryFile &file, std::string &error);
+void unmapTelemetry(TelemetryFile &file);
+TelemetryBlock telemetryBlock(const TelemetryFile &file, size_t index);
@@ -0,0 +1,389 @@
+// Telemetry analyzer: scans telemetry logs from the game (--telemetry) or the simulator
+// (--telemetry PREFIX) on all cores and reports how nights end, when players die and why the
+// animatronics got in.
+
+#include "animatronic.hpp"
+#include "game_state.hpp"
+#include "option_parse.hpp"
+#include "room_graph.hpp"
+#include "telemetry.hpp"
+#include "work_stealing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Time of death in slots of ten in-game minutes: six per hour, 12 AM to 6 AM.
+constexpr int SLOTS_PER_HOUR = 6;
+constexpr int SLOT_TICKS = TICKS_PER_HOUR / SLOTS_PER_HOUR;
+constexpr int SLOTS = 6 * SLOTS_PER_HOUR;
+// Seconds an animatronic waited at the door before getting in, capped at the last bucket.
+constexpr int WAIT_BUCKETS = 121;
+
+struct AnalyzerOptions
+{
+    std::vector<const char *> paths;
+    unsigned threads = 0;
+    const char *csvPath = nullptr;
+    const char *mapPath = nullptr;
+};
+
+struct DeathStats
+{
+    uint64_t nights = 0;
+    uint64_t events = 0;
+    uint64_t unfinished = 0; // the log stops before the night's end
+    uint64_t outcomes[5] = {};
+    uint64_t slots[5][SLOTS] = {};
+    uint64_t neverClosed[2] = {};  // got in while the player never closed that door on it
+    uint64_t reopened[2] = {};     // the door was closed on it, then opened too soon
+    uint64_t waits[2][WAIT_BUCKETS] = {};
+    uint64_t toggles = 0;
+    uint64_t moves = 0;
+    uint64_t retreats = 0;
+
+    void merge(const DeathStats &other)
+    {
+        nights += other.nights;
+        events += other.events;
+        unfinished += other.unfinished;
+        for (int o = 0; o < 5; ++o)
+        {
+            outcomes[o] += other.outcomes[o];
+            for (int slot = 0; slot < SLOTS; ++slot)
+                slots[o][slot] += other.slots[o][slot];
+        }
+        for (int a = 0; a < 2; ++a)
+        {
+            neverClosed[a] += other.neverClosed[a];
+            reopened[a] += other.reopened[a];
+            for (int w = 0; w < WAIT_BUCKETS; ++w)
+                waits[a][w] += other.waits[a][w];
+        }
+        toggles += other.toggles;
+        moves += other.moves;
+        retreats += other.retreats;
+    }
+};
+
+// Per-animatronic door side (0 left, 1 right), the room outside it and the office behind it.
+struct DoorInfo
+{
+    int side[2];
+    int doorRoom[2];
+    int officeRoom[2];
+};
+
+// One night being read: when each animatronic reached its door and whether the player shut
+// the door on it since.
+struct NightTrace
+{
+    bool doorClosed[2] = {};
+    int arrival[2] = {-1, -1};
+    bool closedOnIt[2] = {};
+};
+
+static void endNight(DeathStats &stats, const NightTrace &trace, int tick, int subject,
+                     Outcome outcome)
+{
+    const int o = static_cast<int>(outcome);
+    stats.outcomes[o]++;
+    if (outcome == Outcome::Running || outcome == Outcome::Survived)
+        return;
+    stats.slots[o][std::min(tick / SLOT_TICKS, SLOTS - 1)]++;
+    if (outcome == Outcome::BatteryDied || subject < 0 || subject > 1)
+        return;
+    if (trace.closedOnIt[subject])
+        stats.reopened[subject]++;
+    else
+        stats.neverClosed[subject]++;
+    if (trace.arrival[subject] >= 0)
+    {
+        const int seconds = (tick - trace.arrival[subject]) / TICKS_PER_SECOND;
+        stats.waits[subject][std::min(std::max(seconds, 0), WAIT_BUCKETS - 1)]++;
+    }
+}
+
+// Applies one event of an open night; false once the night has ended.
+static bool readEvent(DeathStats &stats, NightTrace &trace, const DoorInfo &doors,
+                      const TelemetryBlock &block, uint32_t i)
+{
+    const int tick = block.ticks[i];
+    const int subject = block.subjects[i];
+    const int value = block.values[i];
+    stats.events++;
+
+    switch (static_cast<TelemetryKind>(block.kinds[i]))
+    {
+    case TelemetryKind::Move:
+    case TelemetryKind::Retreat:
+        if (subject > 1)
+            break;
+        (block.kinds[i] == static_cast<uint8_t>(TelemetryKind::Move) ? stats.moves
+                                                                      : stats.retreats)++;
+        if (value == doors.doorRoom[subject])
+        {
+            trace.arrival[subject] = tick;
+            trace.closedOnIt[subject] = trace.doorClosed[doors.side[subject]];
+        }
+        else if (value != doors.officeRoom[subject])
+            trace.arrival[subject] = -1;
+        break;
+    case TelemetryKind::Door:
+        if (subject > 1)
+            break;
+        stats.toggles++;
+        trace.doorClosed[subject] = value != 0;
+        for (int a = 0; a < 2; ++a)
+            if (value != 0 && doors.side[a] == subject && trace.arrival[a] >= 0)
+                trace.closedOnIt[a] = true;
+        break;
+    case TelemetryKind::NightEnd:
+        if (value >= 0 && value < 5)
+            endNight(stats, trace, tick, subject, static_cast<Outcome>(value));
+        return false;
+    case TelemetryKind::NightStart:
+    case TelemetryKind::Battery:
+        break;
+    }
+    return true;
+}
+
+struct BlockTask
+{
+    size_t file = 0;
+    size_t block = 0;
+};
+
+// Reads every night that starts in block `index`, following the last one into later blocks
+// if it runs on. Events before the block's first night start belong to an earlier block's task.
+static void analyzeBlock(const TelemetryFile &file, size_t index, const DoorInfo &doors,
+                         DeathStats &stats)
+{
+    bool open = false;
+    NightTrace trace;
+    for (size_t b = index; b < file.blocks; ++b)
+    {
+        const TelemetryBlock block = telemetryBlock(file, b);
+        for (uint32_t i = 0; i < block.count; ++i)
+        {
+            if (block.kinds[i] == static_cast<uint8_t>(TelemetryKind::NightStart))
+            {
+                if (b != index)
+                {
+                    // The next night belongs to the task for this block.
+                    if (open)
+                        stats.unfinished++;
+                    return;
+                }
+                if (open)
+                    stats.unfinished++;
+                stats.nights++;
+                stats.events++;
+                trace = NightTrace{};
+                open = true;
+            }
+            else if (open)
+                open = readEvent(stats, trace, doors, block, i);
+        }
+        if (!open)
+            return;
+    }
+    if (open)
+        stats.unfinished++;
+}
+
+static double share(uint64_t part, uint64_t whole)
+{
+    return whole > 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+static int medianWait(const uint64_t *waits)
+{
+    uint64_t total = 0;
+    for (int w = 0; w < WAIT_BUCKETS; ++w)
+        total += waits[w];
+    uint64_t seen = 0;
+    for (int w = 0; w < WAIT_BUCKETS; ++w)
+    {
+        seen += waits[w];
+        if (total > 0 && 2 * seen >= total)
+            return w;
+    }
+    return -1;
+}
+
+static const char *OUTCOME_NAMES[5] = {"quit", "battery died", "Freddo got in", "Chico got in",
+                                       "survived"};
+
+static void printReport(const DeathStats &stats)
+{
+    std::printf("\n%-16s %12s %8s\n", "outcome", "nights", "share");
+    for (int o : {4, 1, 2, 3, 0})
+        std::printf("%-16s %12llu %7.2f%%\n", OUTCOME_NAMES[o],
+                    static_cast<unsigned long long>(stats.outcomes[o]),
+                    share(stats.outcomes[o], stats.nights));
+    if (stats.unfinished > 0)
+        std::printf("%-16s %12llu\n", "log cut short",
+                    static_cast<unsigned long long>(stats.unfinished));
+
+    std::printf("\nTime of death, share of each cause by hour:\n%-16s", "");
+    for (int hour = 0; hour < 6; ++hour)
+        std::printf(" %6d %s", hour == 0 ? 12 : hour, "AM");
+    std::printf("\n");
+    for (int o = 1; o <= 3; ++o)
+    {
+        std::printf("%-16s", OUTCOME_NAMES[o]);
+        for (int hour = 0; hour < 6; ++hour)
+        {
+            uint64_t count = 0;
+            for (int slot = 0; slot < SLOTS_PER_HOUR; ++slot)
+                count += stats.slots[o][hour * SLOTS_PER_HOUR + slot];
+            std::printf(" %8.1f%%", share(count, stats.outcomes[o]));
+        }
+        std::printf("\n");
+    }
+
+    std::printf("\nWhy they got in:  %14s %18s %14s\n", "door never shut", "shut, then opened",
+                "median wait");
+    for (int a = 0; a < 2; ++a)
+    {
+        const uint64_t deaths = stats.neverClosed[a] + stats.reopened[a];
+        const int median = medianWait(stats.waits[a]);
+        char wait[32] = "-";
+        if (median >= 0)
+            std::snprintf(wait, sizeof wait, "%s%d s", median == WAIT_BUCKETS - 1 ? ">=" : "",
+                          median);
+        std::printf("%-16s %15.1f%% %17.1f%% %14s\n", a == 0 ? "Freddo" : "Chico",
+                    share(stats.neverClosed[a], deaths), share(stats.reopened[a], deaths), wait);
+    }
+
+    const double nights = stats.nights > 0 ? static_cast<double>(stats.nights) : 1.0;
+    std::printf("\nPer night: %.1f door toggles, %.1f moves, %.1f retreats\n",
+                stats.toggles / nights, stats.moves / nights, stats.retreats / nights);
+}
+
+// Deaths per cause in ten-minute slots of the night, for plotting.
+static bool writeCsv(const char *path, const DeathStats &stats)
+{
+    std::FILE *file = std::fopen(path, "w");
+    if (!file)
+        return false;
+    std::fprintf(file, "time,battery_died,freddo_got_in,chico_got_in\n");
+    for (int slot = 0; slot < SLOTS; ++slot)
+    {
+        const int hour = slot / SLOTS_PER_HOUR;
+        std::fprintf(file, "%d:%02d,%llu,%llu,%llu\n", hour == 0 ? 12 : hour,
+                     slot % SLOTS_PER_HOUR * 10,
+                     static_cast<unsigned long long>(stats.slots[1][slot]),
+                     static_cast<unsigned long long>(stats.slots[2][slot]),
+                     static_cast<unsigned long long>(stats.slots[3][slot]));
+    }
+    return std::fclose(file) == 0;
+}
+
+static bool parseOptions(int argc, char **argv, AnalyzerOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char *arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(arg, "--threads") == 0 && hasValue)
+        {
+            if (!parseCount(argv[++i], 0u, MAX_THREADS, options.threads))
+                return false;
+        }
+        else if (std::strcmp(arg, "--csv") == 0 && hasValue)
+            options.csvPath = argv[++i];
+        else if (std::strcmp(arg, "--map") == 0 && hasValue)
+            options.mapPath = argv[++i];
+        else if (arg[0] != '-')
+            options.paths.push_back(arg);
+        else
+            return false;
+    }
+    return !options.paths.empty();
+}
+
+int main(int argc, char **argv)
+{
+    AnalyzerOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::fprintf(stderr, "Usage: %s LOG.s2st... [--threads N] [--csv FILE] [--map FILE]\n",
+                     argv[0]);
+        return 2;
+    }
+    std::string error;
+    if (options.mapPath)
+    {
+        RoomGraph graph;
+        if (!loadRoomGraph(options.mapPath, graph, error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.mapPath, error.c_str());
+            return 2;
+        }
+        setActiveRoomGraph(graph);
+    }
+    unsigned threads = options.threads;
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // The logs record rooms by number; which one is outside each door comes from the map.
+    const RoomGraph &graph = activeRoomGraph();
+    DoorInfo doors;
+    doors.side[FREDDO_ROUTE] = Freddo::spec.door == DoorSide::Left ? 0 : 1;
+    doors.side[CHICO_ROUTE] = Chico::spec.door == DoorSide::Left ? 0 : 1;
+    doors.doorRoom[FREDDO_ROUTE] = graph.routes[FREDDO_ROUTE].doorRoom;
+    doors.doorRoom[CHICO_ROUTE] = graph.routes[CHICO_ROUTE].doorRoom;
+    for (int a = 0; a < 2; ++a)
+        doors.officeRoom[a] = graph.routes[a].officeRoom;
+
+    std::vector<TelemetryFile> files(options.paths.size());
+    WorkStealingPool<BlockTask> pool(threads);
+    size_t blocks = 0;
+    for (size_t f = 0; f < files.size(); ++f)
+    {
+        if (!mapTelemetry(options.paths[f], files[f], error))
+        {
+            std::fprintf(stderr, "%s: %s\n", options.paths[f], error.c_str());
+            return 2;
+        }
+        for (size_t b = 0; b < files[f].blocks; ++b)
+            pool.push(static_cast<unsigned>(blocks++ % threads), {f, b});
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<DeathStats> perWorker(pool.workers());
+    pool.run([&](const BlockTask &task, unsigned worker) {
+        analyzeBlock(files[task.file], task.block, doors, perWorker[worker]);
+    });
+    DeathStats total;
+    for (const DeathStats &stats : perWorker)
+        total.merge(stats);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::printf("Scanned %llu nights (%llu events, %zu files, %zu blocks) on %u threads in "
+                "%.3f s, %.0f M events/s\n",
+                static_cast<unsigned long long>(total.nights),
+                static_cast<unsigned long long>(total.events), files.size(), blocks, threads,
+                elapsed.count(),
+                elapsed.count() > 0 ? total.events / elapsed.count() / 1e6 : 0.0);
+    printReport(total);
+
+    for (TelemetryFile &file : files)
+        unmapTelemetry(file);
+    if (options.csvPath && !writeCsv(options.csvPath, total))
+    {
+        std::fprintf(stderr, "%s: can't write the CSV\n", options.csvPath);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-off of the latest value from one writer thread to one reader thread. Of the
+// three slots the writer owns one, the reader owns one and the third holds the newest value
+// not yet taken; each side swaps its slot with the middle one, so neither ever waits and the
+// reader always gets the most recent complete value. Values the reader never took are dropped.
+template <typename T>
+struct TripleBuffer
+{
+    // Writer side: the slot to fill before the next publish.
+    T &back() { return slots[backIndex]; }
+
+    // Writer side: makes back() the newest value and hands the writer a free slot. Returns
+    // true if this replaced a value the reader never took.
+    bool publish()
+    {
+        const uint8_t old = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel);
+        backIndex = old & INDEX;
+        return (old & FRESH) != 0;
+    }
+
+    // Reader side: moves front() to the newest value; false if nothing was published since.
+    bool update()
+    {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0)
+            return false;
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // Reader side: the value update last took.
+    const T &front() const { return slots[frontIndex]; }
+
+  private:
+    static constexpr uint8_t INDEX = 3;
+    static constexpr uint8_t FRESH = 4; // set by publish, cleared by update
+
+    T slots[3] = {};
+    // The middle slot's index and FRESH flag, and each side's own slot, on separate cache lines
+    // so the two threads don't fight over one line.
+    alignas(64) std::atomic<uint8_t> middle{1};
+    alignas(64) uint8_t backIndex = 0;
+    alignas(64) uint8_t frontIndex = 2;
+};
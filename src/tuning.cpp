@@ -0,0 +1,239 @@
+#include "tuning.hpp"
+
+#include "ai.hpp"
+#include "game_state.hpp"
+#include "simulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static constexpr Tuning DEFAULT_TUNING{};
+
+static constexpr TuningCurves curvesFor(const Tuning &t)
+{
+    TuningCurves curves{};
+    for (int hour = 0; hour < CURVE_HOURS; ++hour)
+        curves.aggroPerTick[hour] = t.aggroPerTickPerHour * hour;
+    for (int state = 0; state < 8; ++state)
+        curves.drainPerTick[state] = t.baseDrainPerTick +
+                                     (state & DRAIN_LEFT_DOOR ? t.doorDrainPerTick : 0) +
+                                     (state & DRAIN_RIGHT_DOOR ? t.doorDrainPerTick : 0) +
+                                     (state & DRAIN_CAMERA ? t.cameraDrainPerTick : 0);
+    curves.retreatBase = t.retreatDecisionsCalm * AGGRO_ONE;
+    curves.retreatSlope = t.retreatDecisionsCalm - t.retreatDecisionsFull;
+    curves.cooldownFull = t.cooldownTicksFull;
+    curves.cooldownRange = t.cooldownTicksCalm - t.cooldownTicksFull;
+    curves.advanceCalm = t.advanceChanceCalm;
+    curves.advanceRange = int64_t{t.advanceChanceFull} - t.advanceChanceCalm;
+    return curves;
+}
+
+thread_local const Tuning *currentTuning = &DEFAULT_TUNING;
+thread_local TuningCurves currentCurves = curvesFor(DEFAULT_TUNING);
+
+void setActiveTuning(const Tuning &tuning)
+{
+    currentTuning = &tuning;
+    currentCurves = curvesFor(tuning);
+}
+
+const Tuning &defaultTuning() { return DEFAULT_TUNING; }
+
+namespace
+{
+
+// One tunable value: an int field, or a chance stored as a fraction of 2^32.
+struct TuningField
+{
+    const char *name;
+    int Tuning::*value;
+    uint32_t Tuning::*chance;
+};
+
+// Replays store the values in this order, so new ones only go at the end.
+const TuningField FIELDS[] = {
+    {"aggro-rate", &Tuning::aggroPerTickPerHour, nullptr},
+    {"retreat-calm", &Tuning::retreatDecisionsCalm, nullptr},
+    {"retreat-full", &Tuning::retreatDecisionsFull, nullptr},
+    {"retreat-cooldown", &Tuning::retreatCooldownTicks, nullptr},
+    {"cooldown-calm", &Tuning::cooldownTicksCalm, nullptr},
+    {"cooldown-full", &Tuning::cooldownTicksFull, nullptr},
+    {"advance-calm", nullptr, &Tuning::advanceChanceCalm},
+    {"advance-full", nullptr, &Tuning::advanceChanceFull},
+    {"drain", &Tuning::baseDrainPerTick, nullptr},
+    {"door-drain", &Tuning::doorDrainPerTick, nullptr},
+    {"camera-drain", &Tuning::cameraDrainPerTick, nullptr},
+};
+
+constexpr int FIELD_COUNT = sizeof FIELDS / sizeof FIELDS[0];
+
+const TuningField *findField(const char *name)
+{
+    for (const TuningField &field : FIELDS)
+        if (std::strcmp(field.name, name) == 0)
+            return &field;
+    return nullptr;
+}
+
+} // namespace
+
+const int TUNING_VALUE_COUNT = FIELD_COUNT;
+
+const char *tuningName(int index) { return FIELDS[index].name; }
+
+bool setTuningValue(Tuning &tuning, const char *name, double value)
+{
+    const TuningField *field = findField(name);
+    if (!field || !std::isfinite(value))
+        return false;
+    if (field->value)
+    {
+        // validateTuning narrows the range further; this only keeps the conversion defined.
+        if (std::fabs(value) > 1e9)
+            return false;
+        tuning.*field->value = static_cast<int>(std::lround(value));
+        return true;
+    }
+    // 1.0 can't be represented; the largest fraction is a 1 in 2^32 miss.
+    const double scaled = std::ldexp(std::min(std::max(value, 0.0), 1.0), 32);
+    tuning.*field->chance = static_cast<uint32_t>(std::min(scaled, 4294967295.0));
+    return true;
+}
+
+int64_t rawTuningValue(const Tuning &tuning, int index)
+{
+    const TuningField &field = FIELDS[index];
+    return field.value ? int64_t{tuning.*field.value} : int64_t{tuning.*field.chance};
+}
+
+bool setRawTuningValue(Tuning &tuning, int index, int64_t value)
+{
+    const TuningField &field = FIELDS[index];
+    if (field.value)
+    {
+        if (value < INT32_MIN || value > INT32_MAX)
+            return false;
+        tuning.*field.value = static_cast<int>(value);
+        return true;
+    }
+    if (value < 0 || value > UINT32_MAX)
+        return false;
+    tuning.*field.chance = static_cast<uint32_t>(value);
+    return true;
+}
+
+bool parseTuningSetting(const char *setting, Tuning &tuning)
+{
+    const char *equals = std::strchr(setting, '=');
+    if (!equals || equals[1] == '\0')
+        return false;
+    char *end = nullptr;
+    const double value = std::strtod(equals + 1, &end);
+    return *end == '\0' && setTuningValue(tuning, std::string(setting, equals).c_str(), value);
+}
+
+double tuningValue(const Tuning &tuning, const char *name)
+{
+    const TuningField *field = findField(name);
+    if (!field)
+        return 0.0;
+    if (field->value)
+        return tuning.*field->value;
+    return std::ldexp(static_cast<double>(tuning.*field->chance), -32);
+}
+
+static std::string trimmed(const std::string &text)
+{
+    const size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return "";
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool parseTuningFile(const std::string &text, Tuning &tuning, std::string &error)
+{
+    size_t start = 0;
+    for (int number = 1; start < text.size(); ++number)
+    {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos)
+            end = text.size();
+        std::string line = text.substr(start, end - start);
+        start = end + 1;
+
+        auto fail = [&](const std::string &why) {
+            error = "line " + std::to_string(number) + ": " + why;
+            return false;
+        };
+        line = trimmed(line.substr(0, line.find('#')));
+        if (line.empty())
+            continue;
+
+        const size_t equals = line.find('=');
+        if (equals == std::string::npos)
+            return fail("expected: <name> = <value>");
+        const std::string name = trimmed(line.substr(0, equals));
+        const std::string value = trimmed(line.substr(equals + 1));
+        char *valueEnd = nullptr;
+        const double parsed = std::strtod(value.c_str(), &valueEnd);
+        if (value.empty() || *valueEnd != '\0' || !std::isfinite(parsed))
+            return fail("'" + value + "' is not a number");
+        if (!findField(name.c_str()))
+            return fail("no setting called '" + name + "'");
+        if (!setTuningValue(tuning, name.c_str(), parsed))
+            return fail("'" + value + "' is out of range");
+    }
+    return true;
+}
+
+bool loadTuningFile(const char *path, Tuning &tuning, std::string &error)
+{
+    std::FILE *file = std::fopen(path, "rb");
+    if (!file)
+    {
+        error = std::string("cannot open ") + path;
+        return false;
+    }
+    std::string text;
+    char buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, file)) > 0)
+        text.append(buf, n);
+    std::fclose(file);
+    return parseTuningFile(text, tuning, error);
+}
+
+bool validateTuning(const Tuning &tuning, std::string &error)
+{
+    // The curves multiply these by hours and aggro in int.
+    if (tuning.aggroPerTickPerHour < 0 || tuning.aggroPerTickPerHour > AGGRO_ONE)
+        error = "aggro-rate must be 0.." + std::to_string(AGGRO_ONE);
+    // Snapshots keep blockedTimer in a byte.
+    else if (tuning.retreatDecisionsCalm < 1 || tuning.retreatDecisionsFull < 1 ||
+             tuning.retreatDecisionsCalm > 255 || tuning.retreatDecisionsFull > 255)
+        error = "retreat-calm and retreat-full must be 1..255";
+    else if (std::min({tuning.retreatCooldownTicks, tuning.cooldownTicksCalm,
+                       tuning.cooldownTicksFull}) < 0 ||
+             std::max({tuning.retreatCooldownTicks, tuning.cooldownTicksCalm,
+                       tuning.cooldownTicksFull}) > MAX_NIGHT_TICKS)
+        error = "cooldowns must be 0.." + std::to_string(MAX_NIGHT_TICKS);
+    else if (tuning.baseDrainPerTick < 1)
+        error = "drain must be at least 1";
+    else if (tuning.doorDrainPerTick < 0 || tuning.cameraDrainPerTick < 0)
+        error = "door-drain and camera-drain can't be negative";
+    // The batched engine drains at most one unit per tick.
+    else if (tuning.baseDrainPerTick + 2 * tuning.doorDrainPerTick > BATTERY_UNIT)
+        error = "drain + 2 * door-drain can't exceed " + std::to_string(BATTERY_UNIT);
+    // Nor does the game, whose camera can be up with both doors shut.
+    else if (tuning.baseDrainPerTick + 2 * tuning.doorDrainPerTick +
+                 tuning.cameraDrainPerTick >
+             BATTERY_UNIT)
+        error = "drain + 2 * door-drain + camera-drain can't exceed " +
+                std::to_string(BATTERY_UNIT);
+    else
+        return true;
+    return false;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Every balance number in one place, so the headless tools can try other values without a
+// rebuild. Aggro curves interpolate between a calm animatronic (aggro 0) and a fully
+// aggressive one (AGGRO_ONE); the defaults are the game's original balance.
+struct Tuning
+{
+    int aggroPerTickPerHour = 20; // aggro gained per tick, per hour survived
+
+    // Decisions spent blocked at a closed door before retreating.
+    int retreatDecisionsCalm = 5;
+    int retreatDecisionsFull = 2;
+    int retreatCooldownTicks = 120; // cooldown after a retreat
+
+    // Cooldown after advancing a room.
+    int cooldownTicksCalm = 180;
+    int cooldownTicksFull = 60;
+
+    // Chance of advancing when a decision rolls, as a fraction of 2^32.
+    uint32_t advanceChanceCalm = 1u << 30; // 0.25
+    uint32_t advanceChanceFull = 3u << 30; // 0.75
+
+    // Battery drain in 1/BATTERY_UNIT per tick.
+    int baseDrainPerTick = 1;
+    int doorDrainPerTick = 2; // per closed door
+    // While the camera monitor is up. Only a player raises it; the headless policies, the
+    // batched engine and the solver play with it down.
+    int cameraDrainPerTick = 2;
+};
+
+// Hours the clock can reach: a night ends at 6 AM, and the engines run at most 7 hours.
+constexpr int CURVE_HOURS = 8;
+
+// Index bits of TuningCurves::drainPerTick.
+constexpr int DRAIN_LEFT_DOOR = 1;
+constexpr int DRAIN_RIGHT_DOOR = 2;
+constexpr int DRAIN_CAMERA = 4;
+
+// The per-tick curves of the active Tuning, worked out once by setActiveTuning so an update
+// is a table lookup or a single multiply (see ai.hpp).
+struct TuningCurves
+{
+    int aggroPerTick[CURVE_HOURS]; // by hours survived
+    int drainPerTick[8];           // by the DRAIN_* bits in use
+    int retreatBase;               // retreat threshold at aggro 0
+    int retreatSlope;              // threshold lost per unit of aggro
+    int cooldownFull;
+    int cooldownRange; // calm minus full
+    uint32_t advanceCalm;
+    int64_t advanceRange; // full minus calm
+};
+
+// The tuning the current thread's nights run with. Each thread starts on the defaults; the
+// sweep tool points its workers at the grid point they are playing.
+extern thread_local const Tuning *currentTuning;
+extern thread_local TuningCurves currentCurves;
+inline const Tuning &activeTuning() { return *currentTuning; }
+inline const TuningCurves &activeCurves() { return currentCurves; }
+void setActiveTuning(const Tuning &tuning); // `tuning` must outlive the nights using it
+
+const Tuning &defaultTuning();
+
+// The tunable values by the names the tools use, e.g. "aggro-rate". Chances are set as
+// probabilities (0..1), everything else in ticks, decisions or drain units.
+extern const int TUNING_VALUE_COUNT;
+const char *tuningName(int index);
+
+bool setTuningValue(Tuning &tuning, const char *name, double value);
+// The value as stored, chances as fractions of 2^32, for files that must keep it exactly.
+int64_t rawTuningValue(const Tuning &tuning, int index);
+bool setRawTuningValue(Tuning &tuning, int index, int64_t value); // false if out of range
+bool parseTuningSetting(const char *setting, Tuning &tuning); // "name=value"
+double tuningValue(const Tuning &tuning, const char *name);
+
+// Applies a tuning file on top of `tuning`: one "name = value" per line, as for --set, with
+// # comments (see tuning/default.tuning). On failure says which line is wrong and why.
+bool parseTuningFile(const std::string &text, Tuning &tuning, std::string &error);
+bool loadTuningFile(const char *path, Tuning &tuning, std::string &error);
+
+// False, with a reason, for values the engines can't run (e.g. no battery drain at all).
+bool validateTuning(const Tuning &tuning, std::string &error);
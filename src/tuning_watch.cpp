@@ -0,0 +1,145 @@
+#include "tuning_watch.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// Reads the file again over the command line's tuning and publishes what came of it.
+static void reloadTuning(TuningWatcher &watcher, TuningReload &state)
+{
+    Tuning tuning = watcher.base;
+    std::string error;
+    if (loadTuningFile(watcher.path.c_str(), tuning, error) && validateTuning(tuning, error))
+    {
+        state.tuning = tuning;
+        state.applied++;
+    }
+    else
+    {
+        state.rejected++;
+        std::snprintf(state.lastError, sizeof state.lastError, "%s", error.c_str());
+    }
+    watcher.reloads.back() = state;
+    watcher.reloads.publish();
+    if (watcher.loop)
+        wakeEventLoop(*watcher.loop);
+}
+
+#ifdef __linux__
+static void watchLoop(TuningWatcher &watcher, TuningReload state)
+{
+    const size_t slash = watcher.path.find_last_of('/');
+    const std::string name =
+        slash == std::string::npos ? watcher.path : watcher.path.substr(slash + 1);
+
+    pollfd fds[2] = {{watcher.notifyFd, POLLIN, 0}, {watcher.stopFd, POLLIN, 0}};
+    while (!watcher.stop.load(std::memory_order_acquire))
+    {
+        if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN))
+            continue;
+
+        alignas(inotify_event) char events[4096];
+        const ssize_t got = read(watcher.notifyFd, events, sizeof events);
+        bool changed = false;
+        for (ssize_t at = 0; at < got;)
+        {
+            const auto *event = reinterpret_cast<const inotify_event *>(events + at);
+            if (event->len > 0 && name == event->name)
+                changed = true;
+            at += sizeof(inotify_event) + event->len;
+        }
+        if (changed)
+            reloadTuning(watcher, state);
+    }
+}
+#else
+// No inotify: look at the modification time a few times a second.
+static void watchLoop(TuningWatcher &watcher, TuningReload state)
+{
+    auto modified = [&] {
+        struct stat info;
+        return stat(watcher.path.c_str(), &info) == 0 ? info.st_mtime : 0;
+    };
+    auto seen = modified();
+    while (!watcher.stop.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        const auto now = modified();
+        if (now != seen)
+        {
+            seen = now;
+            reloadTuning(watcher, state);
+        }
+    }
+}
+#endif
+
+bool startTuningWatcher(TuningWatcher &watcher, const char *path, const Tuning &base,
+                        const Tuning &current, std::string &error)
+{
+    watcher.path = path;
+    watcher.base = base;
+    watcher.stop.store(false, std::memory_order_relaxed);
+#ifdef __linux__
+    // Watch the directory rather than the file: editors often save by writing a new file and
+    // renaming it over the old one, which a watch on the old file would never see.
+    const size_t slash = watcher.path.find_last_of('/');
+    const std::string directory =
+        slash == std::string::npos ? "." : watcher.path.substr(0, slash + 1);
+    watcher.notifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    watcher.stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (watcher.notifyFd < 0 || watcher.stopFd < 0 ||
+        inotify_add_watch(watcher.notifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        error = "can't watch " + directory + " for changes";
+        stopTuningWatcher(watcher);
+        return false;
+    }
+#else
+    (void)error;
+#endif
+
+    TuningReload state;
+    state.tuning = current;
+    watcher.thread = std::thread(watchLoop, std::ref(watcher), state);
+    return true;
+}
+
+void stopTuningWatcher(TuningWatcher &watcher)
+{
+    watcher.stop.store(true, std::memory_order_release);
+#ifdef __linux__
+    if (watcher.stopFd >= 0)
+    {
+        const uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = write(watcher.stopFd, &one, sizeof one);
+    }
+#endif
+    if (watcher.thread.joinable())
+        watcher.thread.join();
+#ifdef __linux__
+    if (watcher.notifyFd >= 0)
+        close(watcher.notifyFd);
+    if (watcher.stopFd >= 0)
+        close(watcher.stopFd);
+#endif
+    watcher.notifyFd = -1;
+    watcher.stopFd = -1;
+}
+
+bool takeTuningReload(TuningWatcher &watcher)
+{
+    if (!watcher.reloads.update())
+        return false;
+    setActiveTuning(watcher.reloads.front().tuning);
+    return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "event_loop.hpp"
+#include "triple_buffer.hpp"
+#include "tuning.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+// What the watcher last made of the tuning file. `tuning` is always one that validated: a
+// file that fails keeps the previous tuning and only updates the counts and the error.
+struct TuningReload
+{
+    Tuning tuning;
+    uint32_t applied = 0;  // reloads that changed the tuning
+    uint32_t rejected = 0; // reloads that didn't parse or validate
+    char lastError[128] = {};
+};
+
+// Reloads --tuning FILE whenever it is saved, so the balance can be changed in the middle of a
+// night. A background thread waits for the file to change (inotify on its directory on Linux,
+// which also sees editors that save by renaming; polling the modification time elsewhere),
+// parses and validates it, and hands the result over through a TripleBuffer. The game loop
+// takes it with one atomic exchange: no lock, no allocation and no parsing on its side.
+struct TuningWatcher
+{
+    std::string path;
+    Tuning base; // the command line's tuning, which each reload of the file is applied over
+    TripleBuffer<TuningReload> reloads;
+    EventLoop *loop = nullptr; // woken after a reload so it takes effect at once
+    int notifyFd = -1;
+    int stopFd = -1;
+    std::atomic<bool> stop{false};
+    std::thread thread;
+};
+
+// Starts watching `path`; `current` is the tuning the game starts with. False, with a reason,
+// if the file can't be watched.
+bool startTuningWatcher(TuningWatcher &watcher, const char *path, const Tuning &base,
+                        const Tuning &current, std::string &error);
+void stopTuningWatcher(TuningWatcher &watcher);
+
+// Game loop side: if the file was reloaded since the last call, makes the new tuning active on
+// this thread and returns true. The tuning stays valid until the next call.
+bool takeTuningReload(TuningWatcher &watcher);
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool where every worker has its own deque of tasks. A worker runs its newest task
+// first (its data is most likely still in cache) and, when it runs dry, steals the oldest task
+// of another worker, so uneven tasks still keep every core busy without a shared queue to
+// fight over. Tasks can push follow-up tasks from inside run().
+template <typename Task>
+struct WorkStealingPool
+{
+    explicit WorkStealingPool(unsigned threads) : queues(threads > 0 ? threads : 1) {}
+
+    unsigned workers() const { return static_cast<unsigned>(queues.size()); }
+
+    // Queues a task on `worker`'s deque.
+    void push(unsigned worker, const Task &task)
+    {
+        pending.fetch_add(1);
+        Queue &queue = queues[worker % queues.size()];
+        std::lock_guard<std::mutex> guard(queue.lock);
+        queue.tasks.push_back(task);
+    }
+
+    // Runs every task, including ones pushed while running, as f(task, worker), and returns
+    // once all of them have finished.
+    template <typename F>
+    void run(F &&f)
+    {
+        auto work = [&](unsigned self) {
+            Task task;
+            while (pending.load() > 0)
+            {
+                if (!take(self, task))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+                f(task, self);
+                pending.fetch_sub(1);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (unsigned worker = 1; worker < workers(); ++worker)
+            threads.emplace_back(work, worker);
+        work(0);
+        for (auto &thread : threads)
+            thread.join();
+    }
+
+    uint64_t steals() const { return stolen.load(); }
+
+  private:
+    struct alignas(64) Queue
+    {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    bool take(unsigned self, Task &task)
+    {
+        {
+            Queue &own = queues[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.tasks.empty())
+            {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); ++i)
+        {
+            Queue &victim = queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                stolen.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<Queue> queues;
+    std::atomic<size_t> pending{0}; // pushed but not yet finished
+    std::atomic<uint64_t> stolen{0};
+};